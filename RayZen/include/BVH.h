@@ -1,6 +1,7 @@
 // Bounding Volume Hierarchy
 #pragma once
 #include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "Mesh.h"
 
@@ -22,7 +23,8 @@ struct BVHInstance {
 
 enum class BVHSplitMethod {
     Midpoint,
-    SAH
+    SAH,       // full sweep over centroid-sorted triangles
+    BinnedSAH  // fixed bin count over centroid bounds, in-place partition
 };
 
 class BVH {
@@ -32,11 +34,60 @@ public:
     // For TLAS
     std::vector<BVHInstance> instances;
     BVHSplitMethod splitMethod = BVHSplitMethod::SAH;
+    int sahBinCount = 16; // bins per axis for BinnedSAH (clamped to [2, 64])
+    // Parallel BLAS build: ranges above the threshold are split with range-parallel
+    // binning/partition and their subtrees built as tasks on ThreadPool::shared().
+    // Produces the same nodes and triIndices as the serial build.
+    bool parallelBuild = false;
+    int parallelSubtreeThreshold = 8192;
+    // TLAS build: Midpoint splits the widest axis of the instance bounds; SAH and BinnedSAH
+    // bin instance world AABBs (SAH with the maximum bin count) and only split ranges of at
+    // most tlasMaxLeafSize instances when that is cheaper than a leaf. Clamped to [1, 16].
+    BVHSplitMethod tlasSplitMethod = BVHSplitMethod::Midpoint;
+    int tlasMaxLeafSize = 1;
+    // Refit quality tracking: refit() rebuilds once the SAH cost exceeds rebuildCostRatio
+    // times builtSAHCost, the cost right after the last full BLAS/TLAS build (0 until known).
+    float rebuildCostRatio = 1.5f;
+    float builtSAHCost = 0.0f;
+    float sahCostRatio = 1.0f; // cost of the current tree relative to builtSAHCost
     // BLAS build (per mesh)
-    void buildBLAS(const std::vector<Triangle>& tris);
-    // TLAS build (over mesh AABBs)
+    void buildBLAS(const Mesh& mesh);
+    // BLAS refit for deforming meshes: recomputes node bounds bottom-up from the moved
+    // triangles, keeping the topology. Falls back to buildBLAS when the triangle count
+    // changed or the tree degraded past rebuildCostRatio. Returns true if it rebuilt.
+    bool refit(const Mesh& mesh);
+    // TLAS build (over mesh AABBs); instances of meshes without triangles are left out
     void buildTLAS(const std::vector<BVHInstance>& meshInstances, const std::vector<BVHNode>& meshRootNodes);
+    // TLAS refit: recomputes node bounds bottom-up from new instance world bounds, keeping
+    // the topology, and updates sahCostRatio; rebuilding is left to the caller.
+    // [firstChanged, lastChanged] covers every node whose bounds changed (empty if first > last).
+    void refitTLAS(const std::vector<BVHNode>& meshRootNodes, int& firstChanged, int& lastChanged);
+    // SAH cost of the built tree (unit traversal/intersection cost, normalized by root area)
+    float computeSAHCost() const;
     // BVH serialization
     bool saveToFile(const std::string& filename) const;
     bool loadFromFile(const std::string& filename);
+private:
+    void buildTLASWithSAH(const std::vector<BVHNode>& meshRootNodes, const std::vector<int>& meshIndices, int leafSize);
+};
+
+// BVH4/BVH8 collapsed from a binary BVH for the shader. Each wide node has `width` child
+// slots, used ones first. Full precision slots reuse BVHNode: leftFirst is the child wide node
+// (count -1) or the first leaf triangle (count > 0); unused slots have count 0. Quantized
+// nodes take 4 + 3 * width words: the parent bounds origin, per-axis power-of-two scales
+// (biased float exponents) and per child 8-bit conservative bounds, a count and the reference.
+struct WideBVH {
+    int width = 4;
+    bool quantized = false;
+    int nodeCount = 0;
+    int depth = 0;               // wide node levels, root included
+    std::vector<BVHNode> slots;  // full precision: width slots per node
+    std::vector<uint32_t> words; // quantized: wordsPerNode() words per node
+
+    void build(const BVH& bvh, int nodeWidth, bool quantize);
+    int wordsPerNode() const { return 4 + 3 * width; }
+    // Entries a depth-first traversal stack needs: each level on the path keeps up to width - 1
+    // siblings, and the deepest popped node pushes all its children
+    int traversalStackSize() const { return depth > 0 ? 1 + (depth - 1) * (width - 1) : 0; }
+    size_t byteSize() const { return quantized ? words.size() * sizeof(uint32_t) : slots.size() * sizeof(BVHNode); }
 };
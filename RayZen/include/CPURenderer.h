@@ -0,0 +1,58 @@
+// CPU reference path tracer. Traces the same flattened buffers the fragment shader reads and
+// mirrors its traverseTLAS/traverseBLAS and shading code, so renders and profiles run without
+// a GL context. Tiles are scheduled as tasks on ThreadPool::shared().
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.h"
+#include "Camera.h"
+#include "Light.h"
+#include "LightTable.h"
+#include "Material.h"
+#include "RayKernels.h"
+
+// Scene in the shader's buffer layout: corners index the shared vertex array, instances point
+// at binary BLAS node and triangle index ranges, TLAS leaves list instance indices
+struct CPUScene {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::uvec3> corners;
+    std::vector<int> triangleMaterials;
+    std::vector<BVHNode> blasNodes;
+    std::vector<int> blasTriIndices;
+    BVHLeafBlocks blasLeafBlocks; // SoA leaves for the SIMD triangle kernel, indexed like blasNodes
+    std::vector<BVHInstance> instances;
+    std::vector<BVHNode> tlasNodes;
+    std::vector<int> tlasIndices;
+    std::vector<Material> materials;
+    std::vector<Light> lights;
+    LightTable lightTable; // power-weighted selection over lights
+};
+
+struct CPURenderSettings {
+    int width = 800;
+    int height = 600;
+    int samplesPerPixel = 1;
+    int maxBounces = 5; // the shader's default bounce budget
+    int lightSamples = 4; // shadow rays per hit once there are more point lights, as the lightSamples uniform
+    int tileSize = 16;
+};
+
+struct CPURenderStats {
+    double ms = 0.0;
+    uint64_t rays = 0; // closest-hit queries: camera, bounce and shadow rays
+    int tiles = 0;
+    unsigned threads = 0;
+    double mraysPerSecond() const { return ms > 0.0 ? static_cast<double>(rays) / (ms * 1000.0) : 0.0; }
+};
+
+class CPURenderer {
+public:
+    explicit CPURenderer(const CPUScene& scene) : scene(scene) {}
+
+    // Renders width x height pixels into image, top row first: the mean of samples clamped to [0, 1], like the shaders accumulate
+    CPURenderStats render(const Camera& camera, const CPURenderSettings& settings, std::vector<glm::vec3>& image) const;
+
+private:
+    const CPUScene& scene;
+};
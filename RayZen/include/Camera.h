@@ -12,6 +12,9 @@ public:
 
     glm::mat4 viewMatrix;
     glm::mat4 projectionMatrix;
+    // Kept in step with the matrices above by the update functions, so per-frame code never inverts them
+    glm::mat4 invViewMatrix;
+    glm::mat4 invProjectionMatrix;
 
     float fov;
     float aspectRatio;
@@ -41,26 +44,32 @@ public:
 
     void updateViewMatrix() {
         viewMatrix = glm::lookAt(position, position + target, up);
+        invViewMatrix = glm::inverse(viewMatrix);
     }
 
     void updateProjectionMatrix() {
         projectionMatrix = glm::perspective(glm::radians(fov), aspectRatio, nearClip, farClip);
+        invProjectionMatrix = glm::inverse(projectionMatrix);
     }
 
     void moveForward(float deltaTime) {
         position += speed * deltaTime * target;  // Move in the direction the camera is facing
+        updateViewMatrix();
     }
 
     void moveBackward(float deltaTime) {
         position -= speed * deltaTime * target;  // Move opposite to the camera's facing direction
+        updateViewMatrix();
     }
 
     void moveLeft(float deltaTime) {
         position -= glm::normalize(glm::cross(target, up)) * speed * deltaTime;  // Move left relative to the camera's orientation
+        updateViewMatrix();
     }
 
     void moveRight(float deltaTime) {
         position += glm::normalize(glm::cross(target, up)) * speed * deltaTime;  // Move right relative to the camera's orientation
+        updateViewMatrix();
     }
 
     void rotate(float offsetX, float offsetY) {
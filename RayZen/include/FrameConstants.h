@@ -0,0 +1,53 @@
+// Per-frame path tracer constants: the std140 FrameConstants uniform block of
+// pathtracer_common.glsl, written once per frame into a ring of uniform buffer slots instead of
+// being set uniform by uniform on every program.
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// std140 layout of FrameConstants: the Camera struct, then the scalars
+struct FrameConstants {
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::mat4 invViewMatrix;
+    glm::mat4 invProjectionMatrix;
+    glm::vec3 cameraPosition;
+    float pad0;
+    glm::vec2 resolution;
+    int numLights;
+    int lightSamples;
+    int bounceBudget;      // uniformBounceBudget; <= 0 uses the default
+    int blasNodeWidth;
+    int blasNodeQuantized;
+};
+static_assert(offsetof(FrameConstants, resolution) == 272, "FrameConstants must match the std140 block");
+static_assert(offsetof(FrameConstants, blasNodeQuantized) == 296, "FrameConstants must match the std140 block");
+
+// Three slots in one uniform buffer, persistently mapped when glBufferStorage is available.
+// Publishing fences the slot written before, since every command reading it was issued by then,
+// and only reuses a slot once its fence signaled, so the CPU never writes memory the GPU may
+// still read and the driver never has to shadow the buffer.
+class FrameConstantRing {
+public:
+    static const GLuint kBinding = 0; // uniform buffer binding of FrameConstants
+    static const int kSlots = 3;
+
+    FrameConstantRing() = default;
+    FrameConstantRing(const FrameConstantRing&) = delete;
+    FrameConstantRing& operator=(const FrameConstantRing&) = delete;
+
+    // Copies constants into the next slot and binds it to kBinding; allocates the ring on first use
+    void publish(const FrameConstants& constants);
+    // Needs the context publish() ran on to be current
+    void destroy();
+
+private:
+    void create();
+
+    GLuint buffer = 0;
+    GLsizeiptr slotStride = 0; // sizeof(FrameConstants) rounded up to the uniform offset alignment
+    unsigned char* mapped = nullptr; // null when slots are rewritten with glBufferSubData
+    GLsync fences[kSlots] = {};
+    int slot = -1;
+};
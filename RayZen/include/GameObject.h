@@ -6,5 +6,12 @@
 struct GameObject {
     std::shared_ptr<Mesh> mesh;
     glm::mat4 transform = glm::mat4(1.0f);
+    // Set whenever the transform changes; the per-frame BVH update only looks at dirty objects
+    bool transformDirty = true;
+
+    void setTransform(const glm::mat4& newTransform) {
+        transform = newTransform;
+        transformDirty = true;
+    }
     // Optionally, a name or ID if needed
 };
\ No newline at end of file
@@ -0,0 +1,26 @@
+// Offscreen OpenGL core context through EGL, with no window or display server. Mesa's
+// surfaceless platform is preferred, so llvmpipe works on machines without a display.
+// Builds without EGL (RAYZEN_HAVE_EGL unset) fail create() with an error.
+#pragma once
+
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+    ~HeadlessContext() { destroy(); }
+
+    // Tries core profiles from 4.6 down to 4.3 (SSBOs) and makes the first one current
+    bool create();
+    void destroy();
+
+    int majorVersion() const { return major; }
+    int minorVersion() const { return minor; }
+
+private:
+    void* display = nullptr; // EGLDisplay
+    void* context = nullptr; // EGLContext
+    void* surface = nullptr; // EGLSurface; null when the context is current without one
+    int major = 0;
+    int minor = 0;
+};
@@ -0,0 +1,21 @@
+// Image output for offscreen renders. Images are RGB, top row first; 8-bit formats clamp to
+// [0, 1], PFM keeps the float values.
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace ImageIO {
+// Binary PPM (P6), 8 bits per channel
+bool writePPM(const std::string& path, int width, int height, const std::vector<glm::vec3>& image);
+// 8-bit RGB PNG with uncompressed deflate blocks, so no zlib is needed
+bool writePNG(const std::string& path, int width, int height, const std::vector<glm::vec3>& image);
+// Little-endian color PFM (PF), 32-bit float per channel
+bool writePFM(const std::string& path, int width, int height, const std::vector<glm::vec3>& image);
+// Picks the format from the extension: .png, .pfm, anything else PPM
+bool write(const std::string& path, int width, int height, const std::vector<glm::vec3>& image);
+// Color PFM in either byte order, as written by writePFM
+bool readPFM(const std::string& path, int& width, int& height, std::vector<glm::vec3>& image);
+// Root mean square difference over all channels; images must have the same size
+double rmse(const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference);
+}
@@ -0,0 +1,26 @@
+// Power-weighted light selection for direct lighting. Point lights go into an alias table
+// (Vose's method) weighted by power times color luminance, so a shading point picks one in
+// constant time however many there are. Directional lights are few and reach every point, so
+// they follow the table and are always evaluated. Mirrors LightTableBuffer in pathtracer_common.glsl.
+#pragma once
+#include <vector>
+#include "Light.h"
+
+// std430 LightAliasEntry
+struct LightAliasEntry {
+    float threshold; // keep this slot when the pick's fraction is below it, else take alias
+    int alias;       // table slot sharing this one
+    float pdf;       // probability of picking light
+    int light;       // index into the scene's lights
+};
+
+struct LightTable {
+    int pointLightCount = 0;
+    int directionalLightCount = 0;
+    // pointLightCount alias slots, then one entry (pdf 1) per directional light
+    std::vector<LightAliasEntry> entries;
+
+    static LightTable build(const std::vector<Light>& lights);
+    // Picks a point light for u in [0, 1) and returns its index; needs pointLightCount > 0
+    int sample(float u, float& pdf) const;
+};
@@ -5,21 +5,22 @@
 #include <string>
 #include <glm/glm.hpp>
 
-// A single triangle with three vertices and a material index.
-struct Triangle {
-    glm::vec3 v0;
-    float pad0 = 0.0f; // Padding to align to 16 bytes
-    glm::vec3 v1;
-    float pad1 = 0.0f; // Padding to align to 16 bytes
-    glm::vec3 v2;
-    float pad2 = 0.0f; // Padding to align to 16 bytes
-    int materialIndex;
-} __attribute__((aligned(16)));
-
+// Indexed triangle mesh: triangles share a vertex pool and keep one material index each.
+// The same three arrays back the path tracer SSBOs, the BVH builders and the raster path.
 class Mesh {
 public:
-    std::vector<Triangle> triangles;
+    std::vector<glm::vec3> vertices;  // shared vertex pool
+    std::vector<glm::uvec3> indices;  // per triangle: its three corners in vertices
+    std::vector<int> materials;       // per triangle material index
+    // Set after moving vertices in place (deformation); the per-frame BVH update refits the mesh's BLAS
+    bool geometryDirty = false;
     bool loadFromOBJ(const std::string& filename, int materialIndex);
+
+    size_t triangleCount() const { return indices.size(); }
+    const glm::vec3& corner(size_t tri, int k) const { return vertices[indices[tri][k]]; }
+    glm::vec3 triangleMin(size_t tri) const { return glm::min(corner(tri, 0), glm::min(corner(tri, 1), corner(tri, 2))); }
+    glm::vec3 triangleMax(size_t tri) const { return glm::max(corner(tri, 0), glm::max(corner(tri, 1), corner(tri, 2))); }
+    glm::vec3 triangleCentroid(size_t tri) const { return (corner(tri, 0) + corner(tri, 1) + corner(tri, 2)) / 3.0f; }
 };
 
 #endif
@@ -0,0 +1,116 @@
+// Always-on profiler: named CPU spans and GPU passes timed with GL_TIME_ELAPSED queries feed
+// rolling per-name statistics (p50/p95/p99 over the last kWindow samples). With a trace path set,
+// every span is also kept as a Chrome trace event and written as JSON for chrome://tracing or
+// ui.perfetto.dev.
+#pragma once
+#include <GL/glew.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Profiler {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+    static const int kWindow = 512;              // samples per name the percentiles are taken over
+    static const int kGPUQueries = 4;            // GL_TIME_ELAPSED queries in flight per GPU pass
+    static const size_t kMaxTraceEvents = 1 << 20;
+
+    struct Stats {
+        int count = 0;        // samples in the window
+        long long total = 0;  // samples ever recorded
+        double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0; // ms over the window
+    };
+
+    static Profiler& shared();
+
+    // Keeps trace events from now on for writeTrace; the calling thread is named "main" in the trace
+    void enableTrace(const std::string& path);
+    bool tracing() const { return !tracePath.empty(); }
+
+    // A finished CPU span on the calling thread; safe from any thread
+    void record(const std::string& name, Clock::time_point begin, Clock::time_point end);
+
+    // Bracket the GL commands of a GPU pass with a query from the pass's ring. GL allows one active
+    // GL_TIME_ELAPSED query, so nested passes are folded into the outer one. When every query of
+    // the pass is still in flight the pass goes untimed instead of stalling on the GPU.
+    void beginGPU(const std::string& name);
+    void endGPU();
+    // Collects finished queries without waiting; call once per frame on the GL thread. In the
+    // trace a GPU pass starts where its commands were submitted, which is before the GPU ran them.
+    void collectGPU();
+    // Deletes the query objects; needs the context they were created on to be current
+    void releaseGPU();
+
+    Stats stats(const std::string& name) const;
+    // One info line per name with its percentiles
+    void logSummary(const std::string& title) const;
+    // Writes the trace events to the path given to enableTrace
+    bool writeTrace() const;
+
+private:
+    struct Series {
+        std::vector<double> samples; // ring of the last kWindow durations in ms
+        int next = 0;
+        long long total = 0;
+    };
+    struct TraceEvent {
+        std::string name;
+        double startUs, durationUs;
+        int thread; // 0 is the GPU track
+    };
+    struct GPUPass {
+        GLuint queries[kGPUQueries] = {};
+        Clock::time_point submitted[kGPUQueries];
+        int next = 0;    // slot the next beginGPU uses
+        int pending = 0; // queries issued and not collected yet, ending at next
+    };
+
+    Profiler() : epoch(Clock::now()) {}
+    void addSample(const std::string& name, double ms, Clock::time_point begin, int thread);
+    int threadIndex(); // needs mutex held
+    void collectPass(const std::string& name, GPUPass& pass);
+
+    const Clock::time_point epoch;
+    mutable std::mutex mutex;
+    std::map<std::string, Series> series;
+    std::string tracePath;
+    std::vector<TraceEvent> traceEvents;
+    size_t droppedTraceEvents = 0;
+    std::map<std::thread::id, int> threads;
+
+    // GL thread only
+    std::map<std::string, GPUPass> gpuPasses;
+    GPUPass* activeGPUPass = nullptr;
+    bool activeGPUQuery = false;
+    int gpuDepth = 0;
+    int gpuSupported = -1; // unknown until the first pass
+};
+
+// Records the enclosing block as a CPU span
+class ProfileScope {
+public:
+    explicit ProfileScope(std::string name) : name(std::move(name)), begin(Profiler::Clock::now()) {}
+    ~ProfileScope() { Profiler::shared().record(name, begin, Profiler::Clock::now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    std::string name;
+    Profiler::Clock::time_point begin;
+};
+
+// Times the enclosing block's GL commands as a GPU pass
+class GPUProfileScope {
+public:
+    explicit GPUProfileScope(const std::string& name) { Profiler::shared().beginGPU(name); }
+    ~GPUProfileScope() { Profiler::shared().endGPU(); }
+    GPUProfileScope(const GPUProfileScope&) = delete;
+    GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+};
+
+// value as a quoted JSON string, for the trace and the headless report; control characters are dropped
+std::string jsonString(const std::string& value);
@@ -0,0 +1,81 @@
+// SIMD kernels for CPU ray queries against a binary BVH: one ray against up to four leaf
+// triangles at once, and packets of 4 (SSE) or 8 (AVX2) rays against one node. Builds without
+// SSE2 use the scalar versions. All variants use the shader's Möller–Trumbore epsilons and
+// report the same closest hit as testing a leaf's triangles one by one.
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.h"
+#include "Mesh.h"
+
+// Four leaf triangles in SoA form: first corner and both edges per lane. Padding lanes have
+// zero edges, which never hit, and tri -1.
+struct alignas(16) TriangleBlock {
+    float v0[3][4];
+    float e1[3][4];
+    float e2[3][4];
+    int tri[4]; // triangle index as stored in BVH::triIndices
+};
+
+// SoA copy of BVH leaves, built alongside BVH::triIndices. Leaf node n owns the blocks
+// [nodeFirstBlock[n], nodeFirstBlock[n] + ceil(count / 4)), in triIndices order.
+struct BVHLeafBlocks {
+    std::vector<TriangleBlock> blocks;
+    std::vector<int> nodeFirstBlock; // per node, across every appended BVH
+
+    // Appends the leaves of bvh, so node indices continue after the previously appended trees
+    void append(const BVH& bvh, const Mesh& mesh);
+};
+
+template <int N>
+struct RayPacket {
+    float ox[N], oy[N], oz[N];
+    float dx[N], dy[N], dz[N];
+    float invDx[N], invDy[N], invDz[N];
+    float tMax[N];  // shrinks to the closest hit found so far
+    int hitTri[N];  // triIndices value of the closest hit, -1 if none
+
+    void set(int lane, const glm::vec3& origin, const glm::vec3& dir, float maxT = 1e30f) {
+        ox[lane] = origin.x; oy[lane] = origin.y; oz[lane] = origin.z;
+        dx[lane] = dir.x; dy[lane] = dir.y; dz[lane] = dir.z;
+        invDx[lane] = 1.0f / dir.x; invDy[lane] = 1.0f / dir.y; invDz[lane] = 1.0f / dir.z;
+        tMax[lane] = maxT;
+        hitTri[lane] = -1;
+    }
+};
+
+namespace RayKernels {
+// "AVX2", "SSE" or "scalar", depending on the instruction sets this file was built for
+const char* simdLevel();
+
+// The single-ray slab test of the shader's intersectAABB: true if the ray enters the node's box,
+// at tEnter, no later than tMax
+inline bool intersectAABB(const glm::vec3& origin, const glm::vec3& invDir, const BVHNode& node, float tMax, float& tEnter) {
+    glm::vec3 t0 = (node.boundsMin - origin) * invDir;
+    glm::vec3 t1 = (node.boundsMax - origin) * invDir;
+    glm::vec3 tsmaller = glm::min(t0, t1);
+    glm::vec3 tbigger = glm::max(t0, t1);
+    tEnter = std::max(std::max(tsmaller.x, tsmaller.y), tsmaller.z);
+    float tExit = std::min(std::min(tbigger.x, tbigger.y), tbigger.z);
+    return tExit >= std::max(tEnter, 0.0f) && !(tEnter > tMax);
+}
+
+// Closest hit with t < tMax among the block's triangles; returns the lane or -1, and sets tHit
+int intersectTriangleBlock(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax, float& tHit);
+int intersectTriangleBlockScalar(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax, float& tHit);
+// Any-hit form for shadow rays: bit i set if lane i hits with t < tMax
+uint32_t intersectTriangleBlockAny(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax);
+
+// Bit i set if ray i of the packet enters the node's box no later than its tMax
+uint32_t intersectPacketAABB(const RayPacket<4>& packet, const BVHNode& node);
+uint32_t intersectPacketAABB(const RayPacket<8>& packet, const BVHNode& node);
+
+// Closest-hit traversal of the BVH whose root is nodes[0]; nodeOffset is the root's index in
+// leaves.nodeFirstBlock. Returns the triIndices value of the hit or -1.
+int traverseRay(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, const glm::vec3& origin, const glm::vec3& dir, float& tHit, bool simdLeaves = true);
+// Packet traversal: a node is visited while any ray of the packet still overlaps it
+void traversePacket(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, RayPacket<4>& packet);
+void traversePacket(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, RayPacket<8>& packet);
+}
@@ -0,0 +1,63 @@
+// Single-file scene cache: a versioned header followed by the SSBO-ready arrays.
+// The file is memory-mapped read-only, so sections can be handed to glBufferData as is.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class SceneCache {
+public:
+    enum Section {
+        Vertices,
+        TriangleCorners,   // global vertex indices, three per triangle
+        TriangleMaterials,
+        BLASNodes,      // binary BLAS nodes of all unique meshes, back to back
+        BLASTriIndices,
+        MeshRanges,     // per unique mesh: BLAS node offset, node count, tri index offset, tri index count
+        TLASNodes,
+        TLASTriIndices,
+        SectionCount
+    };
+
+    // Bump whenever the file layout or the meaning of a section changes
+    static constexpr uint32_t kVersion = 3;
+
+    struct SectionData {
+        const void* data = nullptr;
+        size_t bytes = 0;
+    };
+
+    SceneCache() = default;
+    ~SceneCache();
+    SceneCache(const SceneCache&) = delete;
+    SceneCache& operator=(const SceneCache&) = delete;
+
+    // Maps the file and checks magic, version, key and section bounds; false leaves the cache closed
+    bool open(const std::string& path, uint64_t key);
+    void close();
+    bool isOpen() const { return mapping != nullptr; }
+    size_t fileSize() const { return mappingSize; }
+    // Hash of the instance transforms the cached TLAS was built for
+    uint64_t transformHash() const;
+
+    SectionData section(Section s) const;
+    template <typename T>
+    const T* sectionAs(Section s, size_t& count) const {
+        SectionData d = section(s);
+        count = d.bytes / sizeof(T);
+        return static_cast<const T*>(d.data);
+    }
+
+    // Writes all sections to a temporary file next to path and renames it over path,
+    // so a crash mid-write never leaves a truncated cache behind
+    static bool write(const std::string& path, uint64_t key, uint64_t transformHash, const SectionData (&sections)[SectionCount]);
+
+    // 64-bit hash for cache keys; chain calls through seed to hash several ranges
+    static uint64_t hashBytes(const void* data, size_t bytes, uint64_t seed = 0x9E3779B97F4A7C15ull);
+    template <typename T>
+    static uint64_t hashValue(const T& value, uint64_t seed) { return hashBytes(&value, sizeof(T), seed); }
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+};
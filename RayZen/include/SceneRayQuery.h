@@ -0,0 +1,49 @@
+// CPU ray queries against the two-level scene BVH: a TLAS over instances and one binary BLAS
+// per mesh. Instance rays keep the transformed, unnormalized direction, so t is the same
+// parameter along the world ray in every instance and hits compare across them. Leaves are
+// tested four triangles at a time with the RayKernels block kernels.
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "BVH.h"
+#include "RayKernels.h"
+
+struct QueryRay {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float tMax = 1e30f;
+};
+
+struct RayQueryHit {
+    float t = 1e30f;    // hit at origin + t * direction
+    int instance = -1;  // index into the instances, which follow the game objects
+    int triangle = -1;  // triangle index within the instance's mesh
+};
+
+class SceneRayQuery {
+public:
+    // blas[m] and leaves[m] belong to BVHInstance::meshIndex m; leaves[m] holds only blas[m]'s
+    // leaves. Everything is referenced, not copied, so transform updates are seen as long as the
+    // containers stay in place; refit BLASes need their leaf blocks rebuilt.
+    SceneRayQuery(const BVH& tlas, const std::vector<BVHInstance>& instances,
+                  std::vector<const BVH*> blas, std::vector<const BVHLeafBlocks*> leaves);
+
+    // Closest hit with t < ray.tMax
+    bool closestHit(const QueryRay& ray, RayQueryHit& hit) const;
+    // True if anything is hit with t < ray.tMax; stops at the first hit found
+    bool anyHit(const QueryRay& ray) const;
+
+    // Batched forms, run in parallel on ThreadPool::shared(); result i answers rays[i]
+    void closestHits(const std::vector<QueryRay>& rays, std::vector<RayQueryHit>& hits) const;
+    void anyHits(const std::vector<QueryRay>& rays, std::vector<char>& occluded) const;
+
+private:
+    bool traverse(const QueryRay& ray, bool anyHit, RayQueryHit& hit) const;
+    bool traverseBLAS(const BVH& blas, const BVHLeafBlocks& leaves, const glm::vec3& origin, const glm::vec3& dir,
+                      bool anyHit, float& tHit, int& triangle) const;
+
+    const BVH& tlas;
+    const std::vector<BVHInstance>& instances;
+    std::vector<const BVH*> blas;
+    std::vector<const BVHLeafBlocks*> leaves;
+};
@@ -0,0 +1,22 @@
+// Owen-scrambled Sobol sampler (Burley 2020, "Practical Hash-based Owen Scrambling"). Every
+// pixel gets its own shuffled and scrambled copy of a 4D Sobol sequence, and each further group
+// of four dimensions reshuffles the point order with its own seed, so paths can draw as many
+// dimensions as they need. Integer hashing only, so the CPU renderer and the shaders produce the
+// same sample values. Mirrors the sampling functions in pathtracer_common.glsl.
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace SobolSampler {
+// Sobol dimensions per set; dimension d of a path uses Sobol dimension d % kDimensions
+const int kDimensions = 4;
+
+// Generator matrices of the first kDimensions Sobol dimensions, 32 columns each (the binding 4
+// SobolBuffer layout)
+const std::vector<uint32_t>& matrices();
+
+// Per-pixel seed for pixel (x, y)
+uint32_t pixelSeed(uint32_t x, uint32_t y);
+// Dimension dimension of sample index in pixel's sequence, in [0, 1)
+float sample(uint32_t pixel, uint32_t index, int dimension);
+}
@@ -0,0 +1,66 @@
+// Work-stealing thread pool with fork-join task groups
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // Counts outstanding tasks spawned into it; wait() returns once all have finished
+    class TaskGroup {
+    public:
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+    private:
+        friend class ThreadPool;
+        std::atomic<int> pending{0};
+    };
+
+    // threadCount == 0 uses std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+    // Queue a task in the group. Called from a worker it goes to that worker's own deque
+    // (LIFO for the owner, stolen FIFO by others), otherwise to the shared injection queue.
+    void run(TaskGroup& group, std::function<void()> task);
+    // Block until every task in the group finished, executing queued tasks meanwhile
+    void wait(TaskGroup& group);
+
+    // Split [begin, end) into chunks of at least grain items and call fn(chunkBegin, chunkEnd, chunkIndex).
+    // Chunk boundaries depend only on the range, grain and pool size, so per-chunk results can be merged deterministically.
+    int chunkCount(int begin, int end, int grain) const;
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int, int)>& fn);
+
+    // Process-wide pool sized to the machine
+    static ThreadPool& shared();
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+    struct WorkerQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool tryRunOne(int self);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // one per worker plus the injection queue at the end
+    std::vector<std::thread> workers;
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    std::atomic<int> queued{0};
+    std::atomic<bool> stopping{false};
+};
@@ -0,0 +1,37 @@
+// Wavefront path tracer: the fragment shader's megakernel split into compute passes over SSBO
+// queues of live paths (shaders/wavefront_*.comp). Every bounce runs extend (closest hit), shade
+// (material response; survivors are compacted into the next queue) and connect (shadow rays for
+// queued hits). Queue headers double as indirect dispatch arguments, so terminated paths cost no
+// threads in later bounces. Each sample is folded into the progressive accumulation image.
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <functional>
+
+class WavefrontPathTracer {
+public:
+    WavefrontPathTracer() = default;
+    WavefrontPathTracer(const WavefrontPathTracer&) = delete;
+    WavefrontPathTracer& operator=(const WavefrontPathTracer&) = delete;
+
+    // Builds the kernels with loadKernel (path -> program, 0 on failure); false if any failed
+    bool create(const std::function<GLuint(const char*)>& loadKernel);
+    // Releases the programs and buffers; needs the context create() ran on to be current
+    void destroy();
+    bool ready() const { return generateProgram != 0; }
+
+    // Traces one sample per pixel and stores the mean of it and the sampleIndex samples already in
+    // accumulationTexture (RGBA32F, width x height). The scene SSBOs and this frame's
+    // FrameConstants must be bound, as sendSceneDataToShader leaves them.
+    void render(int width, int height, int maxBounces, int sampleIndex, GLuint accumulationTexture);
+
+private:
+    void reserve(size_t pixels);
+
+    GLuint generateProgram = 0, extendProgram = 0, shadeProgram = 0, connectProgram = 0, accumulateProgram = 0;
+    GLint sampleIndexLocations[5] = {}; // per program, in declaration order
+    GLint bounceLocations[3] = {};      // extend, shade, connect
+    GLuint pathBuffer = 0;  // PathState per pixel
+    GLuint queueBuffer = 0; // headers and entries of the two path queues and the connect queue
+    size_t capacity = 0;    // pixels the buffers hold
+};
@@ -23,14 +23,27 @@ layout(std430, binding = 2) buffer LightBuffer {
     Light lights[];
 };
 
+// The path tracer's indexed geometry buffers; the draw's index buffer is triangleCorners itself
+layout(std430, binding = 0) buffer TriangleBuffer {
+    uint triangleCorners[];
+};
+
+layout(std430, binding = 12) buffer VertexBuffer {
+    float vertexPositions[];
+};
+
+layout(std430, binding = 13) buffer TriangleMaterialBuffer {
+    int triangleMaterials[];
+};
+
 uniform vec3 uCameraPos;
 uniform vec3 uAmbientColor;
 uniform int numLights;
+uniform mat3 uNormalMatrix;
+uniform int uTriangleOffset; // first triangle of the drawn mesh
 
 in VS_OUT {
     vec3 worldPos;
-    vec3 normal;
-    flat int materialIndex;
 } fs_in;
 
 out vec4 FragColor;
@@ -52,11 +65,22 @@ float geometrySchlickGGX(float NdotV, float roughness) {
     return NdotV / (NdotV * (1.0 - k) + k + 1e-6);
 }
 
+vec3 fetchVertex(uint index) {
+    return vec3(vertexPositions[3u * index], vertexPositions[3u * index + 1u], vertexPositions[3u * index + 2u]);
+}
+
 void main() {
-    int matIndex = clamp(fs_in.materialIndex, 0, materials.length() - 1);
+    int triIdx = uTriangleOffset + gl_PrimitiveID;
+    int matIndex = clamp(triangleMaterials[triIdx], 0, materials.length() - 1);
     Material material = materials[matIndex];
 
-    vec3 N = normalize(fs_in.normal);
+    // Flat shading from the triangle's object-space face normal
+    vec3 p0 = fetchVertex(triangleCorners[3 * triIdx]);
+    vec3 p1 = fetchVertex(triangleCorners[3 * triIdx + 1]);
+    vec3 p2 = fetchVertex(triangleCorners[3 * triIdx + 2]);
+    vec3 faceNormal = cross(p1 - p0, p2 - p0);
+    faceNormal = dot(faceNormal, faceNormal) > 1e-10 ? normalize(faceNormal) : vec3(0.0, 1.0, 0.0);
+    vec3 N = normalize(uNormalMatrix * faceNormal);
     vec3 V = normalize(uCameraPos - fs_in.worldPos);
     float NdotV = max(dot(N, V), 0.0);
 
@@ -1,120 +1,24 @@
 #version 430 core
 
-// Uniforms
-uniform vec2 resolution;
+// Scene buffers, sampling, traversal and shading, shared with the wavefront kernels
+#include "pathtracer_common.glsl"
 
-struct Camera {
-    mat4 viewMatrix;
-    mat4 projectionMatrix;
-    mat4 invViewMatrix;
-    mat4 invProjectionMatrix;
-    vec3 position;
-};
-uniform Camera camera;
+// Overlay features a variant can leave out, like the RZ_ defines in pathtracer_common.glsl
+#ifndef RZ_DEBUG_OVERLAYS
+#define RZ_DEBUG_OVERLAYS 1 // BVH wireframes and light markers
+#endif
+#ifndef RZ_FPS_OVERLAY
+#define RZ_FPS_OVERLAY 1
+#endif
 
-struct Material {
-    vec3 albedo;
-    float metallic;
-    float roughness;
-    float reflectivity;
-    float transparency;
-    float ior;
-};
-
-struct Light {
-    vec4 positionOrDirection; // w==1.0 for point lights, w==0.0 for directional lights
-    vec3 color;
-    float power;
-};
-
-struct Triangle {
-    vec3 v0;
-    float pad0; // Padding to align to 16 bytes
-    vec3 v1;
-    float pad1; // Padding to align to 16 bytes
-    vec3 v2;
-    float pad2; // Padding to align to 16 bytes
-    int materialIndex;
-};
-
-struct BVHNode {
-    vec3 boundsMin;
-    int leftFirst;
-    vec3 boundsMax;
-    int count;
-};
-
-layout(std430, binding = 0) buffer TriangleBuffer {
-    Triangle triangles[];
-};
-
-layout(std430, binding = 1) buffer MaterialBuffer {
-    Material materials[];
-};
-
-layout(std430, binding = 2) buffer LightBuffer {
-    Light lights[];
-};
-
-layout(std430, binding = 3) buffer BVHNodeBuffer {
-    BVHNode bvhNodes[];
-};
-
-layout(std430, binding = 4) buffer BVHTriIdxBuffer {
-    int bvhTriIndices[];
-};
-
-// --- TLAS/BLAS two-level BVH support ---
-
-// TLAS (top-level BVH over mesh instances)
-layout(std430, binding = 5) buffer TLASNodeBuffer {
-    BVHNode tlasNodes[];
-};
-layout(std430, binding = 6) buffer TLASTriIdxBuffer {
-    int tlasTriIndices[];
-};
-
-// BLAS (all mesh BVHs concatenated)
-layout(std430, binding = 7) buffer BLASNodeBuffer {
-    BVHNode blasNodes[];
-};
-layout(std430, binding = 8) buffer BLASTriIdxBuffer {
-    int blasTriIndices[];
-};
-
-// BVHInstance buffer (maps TLAS leaves to BLAS offsets and mesh index)
-struct BVHInstance {
-    int blasNodeOffset;
-    int blasTriOffset;
-    int meshIndex;
-    int globalTriOffset; // Offset into global triangle buffer (NEW)
-    mat4 transform; // (optional, not used if identity)
-    mat4 inverseTransform;
-};
-layout(std430, binding = 9) buffer BVHInstanceBuffer {
-    BVHInstance bvhInstances[];
-};
-
-uniform int numTriangles;
 uniform bool debugShowLights;
-uniform int numLights; // actual number of lights in SSBO
 uniform bool debugShowBVH;
 uniform int debugBVHMode; // 0 = TLAS, 1 = BLAS
 uniform int debugSelectedBLAS; // mesh index
 uniform int debugSelectedTri; // triangle index within mesh
-uniform int uniformBounceBudget; // <=0 uses default bounce count
 
 out vec4 FragColor;
 
-// Constants
-const vec3 ambientLightColor = vec3(0.05, 0.05, 0.05);
-
-// Ray structure
-struct Ray {
-    vec3 origin;
-    vec3 direction;
-};
-
 // FPS overlay font: 8x8 bitmap for digits 0-9 and '.' (11 chars)
 // Each row is a byte, LSB is leftmost pixel
 const int fontWidth = 8;
@@ -147,6 +51,13 @@ const int fontData[11][8] = int[11][8](
 
 // FPS uniform
 uniform float uniformFps;
+uniform bool hideOverlay; // set for offscreen captures
+
+// Progressive accumulation: running mean of all samples since the last reset, before overlays
+layout(binding = 0, rgba32f) uniform image2D accumulationImage;
+uniform bool accumulate;         // false: every frame stands alone
+uniform int sampleIndex;         // samples already in the mean; 0 starts a new one
+uniform bool displayAccumulated; // target spp reached: show the mean without tracing
 
 // Draw a single font character at pixel position (top-left), returns 1.0 if inside glyph, else 0.0
 float drawFontChar(int charIdx, vec2 fragCoord, vec2 pos, float scale) {
@@ -182,35 +93,6 @@ vec3 drawFpsString(vec2 fragCoord, vec2 pos, float scale, float fps, vec3 fg, ve
     return col;
 }
 
-//------------------------------------------------------------------------------
-// Utility functions
-//------------------------------------------------------------------------------
-float rand(vec2 uv) {
-    return fract(sin(dot(uv, vec2(12.9898, 78.233))) * 43758.5453);
-}
-
-vec3 randomHemisphereDirection(vec3 normal, vec2 seed) {
-    float u = rand(seed);
-    float v = rand(seed + vec2(1.0));
-    float theta = acos(sqrt(1.0 - u));
-    float phi = 2.0 * 3.14159 * v;
-    vec3 dir = vec3(sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta));
-    vec3 up = abs(normal.y) < 0.99 ? vec3(0,1,0) : vec3(1,0,0);
-    vec3 tangent = normalize(cross(up, normal));
-    vec3 bitangent = cross(normal, tangent);
-    return normalize(tangent * dir.x + bitangent * dir.y + normal * dir.z);
-}
-
-Ray calculateRay(vec2 uv, vec2 seed) {
-    vec2 jitter = vec2(rand(seed), rand(seed + vec2(1.0))) * 0.00002;
-    uv += jitter;
-    vec4 ray_clip = vec4(uv * 2.0 - 1.0, -1.0, 1.0);
-    vec4 ray_eye = camera.invProjectionMatrix * ray_clip;
-    ray_eye = vec4(ray_eye.xy, -1.0, 0.0);
-    vec3 ray_world = (camera.invViewMatrix * ray_eye).xyz;
-    return Ray(camera.position, normalize(ray_world));
-}
-
 // Helper: HSV to RGB for gradient coloring
 vec3 hsv2rgb(vec3 c) {
     vec4 K = vec4(1.0, 2.0/3.0, 1.0/3.0, 3.0);
@@ -331,8 +213,8 @@ void overlayBVHWireframe(vec2 fragCoord, out float tlasWire, out vec3 tlasColor,
                 }
             }
         }
-        // BLAS overlay: draw the root node of each mesh's BLAS for clear debugging
-        for (int i = 0; i < bvhInstances.length(); ++i) {
+        // BLAS overlay: draw the root node of each mesh's BLAS for clear debugging (binary nodes only)
+        for (int i = 0; i < bvhInstances.length() && blasNodeWidth <= 2; ++i) {
             int rootIdx = bvhInstances[i].blasNodeOffset;
             BVHNode node = blasNodes[rootIdx];
             float w = aabbWireframe(node.boundsMin, node.boundsMax, camera.projectionMatrix * camera.viewMatrix, fragCoord, 2.0);
@@ -342,18 +224,19 @@ void overlayBVHWireframe(vec2 fragCoord, out float tlasWire, out vec3 tlasColor,
                 blasWire = max(blasWire, w);
             }
         }
-    } else if (debugBVHMode == 1) {
+    } else if (debugBVHMode == 1 && blasNodeWidth <= 2) {
         // BLAS mode: draw only the BVH branch for the selected triangle in the selected BLAS
         int selectedBLAS = debugSelectedBLAS;
         int selectedTri = debugSelectedTri;
         int nodeOffset = bvhInstances[selectedBLAS].blasNodeOffset;
         int triOffset = bvhInstances[selectedBLAS].blasTriOffset;
-        int nodeCount = 0;
-        if (selectedBLAS + 1 < bvhInstances.length()) {
-            nodeCount = bvhInstances[selectedBLAS + 1].blasNodeOffset - nodeOffset;
-        } else {
-            nodeCount = blasNodes.length() - nodeOffset;
+        // Instances sharing a mesh share its BLAS, so the range ends at the next larger offset
+        int nodeEnd = blasNodes.length();
+        for (int i = 0; i < bvhInstances.length(); ++i) {
+            int otherOffset = bvhInstances[i].blasNodeOffset;
+            if (otherOffset > nodeOffset && otherOffset < nodeEnd) nodeEnd = otherOffset;
         }
+        int nodeCount = nodeEnd - nodeOffset;
         int path[32]; int pathLen = 0;
         findBVHBranchIterative(nodeOffset, triOffset, nodeCount, selectedTri, path, pathLen);
         // Fetch the instance transform for this BLAS
@@ -372,307 +255,15 @@ void overlayBVHWireframe(vec2 fragCoord, out float tlasWire, out vec3 tlasColor,
     }
 }
 
-//------------------------------------------------------------------------------
-// Intersection functions for TLAS/BLAS
-//------------------------------------------------------------------------------
-
-// Ray-AABB intersection
-bool intersectAABB(vec3 rayOrig, vec3 rayDirInv, vec3 bmin, vec3 bmax, out float tmin, out float tmax) {
-    vec3 t0 = (bmin - rayOrig) * rayDirInv;
-    vec3 t1 = (bmax - rayOrig) * rayDirInv;
-    vec3 tsmaller = min(t0, t1);
-    vec3 tbigger = max(t0, t1);
-    tmin = max(max(tsmaller.x, tsmaller.y), tsmaller.z);
-    tmax = min(min(tbigger.x, tbigger.y), tbigger.z);
-    return tmax >= max(tmin, 0.0);
-}
-
-// Möller–Trumbore algorithm for triangle intersection
-bool hitTriangle(Triangle tri, Ray ray, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex) {
-    vec3 edge1 = tri.v1 - tri.v0;
-    vec3 edge2 = tri.v2 - tri.v0;
-    vec3 h = cross(ray.direction, edge2);
-    float a = dot(edge1, h);
-    if (abs(a) < 0.0001)
-        return false;
-    float f = 1.0 / a;
-    vec3 s = ray.origin - tri.v0;
-    float u = f * dot(s, h);
-    if (u < 0.0 || u > 1.0)
-        return false;
-    vec3 q = cross(s, edge1);
-    float v = f * dot(ray.direction, q);
-    if (v < 0.0 || u + v > 1.0)
-        return false;
-    float t = f * dot(edge2, q);
-    if (t > 0.0001) {
-        tHit = t;
-        hitPoint = ray.origin + ray.direction * t;
-        normal = normalize(cross(edge1, edge2));
-        materialIndex = tri.materialIndex;
-        return true;
-    }
-    return false;
-}
-
-// Traverse BLAS for a mesh instance
-bool traverseBLAS(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex) {    
-    tHit = 1e30;
-    bool hit = false;
-    int stack[64];
-    int stackPtr = 0;
-    stack[stackPtr++] = 0; // root node of this BLAS
-    vec3 invDir = 1.0 / ray.direction;
-    while (stackPtr > 0) {
-        int nidx = stack[--stackPtr];
-        BVHNode node = blasNodes[blasNodeOffset + nidx];
-        float tmin, tmax;
-        if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > tHit)
-            continue;
-        if (node.count > 0) { // leaf
-            for (int i = 0; i < node.count; ++i) {
-                int triIdx = globalTriOffset + blasTriIndices[blasTriOffset + node.leftFirst + i];
-                float t;
-                vec3 tempHit, tempNormal;
-                int tempMat;
-                if (hitTriangle(triangles[triIdx], ray, t, tempHit, tempNormal, tempMat)) {
-                    if (t < tHit) {
-                        tHit = t;
-                        hitPoint = tempHit;
-                        normal = tempNormal;
-                        materialIndex = tempMat;
-                        hit = true;
-                    }
-                }
-            }
-        } else { // internal
-            stack[stackPtr++] = node.leftFirst;
-            stack[stackPtr++] = node.leftFirst + 1;
-        }
-    }
-    return hit;
-}
-
-// Traverse TLAS, return closest hit and mesh instance index
-bool traverseTLAS(Ray ray, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex, out int instanceIdx) {
-    tHit = 1e30;
-    bool hit = false;
-    int stack[64];
-    int stackPtr = 0;
-    stack[stackPtr++] = 0; // root node
-    vec3 invDir = 1.0 / ray.direction;
-    while (stackPtr > 0) {
-        int nidx = stack[--stackPtr];
-        BVHNode node = tlasNodes[nidx];
-        float tmin, tmax;
-        if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > tHit)
-            continue;
-        if (node.count > 0) { // leaf: contains mesh instance indices
-            for (int i = 0; i < node.count; ++i) {
-                int instIdx = tlasTriIndices[node.leftFirst + i];
-                BVHInstance inst = bvhInstances[instIdx];
-                // Transform ray to mesh local space using inverse(instance.transform)
-                mat4 invTransform = inst.inverseTransform;
-                vec3 localOrigin = vec3(invTransform * vec4(ray.origin, 1.0));
-                vec3 localDir = normalize(vec3(invTransform * vec4(ray.direction, 0.0)));
-                Ray localRay = Ray(localOrigin, localDir);
-                float tLocal;
-                vec3 localHit, localNormal;
-                int tempMat;
-                if (traverseBLAS(localRay, inst.blasNodeOffset, inst.blasTriOffset, inst.globalTriOffset, tLocal, localHit, localNormal, tempMat)) {
-                    // Transform hit point and normal back to world space
-                    vec3 worldHit = vec3(inst.transform * vec4(localHit, 1.0));
-                    float tWorld = length(worldHit - ray.origin); // world-space t
-                    if (tWorld < tHit) {
-                        tHit = tWorld;
-                        hitPoint = worldHit;
-                        mat3 normalMatrix = mat3(transpose(inst.inverseTransform));
-                        normal = normalize(normalMatrix * localNormal);
-                        materialIndex = tempMat;
-                        instanceIdx = instIdx;
-                        hit = true;
-                    }
-                }
-            }
-        } else { // internal
-            stack[stackPtr++] = node.leftFirst;
-            stack[stackPtr++] = node.leftFirst + 1;
-        }
-    }
-    return hit;
-}
-
-// Shadow test: cast a ray and check for occlusion using TLAS/BLAS
-// Transparent-aware shadow query: accumulates transmission through multiple transparent objects
-bool shadowVisibility(vec3 origin, vec3 dir, float maxDist, out float visibility) {
-    visibility = 1.0;
-    float traveled = 0.0;
-    const float EPS = 0.001;
-    for (int iter = 0; iter < 32 && visibility > 0.05; ++iter) {
-        float tHit; vec3 hp, n; int matIdx; int inst;
-        if (!traverseTLAS(Ray(origin, dir), tHit, hp, n, matIdx, inst)) return true; // no more hits
-        if (tHit < EPS) { origin += dir * EPS; continue; }
-        traveled += tHit;
-        if (traveled >= maxDist) return true; // reached light
-        Material m = materials[matIdx];
-        if (m.transparency > 0.0) {
-            visibility *= m.transparency;
-            origin = hp + dir * EPS; // continue through
-            continue;
-        } else {
-            visibility = 0.0; // opaque blocker
-            return false;
-        }
-    }
-    return visibility > 0.05;
-}
-
-//------------------------------------------------------------------------------
-// Lighting and material functions
-//------------------------------------------------------------------------------
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
-}
-
-vec3 reflectRay(vec3 incident, vec3 normal) {
-    return incident - 2.0 * dot(incident, normal) * normal;
-}
-
-vec3 refractRay(vec3 incident, vec3 normal, float ior) {
-    float cosi = clamp(dot(incident, normal), -1.0, 1.0);
-    float etai = 1.0, etat = ior;
-    vec3 n = normal;
-    if (cosi < 0.0) {
-        cosi = -cosi;
-    } else {
-        float temp = etai;
-        etai = etat;
-        etat = temp;
-        n = -normal;
-    }
-    float eta = etai / etat;
-    float k = 1.0 - eta * eta * (1.0 - cosi * cosi);
-    return (k < 0.0) ? reflectRay(incident, normal) : eta * incident + (eta * cosi - sqrt(k)) * n;
-}
-
-bool refractDir(vec3 incident, vec3 normal, float eta, out vec3 refr) {
-    // incident assumed normalized, normal points against incident when entering
-    float cosi = clamp(dot(-incident, normal), -1.0, 1.0);
-    float sint2 = max(0.0, 1.0 - cosi * cosi);
-    float eta2 = eta * eta;
-    float k = 1.0 - eta2 * sint2;
-    if (k < 0.0) return false; // total internal reflection
-    refr = normalize(eta * incident + (eta * cosi - sqrt(k)) * normal);
-    return true;
-}
-
-vec3 calculateLighting(vec3 hitPoint, vec3 normal, Material material, vec3 viewDir) {
-    // For transparent dielectrics: compute only specular reflection lobe (no diffuse)
-    if (material.transparency > 0.0) {
-        vec3 F0 = vec3(pow((1.0 - material.ior) / (1.0 + material.ior), 2.0));
-        vec3 specAccum = vec3(0.0);
-        for (int i = 0; i < numLights; ++i) {
-            if (i >= lights.length()) break;
-            Light light = lights[i];
-            vec3 L; float attenuation; float visibility;
-            if (light.positionOrDirection.w == 1.0) {
-                vec3 lv = light.positionOrDirection.xyz - hitPoint;
-                float dist = max(length(lv), 0.001);
-                L = lv / dist;
-                attenuation = light.power / (dist * dist);
-                if (!shadowVisibility(hitPoint + L * 0.001, L, dist, visibility)) continue;
-            } else {
-                L = normalize(light.positionOrDirection.xyz);
-                attenuation = light.power;
-                if (!shadowVisibility(hitPoint + L * 0.001, L, 1e30, visibility)) continue;
-            }
-            attenuation *= visibility;
-            float NdotL = max(dot(normal, L), 0.0);
-            if (NdotL <= 0.0) continue;
-            vec3 H = normalize(L + viewDir);
-            float NdotH = max(dot(normal, H), 0.0);
-            float cosTheta = max(dot(H, viewDir), 0.0);
-            vec3 F = fresnelSchlick(cosTheta, F0);
-            float rough = max(material.roughness, 0.02);
-            float a = rough * rough;
-            float a2 = a * a;
-            float dDen = (NdotH * NdotH) * (a2 - 1.0) + 1.0;
-            float D = a2 / (3.14159 * dDen * dDen + 1e-6);
-            float k = (rough + 1.0)*(rough + 1.0)/8.0;
-            float NdotV = max(dot(normal, viewDir), 0.0);
-            float Gv = NdotV / (NdotV * (1.0 - k) + k + 1e-6);
-            float Gl = NdotL / (NdotL * (1.0 - k) + k + 1e-6);
-            float denom = max(4.0 * NdotL * NdotV, 1e-4);
-            vec3 spec = (F * D * Gv * Gl) / denom;
-            specAccum += spec * light.color * attenuation * NdotL;
-        }
-        return specAccum;
-    }
-    vec3 F0 = mix(vec3(0.04), material.albedo, material.metallic);
-    vec3 finalColor = ambientLightColor * material.albedo;
-
-    // Loop over lights (assumed 10 lights maximum)
-    for (int i = 0; i < numLights; ++i) {
-        if (i >= lights.length()) break; // safety
-        Light light = lights[i];
-        vec3 lightDir;
-        float attenuation = 1.0;
-        float visibility;
-
-        if (light.positionOrDirection.w == 1.0) { // Point light
-            vec3 lightVec = light.positionOrDirection.xyz - hitPoint;
-            float distance = max(length(lightVec), 0.001);
-            lightDir = normalize(lightVec);
-            attenuation = light.power / (distance * distance);
-
-            // Check shadows for point lights
-            if (!shadowVisibility(hitPoint + lightDir * 0.001, lightDir, distance, visibility)) continue;
-        } else { // Directional light
-            lightDir = normalize(light.positionOrDirection.xyz);
-            attenuation = light.power;
-
-            if (!shadowVisibility(hitPoint + lightDir * 0.001, lightDir, 1e30, visibility)) continue;
-        }
-        attenuation *= visibility;
-
-        // Calculate shading terms
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        float NdotL = max(dot(normal, lightDir), 0.0);
-        float NdotV = max(dot(normal, viewDir), 0.0);
-
-        vec3 F = fresnelSchlick(max(dot(halfwayDir, viewDir), 0.0), F0);
-
-        float alpha = material.roughness * material.roughness;
-        float alpha2 = alpha * alpha;
-        float denom = (dot(normal, halfwayDir) * dot(normal, halfwayDir) * (alpha2 - 1.0) + 1.0);
-        float D = alpha2 / (3.14159 * denom * denom);
-
-        float k = (material.roughness + 1.0) * (material.roughness + 1.0) / 8.0;
-        float G = NdotV / (NdotV * (1.0 - k) + k);
-        G *= NdotL / (NdotL * (1.0 - k) + k);
-
-        float denomSpec = max(4.0 * NdotV * NdotL, 0.0001);
-        vec3 specular = (F * D * G) / denomSpec;
-
-        vec3 diffuse = (1.0 - F) * material.albedo * NdotL / 3.14159;
-
-        finalColor += max(vec3(0.0), (diffuse + specular) * light.color * attenuation);
-    }
-
-    return finalColor;
-}
-
 //------------------------------------------------------------------------------
 // Main path tracing loop
 //------------------------------------------------------------------------------
 void main() {
     vec2 uv = gl_FragCoord.xy / resolution;
-    vec2 seed = uv;
 
     vec3 color = vec3(0.0);
-    int maxBounces = uniformBounceBudget > 0 ? uniformBounceBudget : 5;
-    float currentIor = 1.0; // track medium IOR (air)
-    int numSamples = 1; // increase for better quality
+    int maxBounces = min(uniformBounceBudget > 0 ? uniformBounceBudget : 5, RZ_MAX_BOUNCES);
+    int numSamples = (accumulate && displayAccumulated) ? 0 : 1; // increase for better quality
 
     // BVH debug overlay variables
     float bvhWire = 0.0;
@@ -680,20 +271,24 @@ void main() {
     float tlasWire = 0.0, blasWire = 0.0;
     vec3 tlasColor = vec3(0.0), blasColor = vec3(0.0);
 
+#if RZ_DEBUG_OVERLAYS
     if (debugShowBVH) {
         overlayBVHWireframe(gl_FragCoord.xy, tlasWire, tlasColor, blasWire, blasColor);
     }
+#endif
 
     for (int samp = 0; samp < numSamples; ++samp) {
-        seed = uv * float(gl_FragCoord.x + gl_FragCoord.y + samp + 1.0);
-        Ray ray = calculateRay(uv, seed);
+        // Accumulated frames continue the pixel's sequence where the previous ones stopped
+        PathSampler sampler = pathSampler(gl_FragCoord.xy, sampleIndex * numSamples + samp);
+        Ray ray = calculateRay(uv, sample2D(sampler, DIM_CAMERA));
         vec3 currentOrigin = ray.origin;
         vec3 currentDirection = ray.direction;
         vec3 throughput = vec3(1.0);
+        float currentIor = 1.0; // track medium IOR (air), per path
         bool hitSomething = false;
 
-        for (int bounce = 0; bounce < maxBounces; ++bounce) {
-            vec2 tempseed = seed * float(bounce * bounce) * 12793.46 + float(bounce) * 1423.34;
+        for (int bounce = 0; bounce < RZ_MAX_BOUNCES; ++bounce) {
+            if (bounce >= maxBounces) break;
             vec3 hitPoint, hitNormal;
             int materialIndex = -1;
             int instanceIdx = -1;
@@ -703,75 +298,33 @@ void main() {
             // Use TLAS/BLAS traversal for intersection
             bool found = traverseTLAS(Ray(currentOrigin, currentDirection), closestT, hitPoint, hitNormal, materialIndex, instanceIdx);
             if (!found) {
-                // Skybox: blueish gradient, less bright
-                float t = 0.5 * (normalize(currentDirection).y + 1.0);
-                vec3 skyColor = mix(vec3(0.15, 0.25, 0.45), vec3(0.5, 0.7, 1.0), t); // deep blue to light blue
-                color += throughput * skyColor;
+                color += throughput * skyColor(currentDirection);
                 break;
             }
             hitSomething = true;
             hitMaterial = materials[materialIndex];
-            vec3 viewDir = normalize(camera.position - hitPoint);
-            // Only add explicit direct lighting on first bounce to avoid energy blow-up without MIS
-            if (bounce == 0) {
-                color += throughput * calculateLighting(hitPoint, hitNormal, hitMaterial, viewDir);
-            }
+            // Next-event estimation at every vertex; scatter importance samples the bounce
+            vec3 viewDir = -normalize(currentDirection);
+            color += throughput * calculateLighting(hitPoint, hitNormal, hitMaterial, viewDir, sampler, bounce);
 
-            float randVal = rand(tempseed + vec2(float(samp), float(bounce)));
-
-            // Transparent / refractive handling
-            if (hitMaterial.transparency > 0.0) {
-                // Deterministic dielectric: always refract (unless TIR) and rely on direct spec for reflection.
-                bool entering = dot(-currentDirection, hitNormal) > 0.0;
-                vec3 N = entering ? hitNormal : -hitNormal; // outward normal relative to current medium
-                float extIor = currentIor;
-                float nextIor = entering ? hitMaterial.ior : 1.0;
-                float eta = extIor / nextIor;
-                float cosi = clamp(dot(-currentDirection, N), 0.0, 1.0);
-                float F0 = pow((extIor - nextIor) / (extIor + nextIor), 2.0);
-                float fresnel = F0 + (1.0 - F0) * pow(1.0 - cosi, 5.0);
-                vec3 refr;
-                bool ok = refractDir(currentDirection, N, eta, refr);
-                if (!ok) { // Total internal reflection: fallback reflect only
-                    currentDirection = reflectRay(currentDirection, N);
-                    // Slight energy trim
-                    throughput *= vec3(0.98);
-                } else {
-                    // Apply transmission weighting; leave reflection handled by spec direct term
-                    currentDirection = refr;
-                    currentIor = nextIor;
-                    vec3 tint = mix(vec3(1.0), hitMaterial.albedo, hitMaterial.transparency);
-                    vec3 transmitWeight = tint * hitMaterial.transparency * (1.0 - fresnel);
-                    throughput *= clamp(transmitWeight, vec3(0.0), vec3(1.0));
-                }
-                // Advanced: could add chromatic dispersion here by varying IOR per channel
-            } else {
-                // Opaque: reflect vs diffuse based on reflectivity
-                if (randVal < hitMaterial.reflectivity) {
-                    currentDirection = reflectRay(currentDirection, hitNormal);
-                    throughput *= vec3(0.95); // slight loss to prevent runaway brightness
-                } else {
-                    currentDirection = randomHemisphereDirection(hitNormal, tempseed);
-                    throughput *= hitMaterial.albedo * 0.4; // lambertian attenuation
-                }
-            }
-            // Offset origin based on direction vs surface normal to avoid self-intersections, especially exiting glass
-            vec3 offsetNormal = hitNormal;
-            float pushDir = dot(currentDirection, hitNormal) > 0.0 ? 1.0 : -1.0;
-            currentOrigin = hitPoint + offsetNormal * pushDir * 0.003;
-
-            // Russian roulette termination after a few bounces
-            if (bounce > 2) {
-                float p = max(throughput.r, max(throughput.g, throughput.b));
-                if (rand(tempseed + vec2(float(samp), float(bounce))) > p)
-                    break;
-                throughput /= p;
+            if (!scatter(currentOrigin, currentDirection, throughput, currentIor, hitPoint, hitNormal, hitMaterial, sampler, bounce)) {
+                break;
             }
         }
     }
-    color /= float(numSamples);
+    color /= float(max(numSamples, 1));
     color = clamp(color, 0.0, 1.0);
+    if (accumulate) {
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+        vec3 mean = imageLoad(accumulationImage, pixel).rgb;
+        if (numSamples > 0) {
+            mean = sampleIndex > 0 ? mix(mean, color, 1.0 / float(sampleIndex + 1)) : color;
+            imageStore(accumulationImage, pixel, vec4(mean, 1.0));
+        }
+        color = mean;
+    }
 
+#if RZ_DEBUG_OVERLAYS
     // Overlay BVH wireframe if enabled
     if (debugShowBVH && (tlasWire > 0.0 || blasWire > 0.0)) {
         color = mix(color, tlasColor, 0.5 * tlasWire);
@@ -801,22 +354,27 @@ void main() {
             }
         }
     }
+#endif
 
+#if RZ_FPS_OVERLAY
     // FPS overlay (top-left, white text, black bg)
-    float margin = 8.0;
-    vec2 fpsPos = vec2(margin, resolution.y - margin - fontHeight * 2.0); // top-left
-    float fpsScale = 2.0; // 2x font size
-    vec3 fpsCol = drawFpsString(gl_FragCoord.xy, fpsPos, fpsScale, uniformFps, vec3(1.0), color);
-    float anyFps = 0.0;
-    for (int y = 0; y < fontHeight; ++y) {
-        for (int x = 0; x < fontWidth * 6; ++x) {
-            vec2 p = fpsPos + vec2(x, y) * fpsScale;
-            if (abs(gl_FragCoord.x - p.x) < 1.0 && abs(gl_FragCoord.y - p.y) < 1.0) {
-                anyFps = 1.0;
+    if (!hideOverlay) {
+        float margin = 8.0;
+        vec2 fpsPos = vec2(margin, resolution.y - margin - fontHeight * 2.0); // top-left
+        float fpsScale = 2.0; // 2x font size
+        vec3 fpsCol = drawFpsString(gl_FragCoord.xy, fpsPos, fpsScale, uniformFps, vec3(1.0), color);
+        float anyFps = 0.0;
+        for (int y = 0; y < fontHeight; ++y) {
+            for (int x = 0; x < fontWidth * 6; ++x) {
+                vec2 p = fpsPos + vec2(x, y) * fpsScale;
+                if (abs(gl_FragCoord.x - p.x) < 1.0 && abs(gl_FragCoord.y - p.y) < 1.0) {
+                    anyFps = 1.0;
+                }
             }
         }
+        color = mix(color, fpsCol, anyFps);
     }
-    color = mix(color, fpsCol, anyFps);
+#endif
 
     FragColor = vec4(color, 1.0);
 }
@@ -0,0 +1,886 @@
+// Path tracer code shared by fragment_shader.glsl and the wavefront compute kernels: scene
+// buffers, sampling, TLAS/BLAS traversal and direct lighting. Included after #version.
+
+// Specialization defines, injected by the loader for scene-specific variants (see
+// pathTracerDefines in main.cpp). The defaults give the generic kernel, which decides at run time.
+#ifndef RZ_TRANSPARENCY
+#define RZ_TRANSPARENCY 1     // 0: no material is transparent, so shadow rays stop at the first hit
+#endif
+#ifndef RZ_LIGHT_SAMPLING
+#define RZ_LIGHT_SAMPLING -1  // 0: evaluate every light, 1: sample lightSamples point lights, -1: decide per call
+#endif
+#ifndef RZ_MAX_LIGHTS
+#define RZ_MAX_LIGHTS 65536   // bound of the lighting loop: lights evaluated per shading point, rounded up
+#endif
+#ifndef RZ_MAX_BOUNCES
+#define RZ_MAX_BOUNCES 1024   // bound of the bounce loop; the bounce budget is clamped to it
+#endif
+#ifndef RZ_BLAS_STACK_SIZE
+#define RZ_BLAS_STACK_SIZE 64 // entries of the BVH4/BVH8 BLAS traversal stacks, sized from the uploaded trees
+#endif
+
+struct Camera {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 invViewMatrix;
+    mat4 invProjectionMatrix;
+    vec3 position;
+};
+
+// Per-frame constants, published once per frame into a ring of uniform buffer slots
+// (FrameConstants.h mirrors the std140 layout)
+layout(std140, binding = 0) uniform FrameConstants {
+    Camera camera;
+    vec2 resolution;
+    int numLights; // actual number of lights in SSBO
+    int lightSamples; // shadow rays per shading point once there are more point lights; <=0 evaluates every light
+    int uniformBounceBudget; // <=0 uses default bounce count
+    int blasNodeWidth; // 2 = binary BLAS nodes, 4/8 = collapsed wide nodes
+    bool blasNodeQuantized;
+};
+
+struct Material {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float reflectivity;
+    float transparency;
+    float ior;
+};
+
+struct Light {
+    vec4 positionOrDirection; // w==1.0 for point lights, w==0.0 for directional lights
+    vec3 color;
+    float power;
+};
+
+struct BVHNode {
+    vec3 boundsMin;
+    int leftFirst;
+    vec3 boundsMax;
+    int count;
+};
+
+// Indexed geometry: three global vertex indices per triangle, tightly packed vertex positions
+// and one material per triangle
+layout(std430, binding = 0) buffer TriangleBuffer {
+    uint triangleCorners[];
+};
+
+layout(std430, binding = 12) buffer VertexBuffer {
+    float vertexPositions[];
+};
+
+layout(std430, binding = 13) buffer TriangleMaterialBuffer {
+    int triangleMaterials[];
+};
+
+layout(std430, binding = 1) buffer MaterialBuffer {
+    Material materials[];
+};
+
+layout(std430, binding = 2) buffer LightBuffer {
+    Light lights[];
+};
+
+// Power-weighted alias table over the point lights (LightTable.h). x = point lights in the
+// table, y = directional lights, whose entries follow the table
+struct LightAliasEntry {
+    float threshold; // keep this slot when the pick's fraction is below it, else take alias
+    int alias;
+    float pdf;       // probability of picking light
+    int light;       // index into lights[]
+};
+
+layout(std430, binding = 3) buffer LightTableBuffer {
+    ivec4 lightTableHeader;
+    LightAliasEntry lightTable[];
+};
+
+// Generator matrices of the first SOBOL_DIMENSIONS Sobol dimensions, 32 columns each
+// (SobolSampler.h), uploaded once at startup
+layout(std430, binding = 4) buffer SobolBuffer {
+    uint sobolMatrices[];
+};
+
+// --- TLAS/BLAS two-level BVH support ---
+
+// TLAS (top-level BVH over mesh instances)
+layout(std430, binding = 5) buffer TLASNodeBuffer {
+    BVHNode tlasNodes[];
+};
+layout(std430, binding = 6) buffer TLASTriIdxBuffer {
+    int tlasTriIndices[];
+};
+
+// BLAS (all mesh BVHs concatenated)
+layout(std430, binding = 7) buffer BLASNodeBuffer {
+    BVHNode blasNodes[];
+};
+layout(std430, binding = 8) buffer BLASTriIdxBuffer {
+    int blasTriIndices[];
+};
+// Wide views of the BLAS node buffer, used when blasNodeWidth is 4 or 8: blasNodeWidth child
+// slots per node, or 4 + 3 * blasNodeWidth words per node when quantized (see WideBVH)
+layout(std430, binding = 10) buffer BLASWideNodeBuffer {
+    BVHNode blasWideSlots[];
+};
+layout(std430, binding = 11) buffer BLASQuantizedNodeBuffer {
+    uint blasQuantizedWords[];
+};
+
+// BVHInstance buffer (maps TLAS leaves to BLAS offsets and mesh index)
+struct BVHInstance {
+    int blasNodeOffset;
+    int blasTriOffset;
+    int meshIndex;
+    int globalTriOffset; // Offset into global triangle buffer (NEW)
+    mat4 transform; // (optional, not used if identity)
+    mat4 inverseTransform;
+};
+layout(std430, binding = 9) buffer BVHInstanceBuffer {
+    BVHInstance bvhInstances[];
+};
+
+
+// Constants
+const vec3 ambientLightColor = vec3(0.05, 0.05, 0.05);
+
+// Ray structure
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
+//------------------------------------------------------------------------------
+// Sampling: per-pixel Owen-scrambled Sobol sequences, as SobolSampler.cpp
+//------------------------------------------------------------------------------
+const int SOBOL_DIMENSIONS = 4;
+
+// Dimensions of a path's sample. Each bounce owns DIMS_PER_BOUNCE of them, so a dimension means
+// the same decision in every sample and the decisions of one bounce stay stratified together.
+const int DIM_CAMERA = 0;        // pixel jitter (2D)
+const int DIMS_PER_BOUNCE = 8;
+const int DIM_DIRECTION = 0;     // scattered direction (2D)
+const int DIM_LOBE = 2;          // mirror or BRDF
+const int DIM_ROULETTE = 3;
+const int DIM_LIGHT = 4;         // offset of the stratified light picks
+const int DIM_BRDF_LOBE = 5;     // cosine or GGX sampling of the BRDF
+
+int bounceDimension(int bounce, int offset) {
+    return DIMS_PER_BOUNCE * (bounce + 1) + offset;
+}
+
+uint hashUint(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Owen scramble: the Laine-Karras permutation applied to the bit-reversed value
+uint nestedUniformScramble(uint x, uint seed) {
+    x = bitfieldReverse(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return bitfieldReverse(x);
+}
+
+// Sample index of a path in its pixel's sequence
+struct PathSampler {
+    uint pixel; // per-pixel seed
+    uint index;
+};
+
+PathSampler pathSampler(vec2 fragCoord, int index) {
+    uvec2 p = uvec2(fragCoord);
+    return PathSampler(hashUint(p.x ^ hashUint(p.y)), uint(index));
+}
+
+// Every SOBOL_DIMENSIONS dimensions form a set whose point order is shuffled with its own seed,
+// which decorrelates the sets; within a set each dimension gets its own Owen scramble
+float sampleDimension(PathSampler sampler, int dimension) {
+    uint setSeed = hashUint(sampler.pixel ^ hashUint(uint(dimension / SOBOL_DIMENSIONS)));
+    int d = dimension % SOBOL_DIMENSIONS;
+    uint x = 0u;
+    int bit = 0;
+    for (uint i = nestedUniformScramble(sampler.index, setSeed); i != 0u; i >>= 1) {
+        if ((i & 1u) != 0u) x ^= sobolMatrices[d * 32 + bit];
+        ++bit;
+    }
+    x = nestedUniformScramble(x, hashUint(setSeed + uint(d)));
+    return float(x >> 8) * (1.0 / 16777216.0);
+}
+
+vec2 sample2D(PathSampler sampler, int dimension) {
+    return vec2(sampleDimension(sampler, dimension), sampleDimension(sampler, dimension + 1));
+}
+
+//------------------------------------------------------------------------------
+// Utility functions
+//------------------------------------------------------------------------------
+// Rotates dir from a frame where z is normal into world space
+vec3 tangentToWorld(vec3 normal, vec3 dir) {
+    vec3 up = abs(normal.y) < 0.99 ? vec3(0,1,0) : vec3(1,0,0);
+    vec3 tangent = normalize(cross(up, normal));
+    vec3 bitangent = cross(normal, tangent);
+    return normalize(tangent * dir.x + bitangent * dir.y + normal * dir.z);
+}
+
+// Cosine-weighted direction about normal for a 2D sample
+vec3 randomHemisphereDirection(vec3 normal, vec2 xi) {
+    float u = xi.x;
+    float v = xi.y;
+    float theta = acos(sqrt(1.0 - u));
+    float phi = 2.0 * 3.14159 * v;
+    return tangentToWorld(normal, vec3(sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta)));
+}
+
+Ray calculateRay(vec2 uv, vec2 xi) {
+    vec2 jitter = xi * 0.00002;
+    uv += jitter;
+    vec4 ray_clip = vec4(uv * 2.0 - 1.0, -1.0, 1.0);
+    vec4 ray_eye = camera.invProjectionMatrix * ray_clip;
+    ray_eye = vec4(ray_eye.xy, -1.0, 0.0);
+    vec3 ray_world = (camera.invViewMatrix * ray_eye).xyz;
+    return Ray(camera.position, normalize(ray_world));
+}
+
+//------------------------------------------------------------------------------
+// Intersection functions for TLAS/BLAS
+//------------------------------------------------------------------------------
+
+// Ray-AABB intersection
+bool intersectAABB(vec3 rayOrig, vec3 rayDirInv, vec3 bmin, vec3 bmax, out float tmin, out float tmax) {
+    vec3 t0 = (bmin - rayOrig) * rayDirInv;
+    vec3 t1 = (bmax - rayOrig) * rayDirInv;
+    vec3 tsmaller = min(t0, t1);
+    vec3 tbigger = max(t0, t1);
+    tmin = max(max(tsmaller.x, tsmaller.y), tsmaller.z);
+    tmax = min(min(tbigger.x, tbigger.y), tbigger.z);
+    return tmax >= max(tmin, 0.0);
+}
+
+vec3 fetchVertex(uint index) {
+    return vec3(vertexPositions[3u * index], vertexPositions[3u * index + 1u], vertexPositions[3u * index + 2u]);
+}
+
+// Möller–Trumbore algorithm for triangle intersection; distance only, for shadow rays
+bool hitTriangleDistance(vec3 v0, vec3 edge1, vec3 edge2, Ray ray, out float tHit) {
+    vec3 h = cross(ray.direction, edge2);
+    float a = dot(edge1, h);
+    if (abs(a) < 0.0001)
+        return false;
+    float f = 1.0 / a;
+    vec3 s = ray.origin - v0;
+    float u = f * dot(s, h);
+    if (u < 0.0 || u > 1.0)
+        return false;
+    vec3 q = cross(s, edge1);
+    float v = f * dot(ray.direction, q);
+    if (v < 0.0 || u + v > 1.0)
+        return false;
+    tHit = f * dot(edge2, q);
+    return tHit > 0.0001;
+}
+
+bool hitTriangle(vec3 v0, vec3 v1, vec3 v2, Ray ray, out float tHit, out vec3 hitPoint, out vec3 normal) {
+    vec3 edge1 = v1 - v0;
+    vec3 edge2 = v2 - v0;
+    if (!hitTriangleDistance(v0, edge1, edge2, ray, tHit))
+        return false;
+    hitPoint = ray.origin + ray.direction * tHit;
+    normal = normalize(cross(edge1, edge2));
+    return true;
+}
+
+// Intersect the triangles of a BLAS leaf, keeping the closest hit
+void intersectBLASLeaf(Ray ray, int first, int count, int blasTriOffset, int globalTriOffset, inout float tHit, inout vec3 hitPoint, inout vec3 normal, inout int materialIndex, inout bool hit) {
+    for (int i = 0; i < count; ++i) {
+        int triIdx = globalTriOffset + blasTriIndices[blasTriOffset + first + i];
+        float t;
+        vec3 tempHit, tempNormal;
+        vec3 v0 = fetchVertex(triangleCorners[3 * triIdx]);
+        vec3 v1 = fetchVertex(triangleCorners[3 * triIdx + 1]);
+        vec3 v2 = fetchVertex(triangleCorners[3 * triIdx + 2]);
+        if (hitTriangle(v0, v1, v2, ray, t, tempHit, tempNormal)) {
+            if (t < tHit) {
+                tHit = t;
+                hitPoint = tempHit;
+                normal = tempNormal;
+                materialIndex = triangleMaterials[triIdx];
+                hit = true;
+            }
+        }
+    }
+}
+
+// Traverse binary BLAS nodes for a mesh instance
+bool traverseBLASBinary(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex) {
+    tHit = 1e30;
+    bool hit = false;
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node of this BLAS
+    vec3 invDir = 1.0 / ray.direction;
+    while (stackPtr > 0) {
+        int nidx = stack[--stackPtr];
+        BVHNode node = blasNodes[blasNodeOffset + nidx];
+        float tmin, tmax;
+        if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > tHit)
+            continue;
+        if (node.count > 0) { // leaf
+            intersectBLASLeaf(ray, node.leftFirst, node.count, blasTriOffset, globalTriOffset, tHit, hitPoint, normal, materialIndex, hit);
+        } else { // internal
+            stack[stackPtr++] = node.leftFirst;
+            stack[stackPtr++] = node.leftFirst + 1;
+        }
+    }
+    return hit;
+}
+
+// Traverse BVH4/BVH8 BLAS nodes: one node fetch tests all children. The root's own bounds
+// are not stored; the TLAS already tested the instance's world bounds.
+bool traverseBLASWide(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex) {
+    tHit = 1e30;
+    bool hit = false;
+    int stack[RZ_BLAS_STACK_SIZE];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node of this BLAS
+    vec3 invDir = 1.0 / ray.direction;
+    int wordsPerNode = 4 + 3 * blasNodeWidth;
+    while (stackPtr > 0) {
+        int nidx = blasNodeOffset + stack[--stackPtr];
+        int base = nidx * wordsPerNode;
+        vec3 origin = vec3(0.0);
+        vec3 scale = vec3(1.0);
+        if (blasNodeQuantized) {
+            // Children are stored relative to the node origin in power-of-two steps
+            origin = uintBitsToFloat(uvec3(blasQuantizedWords[base], blasQuantizedWords[base + 1], blasQuantizedWords[base + 2]));
+            uint exponents = blasQuantizedWords[base + 3];
+            scale = uintBitsToFloat((uvec3(exponents, exponents >> 8u, exponents >> 16u) & 0xFFu) << 23u);
+        }
+        for (int c = 0; c < blasNodeWidth; ++c) {
+            vec3 bmin, bmax;
+            int count, ref;
+            if (blasNodeQuantized) {
+                uint w0 = blasQuantizedWords[base + 4 + 3 * c];
+                uint w1 = blasQuantizedWords[base + 5 + 3 * c];
+                uint countField = w1 >> 16u;
+                if (countField == 0u) break; // unused slots follow the used ones
+                bmin = origin + vec3(uvec3(w0, w0 >> 8u, w0 >> 16u) & 0xFFu) * scale;
+                bmax = origin + vec3(uvec3(w0 >> 24u, w1, w1 >> 8u) & 0xFFu) * scale;
+                count = countField == 0xFFFFu ? -1 : int(countField);
+                ref = int(blasQuantizedWords[base + 6 + 3 * c]);
+            } else {
+                BVHNode slot = blasWideSlots[nidx * blasNodeWidth + c];
+                if (slot.count == 0) break;
+                bmin = slot.boundsMin;
+                bmax = slot.boundsMax;
+                count = slot.count;
+                ref = slot.leftFirst;
+            }
+            float tmin, tmax;
+            if (!intersectAABB(ray.origin, invDir, bmin, bmax, tmin, tmax) || tmin > tHit)
+                continue;
+            if (count > 0) { // leaf
+                intersectBLASLeaf(ray, ref, count, blasTriOffset, globalTriOffset, tHit, hitPoint, normal, materialIndex, hit);
+            } else if (stackPtr < RZ_BLAS_STACK_SIZE) { // internal; the loader sizes the stack so this holds
+                stack[stackPtr++] = ref;
+            }
+        }
+    }
+    return hit;
+}
+
+// Traverse BLAS for a mesh instance in the node format chosen at startup
+bool traverseBLAS(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex) {
+    if (blasNodeWidth <= 2) {
+        return traverseBLASBinary(ray, blasNodeOffset, blasTriOffset, globalTriOffset, tHit, hitPoint, normal, materialIndex);
+    }
+    return traverseBLASWide(ray, blasNodeOffset, blasTriOffset, globalTriOffset, tHit, hitPoint, normal, materialIndex);
+}
+
+// Traverse TLAS, return closest hit and mesh instance index
+bool traverseTLAS(Ray ray, out float tHit, out vec3 hitPoint, out vec3 normal, out int materialIndex, out int instanceIdx) {
+    tHit = 1e30;
+    bool hit = false;
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node
+    vec3 invDir = 1.0 / ray.direction;
+    while (stackPtr > 0) {
+        int nidx = stack[--stackPtr];
+        BVHNode node = tlasNodes[nidx];
+        float tmin, tmax;
+        if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > tHit)
+            continue;
+        if (node.count > 0) { // leaf: contains mesh instance indices
+            for (int i = 0; i < node.count; ++i) {
+                int instIdx = tlasTriIndices[node.leftFirst + i];
+                BVHInstance inst = bvhInstances[instIdx];
+                // Transform ray to mesh local space using inverse(instance.transform)
+                mat4 invTransform = inst.inverseTransform;
+                vec3 localOrigin = vec3(invTransform * vec4(ray.origin, 1.0));
+                vec3 localDir = normalize(vec3(invTransform * vec4(ray.direction, 0.0)));
+                Ray localRay = Ray(localOrigin, localDir);
+                float tLocal;
+                vec3 localHit, localNormal;
+                int tempMat;
+                if (traverseBLAS(localRay, inst.blasNodeOffset, inst.blasTriOffset, inst.globalTriOffset, tLocal, localHit, localNormal, tempMat)) {
+                    // Transform hit point and normal back to world space
+                    vec3 worldHit = vec3(inst.transform * vec4(localHit, 1.0));
+                    float tWorld = length(worldHit - ray.origin); // world-space t
+                    if (tWorld < tHit) {
+                        tHit = tWorld;
+                        hitPoint = worldHit;
+                        mat3 normalMatrix = mat3(transpose(inst.inverseTransform));
+                        normal = normalize(normalMatrix * localNormal);
+                        materialIndex = tempMat;
+                        instanceIdx = instIdx;
+                        hit = true;
+                    }
+                }
+            }
+        } else { // internal
+            stack[stackPtr++] = node.leftFirst;
+            stack[stackPtr++] = node.leftFirst + 1;
+        }
+    }
+    return hit;
+}
+
+//------------------------------------------------------------------------------
+// Any-hit traversal for shadow rays
+//------------------------------------------------------------------------------
+// Shadow rays need no closest hit: every surface before the light scales the transmitted light by
+// its transparency, in any order, and opaque surfaces (transparency 0) end the query at once.
+// Light below this fraction counts as fully blocked.
+const float SHADOW_CUTOFF = 0.05;
+
+// Scales transmittance by every triangle of a BLAS leaf hit before tMax; true once the ray is blocked
+bool occludeBLASLeaf(Ray ray, int first, int count, int blasTriOffset, int globalTriOffset, float tMax, inout float transmittance) {
+    for (int i = 0; i < count; ++i) {
+        int triIdx = globalTriOffset + blasTriIndices[blasTriOffset + first + i];
+        vec3 v0 = fetchVertex(triangleCorners[3 * triIdx]);
+        vec3 v1 = fetchVertex(triangleCorners[3 * triIdx + 1]);
+        vec3 v2 = fetchVertex(triangleCorners[3 * triIdx + 2]);
+        float t;
+        if (hitTriangleDistance(v0, v1 - v0, v2 - v0, ray, t) && t < tMax) {
+#if RZ_TRANSPARENCY
+            transmittance *= materials[triangleMaterials[triIdx]].transparency;
+            if (transmittance <= SHADOW_CUTOFF) return true;
+#else
+            transmittance = 0.0;
+            return true;
+#endif
+        }
+    }
+    return false;
+}
+
+bool occludeBLASBinary(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, float tMax, inout float transmittance) {
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node of this BLAS
+    vec3 invDir = 1.0 / ray.direction;
+    while (stackPtr > 0) {
+        int nidx = stack[--stackPtr];
+        BVHNode node = blasNodes[blasNodeOffset + nidx];
+        float tmin, tmax;
+        if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > tMax)
+            continue;
+        if (node.count > 0) { // leaf
+            if (occludeBLASLeaf(ray, node.leftFirst, node.count, blasTriOffset, globalTriOffset, tMax, transmittance)) return true;
+        } else { // internal
+            stack[stackPtr++] = node.leftFirst;
+            stack[stackPtr++] = node.leftFirst + 1;
+        }
+    }
+    return false;
+}
+
+// Wide node decoding as in traverseBLASWide
+bool occludeBLASWide(Ray ray, int blasNodeOffset, int blasTriOffset, int globalTriOffset, float tMax, inout float transmittance) {
+    int stack[RZ_BLAS_STACK_SIZE];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node of this BLAS
+    vec3 invDir = 1.0 / ray.direction;
+    int wordsPerNode = 4 + 3 * blasNodeWidth;
+    while (stackPtr > 0) {
+        int nidx = blasNodeOffset + stack[--stackPtr];
+        int base = nidx * wordsPerNode;
+        vec3 origin = vec3(0.0);
+        vec3 scale = vec3(1.0);
+        if (blasNodeQuantized) {
+            origin = uintBitsToFloat(uvec3(blasQuantizedWords[base], blasQuantizedWords[base + 1], blasQuantizedWords[base + 2]));
+            uint exponents = blasQuantizedWords[base + 3];
+            scale = uintBitsToFloat((uvec3(exponents, exponents >> 8u, exponents >> 16u) & 0xFFu) << 23u);
+        }
+        for (int c = 0; c < blasNodeWidth; ++c) {
+            vec3 bmin, bmax;
+            int count, ref;
+            if (blasNodeQuantized) {
+                uint w0 = blasQuantizedWords[base + 4 + 3 * c];
+                uint w1 = blasQuantizedWords[base + 5 + 3 * c];
+                uint countField = w1 >> 16u;
+                if (countField == 0u) break;
+                bmin = origin + vec3(uvec3(w0, w0 >> 8u, w0 >> 16u) & 0xFFu) * scale;
+                bmax = origin + vec3(uvec3(w0 >> 24u, w1, w1 >> 8u) & 0xFFu) * scale;
+                count = countField == 0xFFFFu ? -1 : int(countField);
+                ref = int(blasQuantizedWords[base + 6 + 3 * c]);
+            } else {
+                BVHNode slot = blasWideSlots[nidx * blasNodeWidth + c];
+                if (slot.count == 0) break;
+                bmin = slot.boundsMin;
+                bmax = slot.boundsMax;
+                count = slot.count;
+                ref = slot.leftFirst;
+            }
+            float tmin, tmax;
+            if (!intersectAABB(ray.origin, invDir, bmin, bmax, tmin, tmax) || tmin > tMax)
+                continue;
+            if (count > 0) { // leaf
+                if (occludeBLASLeaf(ray, ref, count, blasTriOffset, globalTriOffset, tMax, transmittance)) return true;
+            } else if (stackPtr < RZ_BLAS_STACK_SIZE) { // internal
+                stack[stackPtr++] = ref;
+            }
+        }
+    }
+    return false;
+}
+
+// Fraction of light that reaches maxDist along dir from origin, in one TLAS/BLAS traversal
+float shadowTransmittance(vec3 origin, vec3 dir, float maxDist) {
+    float transmittance = 1.0;
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0; // root node
+    vec3 invDir = 1.0 / dir;
+    while (stackPtr > 0) {
+        int nidx = stack[--stackPtr];
+        BVHNode node = tlasNodes[nidx];
+        float tmin, tmax;
+        if (!intersectAABB(origin, invDir, node.boundsMin, node.boundsMax, tmin, tmax) || tmin > maxDist)
+            continue;
+        if (node.count > 0) { // leaf: contains mesh instance indices
+            for (int i = 0; i < node.count; ++i) {
+                BVHInstance inst = bvhInstances[tlasTriIndices[node.leftFirst + i]];
+                vec3 localOrigin = vec3(inst.inverseTransform * vec4(origin, 1.0));
+                vec3 localDir = vec3(inst.inverseTransform * vec4(dir, 0.0));
+                // The local ray is normalized, so world distances scale by the length of localDir
+                float localMax = maxDist * length(localDir);
+                Ray localRay = Ray(localOrigin, normalize(localDir));
+                bool blocked = blasNodeWidth <= 2
+                    ? occludeBLASBinary(localRay, inst.blasNodeOffset, inst.blasTriOffset, inst.globalTriOffset, localMax, transmittance)
+                    : occludeBLASWide(localRay, inst.blasNodeOffset, inst.blasTriOffset, inst.globalTriOffset, localMax, transmittance);
+                if (blocked) return 0.0;
+            }
+        } else { // internal
+            stack[stackPtr++] = node.leftFirst;
+            stack[stackPtr++] = node.leftFirst + 1;
+        }
+    }
+    return transmittance;
+}
+
+// Transparent-aware shadow query: false when the light is blocked, otherwise visibility is the
+// fraction transmitted through transparent surfaces
+bool shadowVisibility(vec3 origin, vec3 dir, float maxDist, out float visibility) {
+    visibility = shadowTransmittance(origin, dir, maxDist);
+    return visibility > SHADOW_CUTOFF;
+}
+
+//------------------------------------------------------------------------------
+// Lighting and material functions
+//------------------------------------------------------------------------------
+vec3 fresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
+}
+
+vec3 reflectRay(vec3 incident, vec3 normal) {
+    return incident - 2.0 * dot(incident, normal) * normal;
+}
+
+vec3 refractRay(vec3 incident, vec3 normal, float ior) {
+    float cosi = clamp(dot(incident, normal), -1.0, 1.0);
+    float etai = 1.0, etat = ior;
+    vec3 n = normal;
+    if (cosi < 0.0) {
+        cosi = -cosi;
+    } else {
+        float temp = etai;
+        etai = etat;
+        etat = temp;
+        n = -normal;
+    }
+    float eta = etai / etat;
+    float k = 1.0 - eta * eta * (1.0 - cosi * cosi);
+    return (k < 0.0) ? reflectRay(incident, normal) : eta * incident + (eta * cosi - sqrt(k)) * n;
+}
+
+bool refractDir(vec3 incident, vec3 normal, float eta, out vec3 refr) {
+    // incident assumed normalized, normal points against incident when entering
+    float cosi = clamp(dot(-incident, normal), -1.0, 1.0);
+    float sint2 = max(0.0, 1.0 - cosi * cosi);
+    float eta2 = eta * eta;
+    float k = 1.0 - eta2 * sint2;
+    if (k < 0.0) return false; // total internal reflection
+    refr = normalize(eta * incident + (eta * cosi - sqrt(k)) * normal);
+    return true;
+}
+
+// Opaque BRDF: Lambert diffuse plus a GGX specular lobe with Schlick Fresnel and Smith-Schlick
+// masking. Direct lighting and the sampled bounce both use it, so they estimate one integrand.
+float opaqueAlpha(Material material) {
+    float rough = max(material.roughness, 0.02);
+    return rough * rough;
+}
+
+float ggxD(float NdotH, float alpha) {
+    float alpha2 = alpha * alpha;
+    float denom = NdotH * NdotH * (alpha2 - 1.0) + 1.0;
+    return alpha2 / (3.14159 * denom * denom);
+}
+
+// BRDF times cos(theta) toward L; V and L point away from the surface
+vec3 opaqueBRDFCos(vec3 N, vec3 V, vec3 L, Material material) {
+    float NdotL = dot(N, L);
+    if (NdotL <= 0.0) return vec3(0.0);
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 H = normalize(L + V);
+    vec3 F0 = mix(vec3(0.04), material.albedo, material.metallic);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+    float D = ggxD(max(dot(N, H), 0.0), opaqueAlpha(material));
+    float rough = max(material.roughness, 0.02);
+    float k = (rough + 1.0) * (rough + 1.0) / 8.0;
+    float G = NdotV / (NdotV * (1.0 - k) + k) * (NdotL / (NdotL * (1.0 - k) + k));
+    vec3 specular = (F * D * G) / max(4.0 * NdotV * NdotL, 0.0001);
+    vec3 diffuse = (1.0 - F) * material.albedo / 3.14159;
+    return max(vec3(0.0), (diffuse + specular) * NdotL);
+}
+
+// Probability of sampling the GGX lobe instead of the cosine lobe: the specular share of the
+// reflectance seen from V, kept away from 0 and 1 so either strategy covers the other's misses
+float specularLobeProbability(vec3 N, vec3 V, Material material) {
+    vec3 F0 = mix(vec3(0.04), material.albedo, material.metallic);
+    vec3 F = fresnelSchlick(max(dot(N, V), 0.0), F0);
+    const vec3 luminance = vec3(0.2126, 0.7152, 0.0722);
+    float specular = dot(F, luminance);
+    float diffuse = dot((1.0 - F) * material.albedo, luminance);
+    return clamp(specular / max(specular + diffuse, 1e-4), 0.1, 0.9);
+}
+
+// Density of L under the one-sample mixture of cosine and GGX sampling. Dividing by the mixture
+// density is the balance heuristic over the two strategies.
+float opaqueBRDFPdf(vec3 N, vec3 V, vec3 L, Material material, float specularProbability) {
+    float NdotL = dot(N, L);
+    if (NdotL <= 0.0) return 0.0;
+    vec3 H = normalize(L + V);
+    float NdotH = max(dot(N, H), 0.0);
+    float ggxPdf = ggxD(NdotH, opaqueAlpha(material)) * NdotH / max(4.0 * dot(H, V), 1e-4);
+    return mix(NdotL / 3.14159, ggxPdf, specularProbability);
+}
+
+// Samples a direction from the mixture: lobe below specularProbability reflects V about a GGX
+// half vector, anything else takes a cosine-weighted direction. May return a direction below
+// the surface, whose density is 0.
+vec3 sampleOpaqueBRDF(vec3 N, vec3 V, Material material, float specularProbability, float lobe, vec2 xi) {
+    if (lobe >= specularProbability) return randomHemisphereDirection(N, xi);
+    float alpha = opaqueAlpha(material);
+    float cosTheta = sqrt((1.0 - xi.x) / (1.0 + (alpha * alpha - 1.0) * xi.x));
+    float sinTheta = sqrt(max(0.0, 1.0 - cosTheta * cosTheta));
+    float phi = 2.0 * 3.14159 * xi.y;
+    vec3 H = tangentToWorld(N, vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta));
+    return reflect(-V, H);
+}
+
+// Contribution of one light at a shading point, shadowed by an any-hit ray
+vec3 directLight(Light light, vec3 hitPoint, vec3 normal, Material material, vec3 viewDir) {
+#if RZ_TRANSPARENCY
+    // For transparent dielectrics: compute only specular reflection lobe (no diffuse)
+    if (material.transparency > 0.0) {
+        vec3 F0 = vec3(pow((1.0 - material.ior) / (1.0 + material.ior), 2.0));
+        vec3 L; float attenuation; float visibility;
+        if (light.positionOrDirection.w == 1.0) {
+            vec3 lv = light.positionOrDirection.xyz - hitPoint;
+            float dist = max(length(lv), 0.001);
+            L = lv / dist;
+            attenuation = light.power / (dist * dist);
+            if (!shadowVisibility(hitPoint + L * 0.001, L, dist, visibility)) return vec3(0.0);
+        } else {
+            L = normalize(light.positionOrDirection.xyz);
+            attenuation = light.power;
+            if (!shadowVisibility(hitPoint + L * 0.001, L, 1e30, visibility)) return vec3(0.0);
+        }
+        attenuation *= visibility;
+        float NdotL = max(dot(normal, L), 0.0);
+        if (NdotL <= 0.0) return vec3(0.0);
+        vec3 H = normalize(L + viewDir);
+        float NdotH = max(dot(normal, H), 0.0);
+        float cosTheta = max(dot(H, viewDir), 0.0);
+        vec3 F = fresnelSchlick(cosTheta, F0);
+        float rough = max(material.roughness, 0.02);
+        float a = rough * rough;
+        float a2 = a * a;
+        float dDen = (NdotH * NdotH) * (a2 - 1.0) + 1.0;
+        float D = a2 / (3.14159 * dDen * dDen + 1e-6);
+        float k = (rough + 1.0)*(rough + 1.0)/8.0;
+        float NdotV = max(dot(normal, viewDir), 0.0);
+        float Gv = NdotV / (NdotV * (1.0 - k) + k + 1e-6);
+        float Gl = NdotL / (NdotL * (1.0 - k) + k + 1e-6);
+        float denom = max(4.0 * NdotL * NdotV, 1e-4);
+        vec3 spec = (F * D * Gv * Gl) / denom;
+        return spec * light.color * attenuation * NdotL;
+    }
+#endif
+    vec3 lightDir;
+    float attenuation = 1.0;
+    float visibility;
+
+    if (light.positionOrDirection.w == 1.0) { // Point light
+        vec3 lightVec = light.positionOrDirection.xyz - hitPoint;
+        float distance = max(length(lightVec), 0.001);
+        lightDir = normalize(lightVec);
+        attenuation = light.power / (distance * distance);
+
+        // Check shadows for point lights
+        if (!shadowVisibility(hitPoint + lightDir * 0.001, lightDir, distance, visibility)) return vec3(0.0);
+    } else { // Directional light
+        lightDir = normalize(light.positionOrDirection.xyz);
+        attenuation = light.power;
+
+        if (!shadowVisibility(hitPoint + lightDir * 0.001, lightDir, 1e30, visibility)) return vec3(0.0);
+    }
+    attenuation *= visibility;
+    // The mirror lobe takes reflectivity of the energy and the BRDF the rest, as in scatter
+    return opaqueBRDFCos(normal, viewDir, lightDir, material) * (1.0 - material.reflectivity) * light.color * attenuation;
+}
+
+// Picks a point light from the alias table for u in [0, 1); pdf is its selection probability
+int sampleLight(float u, out float pdf) {
+    int count = lightTableHeader.x;
+    float scaled = u * float(count);
+    int slot = min(int(scaled), count - 1);
+    LightAliasEntry entry = lightTable[slot];
+    if (scaled - float(slot) >= entry.threshold) entry = lightTable[entry.alias];
+    pdf = entry.pdf;
+    return entry.light;
+}
+
+// Direct lighting at a path vertex. The lights are points and directions, which scattered rays
+// can never hit, so this light sampling alone carries their light: its MIS weight is 1 and the
+// BSDF-sampled bounce only gathers the sky. Ambient stands in for light the paths do not carry
+// and is added at the camera hit only. With more point lights than lightSamples, lightSamples of
+// them are picked in proportion to power and weighted by 1 / (pdf * lightSamples), which keeps
+// the sum unbiased at a fixed shadow ray count. The picks split [0, 1) into lightSamples strata
+// that share one sample offset, so they spread over the table instead of clumping.
+vec3 calculateLighting(vec3 hitPoint, vec3 normal, Material material, vec3 viewDir, PathSampler sampler, int bounce) {
+    vec3 color = (bounce > 0 || (RZ_TRANSPARENCY != 0 && material.transparency > 0.0)) ? vec3(0.0) : ambientLightColor * material.albedo;
+    int pointLights = lightTableHeader.x;
+    int directionalLights = lightTableHeader.y;
+#if RZ_LIGHT_SAMPLING < 0
+    bool sampled = lightSamples > 0 && pointLights > lightSamples;
+#else
+    const bool sampled = RZ_LIGHT_SAMPLING != 0;
+#endif
+    // One loop, so directLight and its shadow traversal are inlined once
+    int count = sampled ? directionalLights + lightSamples : numLights;
+    float pickOffset = sampled ? sampleDimension(sampler, bounceDimension(bounce, DIM_LIGHT)) : 0.0;
+    for (int i = 0; i < RZ_MAX_LIGHTS; ++i) {
+        if (i >= count) break;
+        int light = i;
+        float weight = 1.0;
+        if (!sampled) {
+            if (i >= lights.length()) break; // safety
+        } else if (i < directionalLights) {
+            light = lightTable[pointLights + i].light;
+        } else {
+            float pdf;
+            light = sampleLight((float(i - directionalLights) + pickOffset) / float(lightSamples), pdf);
+            weight = 1.0 / (pdf * float(lightSamples));
+        }
+        color += directLight(lights[light], hitPoint, normal, material, viewDir) * weight;
+    }
+    return color;
+}
+
+//------------------------------------------------------------------------------
+// Path continuation, shared by the megakernel and the wavefront shade kernel
+//------------------------------------------------------------------------------
+// Skybox: blueish gradient, less bright
+vec3 skyColor(vec3 direction) {
+    float t = 0.5 * (normalize(direction).y + 1.0);
+    return mix(vec3(0.15, 0.25, 0.45), vec3(0.5, 0.7, 1.0), t); // deep blue to light blue
+}
+
+// Material response at a hit: picks the next direction, updates the throughput and the medium
+// IOR and offsets the origin off the surface. Returns false when Russian roulette ends the path.
+// Opaque surfaces split their energy between a mirror lobe (reflectivity) and the BRDF (the
+// rest); each lobe is picked with its share, so neither weight carries the pick probability.
+bool scatter(inout vec3 currentOrigin, inout vec3 currentDirection, inout vec3 throughput, inout float currentIor,
+             vec3 hitPoint, vec3 hitNormal, Material hitMaterial, PathSampler sampler, int bounce) {
+    float randVal = sampleDimension(sampler, bounceDimension(bounce, DIM_LOBE));
+
+    // Transparent / refractive handling
+    if (RZ_TRANSPARENCY != 0 && hitMaterial.transparency > 0.0) {
+        // Deterministic dielectric: always refract (unless TIR) and rely on direct spec for reflection.
+        bool entering = dot(-currentDirection, hitNormal) > 0.0;
+        vec3 N = entering ? hitNormal : -hitNormal; // outward normal relative to current medium
+        float extIor = currentIor;
+        float nextIor = entering ? hitMaterial.ior : 1.0;
+        float eta = extIor / nextIor;
+        float cosi = clamp(dot(-currentDirection, N), 0.0, 1.0);
+        float F0 = pow((extIor - nextIor) / (extIor + nextIor), 2.0);
+        float fresnel = F0 + (1.0 - F0) * pow(1.0 - cosi, 5.0);
+        vec3 refr;
+        bool ok = refractDir(currentDirection, N, eta, refr);
+        if (!ok) { // Total internal reflection: fallback reflect only
+            currentDirection = reflectRay(currentDirection, N);
+            // Slight energy trim
+            throughput *= vec3(0.98);
+        } else {
+            // Apply transmission weighting; leave reflection handled by spec direct term
+            currentDirection = refr;
+            currentIor = nextIor;
+            vec3 tint = mix(vec3(1.0), hitMaterial.albedo, hitMaterial.transparency);
+            vec3 transmitWeight = tint * hitMaterial.transparency * (1.0 - fresnel);
+            throughput *= clamp(transmitWeight, vec3(0.0), vec3(1.0));
+        }
+        // Advanced: could add chromatic dispersion here by varying IOR per channel
+    } else if (randVal < hitMaterial.reflectivity) {
+        // Opaque: the mirror lobe, picked with probability reflectivity
+        currentDirection = reflectRay(currentDirection, hitNormal);
+        throughput *= vec3(0.95); // slight loss to prevent runaway brightness
+    } else {
+        // The importance-sampled BRDF, picked with probability 1 - reflectivity
+        vec3 V = -currentDirection;
+        vec3 N = dot(hitNormal, V) < 0.0 ? -hitNormal : hitNormal;
+        float specularProbability = specularLobeProbability(N, V, hitMaterial);
+        vec3 L = sampleOpaqueBRDF(N, V, hitMaterial, specularProbability,
+                                  sampleDimension(sampler, bounceDimension(bounce, DIM_BRDF_LOBE)),
+                                  sample2D(sampler, bounceDimension(bounce, DIM_DIRECTION)));
+        float pdf = opaqueBRDFPdf(N, V, L, hitMaterial, specularProbability);
+        if (pdf <= 0.0) return false; // reflected below the surface
+        currentDirection = L;
+        throughput *= opaqueBRDFCos(N, V, L, hitMaterial) / pdf;
+    }
+    // Offset origin based on direction vs surface normal to avoid self-intersections, especially exiting glass
+    vec3 offsetNormal = hitNormal;
+    float pushDir = dot(currentDirection, hitNormal) > 0.0 ? 1.0 : -1.0;
+    currentOrigin = hitPoint + offsetNormal * pushDir * 0.003;
+
+    // Russian roulette termination after a few bounces
+    if (bounce > 2) {
+        float p = max(throughput.r, max(throughput.g, throughput.b));
+        if (sampleDimension(sampler, bounceDimension(bounce, DIM_ROULETTE)) > p)
+            return false;
+        throughput /= p;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+// Wavefront path tracer state, shared by the wavefront_*.comp kernels (after pathtracer_common.glsl).
+// One path per pixel; a bounce is an extend pass (closest hit) followed by a shade pass (material
+// response) and a connect pass (shadow rays), each over a queue of live path indices. Only two
+// storage blocks are added to the scene's 14, as compute stages may have as few as 16.
+
+// Per-path state carried between passes. Path i traces pixel i.
+struct PathState {
+    vec3 origin;
+    float ior;           // index of refraction of the medium the path travels in
+    vec3 direction;
+    float pad0;
+    vec3 throughput;
+    float pad1;
+    vec3 radiance;       // summed over the passes of one sample
+    float pad2;
+    vec3 hitPoint;       // closest hit of the last extend pass
+    int hitMaterial;     // -1 marks a miss
+    vec3 hitNormal;
+    float hitT;
+    vec3 connectWeight;  // throughput at the hit queued for the connect pass
+    float pad3;
+    PathSampler sampler;
+    vec2 pad4;
+    vec3 connectViewDir; // toward where the path came from, as shade overwrites direction
+    float pad5;
+};
+
+layout(std430, binding = 14) buffer PathStateBuffer {
+    PathState paths[];
+};
+
+// Threads per group of the queue-driven kernels; WavefrontRenderer.cpp dispatches with the same size
+#define QUEUE_GROUP_SIZE 256
+// Queues 0 and 1 alternate as in/out path queues per bounce; queue 2 lists hits to connect
+#define CONNECT_QUEUE 2
+
+// Every queue starts with an indirect dispatch header (xyz = work groups of QUEUE_GROUP_SIZE,
+// w = entries); the entries of queue q follow at q * pixel count
+layout(std430, binding = 15) buffer QueueBuffer {
+    uvec4 queueHeaders[3];
+    uint queueEntries[];
+};
+
+uniform int bounce;      // bounce the current extend/shade/connect passes work on
+uniform int sampleIndex; // samples already in the accumulation image
+
+int inQueue() { return bounce & 1; }
+int outQueue() { return (bounce & 1) ^ 1; }
+
+uint queueEntry(int queue, uint index) {
+    return queueEntries[uint(queue) * uint(resolution.x) * uint(resolution.y) + index];
+}
+
+// Appending bumps the group count every QUEUE_GROUP_SIZE entries, so the header stays a valid indirect dispatch
+void appendToQueue(int queue, uint path) {
+    uint slot = atomicAdd(queueHeaders[queue].w, 1u);
+    if (slot % uint(QUEUE_GROUP_SIZE) == 0u) atomicAdd(queueHeaders[queue].x, 1u);
+    queueEntries[uint(queue) * uint(resolution.x) * uint(resolution.y) + slot] = path;
+}
@@ -1,5 +1,8 @@
 #include "BVH.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <limits>
 #include <fstream>
 
@@ -8,18 +11,22 @@ struct BVHBuildEntry {
     int start, end;
 };
 
-static void computeBounds(const std::vector<Triangle>& tris, const std::vector<int>& triIndices, int start, int end, glm::vec3& bmin, glm::vec3& bmax) {
+static void computeBounds(const Mesh& mesh, const std::vector<int>& triIndices, int start, int end, glm::vec3& bmin, glm::vec3& bmax) {
     bmin = glm::vec3(std::numeric_limits<float>::max());
     bmax = glm::vec3(-std::numeric_limits<float>::max());
     for (int i = start; i < end; ++i) {
-        const Triangle& t = tris[triIndices[i]];
-        bmin = glm::min(bmin, glm::min(t.v0, glm::min(t.v1, t.v2)));
-        bmax = glm::max(bmax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+        bmin = glm::min(bmin, mesh.triangleMin(triIndices[i]));
+        bmax = glm::max(bmax, mesh.triangleMax(triIndices[i]));
     }
 }
 
+static float surfaceArea(const glm::vec3& bmin, const glm::vec3& bmax) {
+    glm::vec3 e = bmax - bmin;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
 // Sweep-based SAH for much faster BVH construction
-static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int>& triIndices, int start, int end, int& axis, float& splitPos, std::vector<int>& sortedTriIndices) {
+static int findSAHSplit(const Mesh& mesh, const std::vector<int>& triIndices, int start, int end, int& axis, float& splitPos, std::vector<int>& sortedTriIndices) {
     int bestAxis = -1;
     float bestCost = std::numeric_limits<float>::max();
     int bestSplit = -1;
@@ -28,7 +35,7 @@ static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int
     if (N <= 4) return -1;
     // Compute parent bounds for normalization
     glm::vec3 parentBMin, parentBMax;
-    computeBounds(tris, triIndices, start, end, parentBMin, parentBMax);
+    computeBounds(mesh, triIndices, start, end, parentBMin, parentBMax);
     float parentArea = 2.0f * (
         (parentBMax.x - parentBMin.x) * (parentBMax.y - parentBMin.y) +
         (parentBMax.y - parentBMin.y) * (parentBMax.z - parentBMin.z) +
@@ -37,8 +44,7 @@ static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int
         // Sort indices by centroid along axis a
         std::vector<std::pair<float, int>> centroidIdxs(N);
         for (int i = 0; i < N; ++i) {
-            const Triangle& t = tris[triIndices[start + i]];
-            glm::vec3 centroid = (t.v0 + t.v1 + t.v2) / 3.0f;
+            glm::vec3 centroid = mesh.triangleCentroid(triIndices[start + i]);
             centroidIdxs[i] = {centroid[a], triIndices[start + i]};
         }
         std::sort(centroidIdxs.begin(), centroidIdxs.end());
@@ -47,18 +53,16 @@ static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int
         glm::vec3 bmin = glm::vec3(std::numeric_limits<float>::max());
         glm::vec3 bmax = glm::vec3(-std::numeric_limits<float>::max());
         for (int i = 0; i < N; ++i) {
-            const Triangle& t = tris[centroidIdxs[i].second];
-            bmin = glm::min(bmin, glm::min(t.v0, glm::min(t.v1, t.v2)));
-            bmax = glm::max(bmax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+            bmin = glm::min(bmin, mesh.triangleMin(centroidIdxs[i].second));
+            bmax = glm::max(bmax, mesh.triangleMax(centroidIdxs[i].second));
             leftBMin[i] = bmin;
             leftBMax[i] = bmax;
         }
         bmin = glm::vec3(std::numeric_limits<float>::max());
         bmax = glm::vec3(-std::numeric_limits<float>::max());
         for (int i = N - 1; i >= 0; --i) {
-            const Triangle& t = tris[centroidIdxs[i].second];
-            bmin = glm::min(bmin, glm::min(t.v0, glm::min(t.v1, t.v2)));
-            bmax = glm::max(bmax, glm::max(t.v0, glm::max(t.v1, t.v2)));
+            bmin = glm::min(bmin, mesh.triangleMin(centroidIdxs[i].second));
+            bmax = glm::max(bmax, mesh.triangleMax(centroidIdxs[i].second));
             rightBMin[i] = bmin;
             rightBMax[i] = bmax;
         }
@@ -83,8 +87,7 @@ static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int
     if (bestAxis != -1) {
         std::vector<std::pair<float, int>> centroidIdxs(N);
         for (int i = 0; i < N; ++i) {
-            const Triangle& t = tris[triIndices[start + i]];
-            glm::vec3 centroid = (t.v0 + t.v1 + t.v2) / 3.0f;
+            glm::vec3 centroid = mesh.triangleCentroid(triIndices[start + i]);
             centroidIdxs[i] = {centroid[bestAxis], triIndices[start + i]};
         }
         std::sort(centroidIdxs.begin(), centroidIdxs.end());
@@ -96,66 +99,265 @@ static int findSAHSplit(const std::vector<Triangle>& tris, const std::vector<int
     return bestSplit;
 }
 
-void BVH::buildBLAS(const std::vector<Triangle>& tris) {
-    triIndices.resize(tris.size());
-    for (int i = 0; i < (int)tris.size(); ++i) triIndices[i] = i;
-    nodes.clear();
-    nodes.reserve(tris.size() * 2);
-    std::vector<BVHBuildEntry> stack;
-    stack.push_back({0, 0, (int)tris.size()});
-    nodes.push_back({glm::vec3(0), 0, glm::vec3(0), 0}); // root
-    while (!stack.empty()) {
-        BVHBuildEntry e = stack.back(); stack.pop_back();
-        int nidx = e.nodeIdx;
-        int start = e.start, end = e.end, count = end - start;
-        glm::vec3 bmin, bmax;
-        computeBounds(tris, triIndices, start, end, bmin, bmax);
-        nodes[nidx].boundsMin = bmin;
-        nodes[nidx].boundsMax = bmax;
-        if (count <= 4) { // leaf
-            nodes[nidx].leftFirst = start;
-            nodes[nidx].count = count;
-            continue;
+static constexpr int kMaxSAHBins = 64;
+static constexpr int kParallelGrain = 4096; // minimum items per chunk for range-parallel node work
+static constexpr int kMaxTLASLeafSize = 16;
+
+// Per-triangle bounds and centroid, computed once per build for the binned builder
+struct BVHPrimRef {
+    glm::vec3 bmin;
+    glm::vec3 bmax;
+    glm::vec3 centroid;
+};
+
+struct SAHBin {
+    glm::vec3 bmin;
+    glm::vec3 bmax;
+    int count;
+};
+
+// Centroid bins of one range on all three axes
+struct SAHBinSet {
+    SAHBin bins[3][kMaxSAHBins];
+};
+
+// State shared by every node of one BLAS or SAH TLAS build. Concurrent tasks only touch
+// disjoint [start, end) ranges of triIndices and scratch. TLAS builds have no triangles:
+// prims hold the instance world bounds and triIndices the instance indices.
+struct BVHBuildContext {
+    const Mesh& mesh;
+    std::vector<int>& triIndices;
+    BVHSplitMethod splitMethod;
+    int binCount;
+    int maxLeafSize;
+    bool sahLeafTermination;       // ranges up to maxLeafSize split only when SAH beats a leaf
+    std::vector<BVHPrimRef> prims; // BinnedSAH only
+    std::vector<int> scratch;      // BinnedSAH partition buffer, indexed like triIndices
+    ThreadPool* pool;              // non-null for parallel builds
+};
+
+static void resetBins(SAHBinSet& set, int binCount) {
+    for (int a = 0; a < 3; ++a) {
+        for (int b = 0; b < binCount; ++b) {
+            set.bins[a][b].bmin = glm::vec3(std::numeric_limits<float>::max());
+            set.bins[a][b].bmax = glm::vec3(-std::numeric_limits<float>::max());
+            set.bins[a][b].count = 0;
         }
-        int axis = 0;
-        float split = 0.0f;
-        int mid = start;
-        if (splitMethod == BVHSplitMethod::SAH) {
-            int sahSplit = -1;
-            std::vector<int> sortedTriIndices;
-            // Modified findSAHSplit to also return sortedTriIndices
-            sahSplit = findSAHSplit(tris, triIndices, start, end, axis, split, sortedTriIndices);
-            // Robustness: Only use SAH split if valid, else fallback to midpoint
-            if (sahSplit > 0 && sahSplit < (end - start) && sortedTriIndices.size() == (size_t)(end - start)) {
-                // Copy sortedTriIndices back into triIndices[start:end]
-                for (int i = 0; i < end - start; ++i) {
-                    triIndices[start + i] = sortedTriIndices[i];
-                }
-                mid = start + sahSplit;
-            } else {
-                // fallback to midpoint
-                glm::vec3 extent = bmax - bmin;
-                if (extent.y > extent.x && extent.y > extent.z) axis = 1;
-                else if (extent.z > extent.x) axis = 2;
-                split = 0.5f * (bmin[axis] + bmax[axis]);
-                mid = start;
-                for (int i = start; i < end; ++i) {
-                    glm::vec3 centroid = (tris[triIndices[i]].v0 + tris[triIndices[i]].v1 + tris[triIndices[i]].v2) / 3.0f;
-                    if (centroid[axis] < split) {
-                        std::swap(triIndices[i], triIndices[mid]);
-                        ++mid;
-                    }
+    }
+}
+
+static int binIndex(float c, float axisMin, float axisScale, int binCount) {
+    return std::min(binCount - 1, (int)((c - axisMin) * axisScale));
+}
+
+static void accumulateBins(const BVHBuildContext& ctx, int start, int end, const glm::vec3& cmin, const glm::vec3& scale, SAHBinSet& set) {
+    for (int i = start; i < end; ++i) {
+        const BVHPrimRef& p = ctx.prims[ctx.triIndices[i]];
+        for (int a = 0; a < 3; ++a) {
+            SAHBin& bin = set.bins[a][binIndex(p.centroid[a], cmin[a], scale[a], ctx.binCount)];
+            bin.bmin = glm::min(bin.bmin, p.bmin);
+            bin.bmax = glm::max(bin.bmax, p.bmax);
+            bin.count++;
+        }
+    }
+}
+
+// Node bounds and centroid bounds of triIndices[start:end]. Min/max reductions are exact,
+// so the range-parallel variant returns bit-identical results.
+static void computeBinnedBounds(const BVHBuildContext& ctx, int start, int end, bool parallel, glm::vec3& bmin, glm::vec3& bmax, glm::vec3& cmin, glm::vec3& cmax) {
+    auto reduce = [&ctx](int s, int e, glm::vec3* out) {
+        out[0] = out[2] = glm::vec3(std::numeric_limits<float>::max());
+        out[1] = out[3] = glm::vec3(-std::numeric_limits<float>::max());
+        for (int i = s; i < e; ++i) {
+            const BVHPrimRef& p = ctx.prims[ctx.triIndices[i]];
+            out[0] = glm::min(out[0], p.bmin);
+            out[1] = glm::max(out[1], p.bmax);
+            out[2] = glm::min(out[2], p.centroid);
+            out[3] = glm::max(out[3], p.centroid);
+        }
+    };
+    if (!parallel) {
+        glm::vec3 r[4];
+        reduce(start, end, r);
+        bmin = r[0]; bmax = r[1]; cmin = r[2]; cmax = r[3];
+        return;
+    }
+    std::vector<glm::vec3> partial(4 * ctx.pool->chunkCount(start, end, kParallelGrain));
+    ctx.pool->parallelFor(start, end, kParallelGrain, [&](int s, int e, int chunk) { reduce(s, e, &partial[4 * chunk]); });
+    bmin = cmin = glm::vec3(std::numeric_limits<float>::max());
+    bmax = cmax = glm::vec3(-std::numeric_limits<float>::max());
+    for (size_t c = 0; c < partial.size(); c += 4) {
+        bmin = glm::min(bmin, partial[c]);
+        bmax = glm::max(bmax, partial[c + 1]);
+        cmin = glm::min(cmin, partial[c + 2]);
+        cmax = glm::max(cmax, partial[c + 3]);
+    }
+}
+
+// Binned SAH: buckets centroids over the node's centroid bounds on all three axes in one
+// pass, evaluates the binCount-1 planes between bins and stable-partitions triIndices[start:end]
+// through the scratch buffer. Returns the size of the left partition, -1 if no plane separates the
+// centroids, or 0 (range untouched) if the best plane's cost is not below maxCost.
+static int findBinnedSAHSplit(BVHBuildContext& ctx, int start, int end, const glm::vec3& cmin, const glm::vec3& cmax, bool parallel, float maxCost, int& axis, float& splitPos) {
+    int N = end - start;
+    if (N < 2) return -1;
+    int binCount = ctx.binCount;
+    glm::vec3 extent = cmax - cmin;
+    glm::vec3 scale;
+    for (int a = 0; a < 3; ++a) scale[a] = extent[a] > 0.0f ? binCount / extent[a] : 0.0f;
+
+    SAHBinSet set;
+    resetBins(set, binCount);
+    if (!parallel) {
+        accumulateBins(ctx, start, end, cmin, scale, set);
+    } else {
+        std::vector<SAHBinSet> partial(ctx.pool->chunkCount(start, end, kParallelGrain));
+        ctx.pool->parallelFor(start, end, kParallelGrain, [&](int s, int e, int chunk) {
+            resetBins(partial[chunk], binCount);
+            accumulateBins(ctx, s, e, cmin, scale, partial[chunk]);
+        });
+        for (const SAHBinSet& p : partial) {
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < binCount; ++b) {
+                    set.bins[a][b].bmin = glm::min(set.bins[a][b].bmin, p.bins[a][b].bmin);
+                    set.bins[a][b].bmax = glm::max(set.bins[a][b].bmax, p.bins[a][b].bmax);
+                    set.bins[a][b].count += p.bins[a][b].count;
                 }
-                if (mid == start || mid == end) mid = start + (count / 2);
             }
+        }
+    }
+
+    int bestAxis = -1;
+    int bestBin = -1;
+    float bestCost = std::numeric_limits<float>::max();
+    float leftArea[kMaxSAHBins];
+    int leftCount[kMaxSAHBins];
+    for (int a = 0; a < 3; ++a) {
+        if (extent[a] <= 0.0f) continue; // all centroids on one plane along this axis
+        const SAHBin* bins = set.bins[a];
+        // Left-to-right prefix over bins [0, b]
+        glm::vec3 bmin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 bmax = glm::vec3(-std::numeric_limits<float>::max());
+        int count = 0;
+        for (int b = 0; b < binCount - 1; ++b) {
+            if (bins[b].count > 0) {
+                bmin = glm::min(bmin, bins[b].bmin);
+                bmax = glm::max(bmax, bins[b].bmax);
+                count += bins[b].count;
+            }
+            leftCount[b] = count;
+            leftArea[b] = count > 0 ? surfaceArea(bmin, bmax) : 0.0f;
+        }
+        // Right-to-left sweep evaluates the plane between bin b-1 and bin b
+        bmin = glm::vec3(std::numeric_limits<float>::max());
+        bmax = glm::vec3(-std::numeric_limits<float>::max());
+        count = 0;
+        for (int b = binCount - 1; b > 0; --b) {
+            if (bins[b].count > 0) {
+                bmin = glm::min(bmin, bins[b].bmin);
+                bmax = glm::max(bmax, bins[b].bmax);
+                count += bins[b].count;
+            }
+            if (count == 0 || leftCount[b - 1] == 0) continue;
+            float cost = leftArea[b - 1] * leftCount[b - 1] + surfaceArea(bmin, bmax) * count;
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = a;
+                bestBin = b;
+            }
+        }
+    }
+    if (bestAxis == -1) return -1;
+    if (bestCost >= maxCost) return 0;
+
+    // Stable partition: left side compacts in place, right side goes through scratch.
+    // The parallel variant scatters per-chunk with prefix offsets and yields the same order.
+    float axisMin = cmin[bestAxis];
+    float axisScale = scale[bestAxis];
+    auto goesLeft = [&](int triIdx) {
+        return binIndex(ctx.prims[triIdx].centroid[bestAxis], axisMin, axisScale, binCount) < bestBin;
+    };
+    int leftTotal = 0;
+    if (!parallel) {
+        int right = start;
+        for (int i = start; i < end; ++i) {
+            int triIdx = ctx.triIndices[i];
+            if (goesLeft(triIdx)) ctx.triIndices[start + leftTotal++] = triIdx;
+            else ctx.scratch[right++] = triIdx;
+        }
+        std::copy(ctx.scratch.begin() + start, ctx.scratch.begin() + right, ctx.triIndices.begin() + start + leftTotal);
+    } else {
+        int chunks = ctx.pool->chunkCount(start, end, kParallelGrain);
+        std::vector<int> chunkLeft(chunks), chunkBegin(chunks + 1, end);
+        ctx.pool->parallelFor(start, end, kParallelGrain, [&](int s, int e, int chunk) {
+            int n = 0;
+            for (int i = s; i < e; ++i) n += goesLeft(ctx.triIndices[i]) ? 1 : 0;
+            chunkLeft[chunk] = n;
+            chunkBegin[chunk] = s;
+        });
+        std::vector<int> leftOffset(chunks), rightOffset(chunks);
+        for (int c = 0; c < chunks; ++c) leftTotal += chunkLeft[c];
+        int leftRun = start, rightRun = start + leftTotal;
+        for (int c = 0; c < chunks; ++c) {
+            leftOffset[c] = leftRun;
+            rightOffset[c] = rightRun;
+            leftRun += chunkLeft[c];
+            rightRun += (chunkBegin[c + 1] - chunkBegin[c]) - chunkLeft[c];
+        }
+        ctx.pool->parallelFor(start, end, kParallelGrain, [&](int s, int e, int chunk) {
+            int l = leftOffset[chunk], r = rightOffset[chunk];
+            for (int i = s; i < e; ++i) {
+                int triIdx = ctx.triIndices[i];
+                if (goesLeft(triIdx)) ctx.scratch[l++] = triIdx;
+                else ctx.scratch[r++] = triIdx;
+            }
+        });
+        ctx.pool->parallelFor(start, end, kParallelGrain, [&](int s, int e, int) {
+            std::copy(ctx.scratch.begin() + s, ctx.scratch.begin() + e, ctx.triIndices.begin() + s);
+        });
+    }
+    axis = bestAxis;
+    splitPos = axisMin + bestBin / axisScale;
+    return leftTotal;
+}
+
+// Computes the bounds of triIndices[start:end] and, for ranges above the leaf size,
+// reorders them around the chosen split. Returns the split index, or -1 for a leaf.
+static int splitNode(BVHBuildContext& ctx, int start, int end, bool parallel, glm::vec3& bmin, glm::vec3& bmax) {
+    const Mesh& mesh = ctx.mesh;
+    std::vector<int>& triIndices = ctx.triIndices;
+    int count = end - start;
+    glm::vec3 cmin, cmax;
+    if (ctx.splitMethod == BVHSplitMethod::BinnedSAH) {
+        computeBinnedBounds(ctx, start, end, parallel, bmin, bmax, cmin, cmax);
+    } else {
+        computeBounds(mesh, triIndices, start, end, bmin, bmax);
+    }
+    if (count <= 1 || (count <= ctx.maxLeafSize && !ctx.sahLeafTermination)) return -1; // leaf
+    int axis = 0;
+    float split = 0.0f;
+    int mid = start;
+    if (ctx.splitMethod == BVHSplitMethod::SAH) {
+        int sahSplit = -1;
+        std::vector<int> sortedTriIndices;
+        // Modified findSAHSplit to also return sortedTriIndices
+        sahSplit = findSAHSplit(mesh, triIndices, start, end, axis, split, sortedTriIndices);
+        // Robustness: Only use SAH split if valid, else fallback to midpoint
+        if (sahSplit > 0 && sahSplit < (end - start) && sortedTriIndices.size() == (size_t)(end - start)) {
+            // Copy sortedTriIndices back into triIndices[start:end]
+            for (int i = 0; i < end - start; ++i) {
+                triIndices[start + i] = sortedTriIndices[i];
+            }
+            mid = start + sahSplit;
         } else {
+            // fallback to midpoint
             glm::vec3 extent = bmax - bmin;
             if (extent.y > extent.x && extent.y > extent.z) axis = 1;
             else if (extent.z > extent.x) axis = 2;
             split = 0.5f * (bmin[axis] + bmax[axis]);
             mid = start;
             for (int i = start; i < end; ++i) {
-                glm::vec3 centroid = (tris[triIndices[i]].v0 + tris[triIndices[i]].v1 + tris[triIndices[i]].v2) / 3.0f;
+                glm::vec3 centroid = mesh.triangleCentroid(triIndices[i]);
                 if (centroid[axis] < split) {
                     std::swap(triIndices[i], triIndices[mid]);
                     ++mid;
@@ -163,25 +365,146 @@ void BVH::buildBLAS(const std::vector<Triangle>& tris) {
             }
             if (mid == start || mid == end) mid = start + (count / 2);
         }
-        int leftIdx = (int)nodes.size();
+    } else if (ctx.splitMethod == BVHSplitMethod::BinnedSAH) {
+        // With unit traversal and intersection cost a split beats a leaf iff
+        // sum(area_i * count_i) < area * (count - 1)
+        float maxCost = std::numeric_limits<float>::max();
+        if (count <= ctx.maxLeafSize) maxCost = surfaceArea(bmin, bmax) * (count - 1);
+        int binnedSplit = findBinnedSAHSplit(ctx, start, end, cmin, cmax, parallel, maxCost, axis, split);
+        if (binnedSplit == 0) return -1; // leaf is cheaper
+        // No separating plane means every centroid coincides; split by count
+        mid = (binnedSplit > 0 && binnedSplit < count) ? start + binnedSplit : start + (count / 2);
+    } else {
+        glm::vec3 extent = bmax - bmin;
+        if (extent.y > extent.x && extent.y > extent.z) axis = 1;
+        else if (extent.z > extent.x) axis = 2;
+        split = 0.5f * (bmin[axis] + bmax[axis]);
+        mid = start;
+        for (int i = start; i < end; ++i) {
+            glm::vec3 centroid = mesh.triangleCentroid(triIndices[i]);
+            if (centroid[axis] < split) {
+                std::swap(triIndices[i], triIndices[mid]);
+                ++mid;
+            }
+        }
+        if (mid == start || mid == end) mid = start + (count / 2);
+    }
+    return mid;
+}
+
+// Serial build of triIndices[start:end] into out, root at out[0]. Children are allocated
+// as a pair when their parent is processed and the left subtree is finished first, so a
+// subtree's descendants always form one contiguous block after its children.
+static void buildSubtree(BVHBuildContext& ctx, int start, int end, std::vector<BVHNode>& out) {
+    std::vector<BVHBuildEntry> stack;
+    stack.push_back({(int)out.size(), start, end});
+    out.push_back({glm::vec3(0), 0, glm::vec3(0), 0}); // root
+    while (!stack.empty()) {
+        BVHBuildEntry e = stack.back(); stack.pop_back();
+        int nidx = e.nodeIdx;
+        glm::vec3 bmin, bmax;
+        int mid = splitNode(ctx, e.start, e.end, false, bmin, bmax);
+        out[nidx].boundsMin = bmin;
+        out[nidx].boundsMax = bmax;
+        if (mid < 0) { // leaf
+            out[nidx].leftFirst = e.start;
+            out[nidx].count = e.end - e.start;
+            continue;
+        }
+        int leftIdx = (int)out.size();
         int rightIdx = leftIdx + 1;
-        nodes[nidx].leftFirst = leftIdx;
-        nodes[nidx].count = -1;
-        nodes.push_back({});
-        nodes.push_back({});
-        stack.push_back({rightIdx, mid, end});
-        stack.push_back({leftIdx, start, mid});
+        out[nidx].leftFirst = leftIdx;
+        out[nidx].count = -1;
+        out.push_back({});
+        out.push_back({});
+        stack.push_back({rightIdx, mid, e.end});
+        stack.push_back({leftIdx, e.start, mid});
+    }
+}
+
+// Copies a locally indexed subtree into out: sub[0] goes to rootSlot, sub[i >= 1] to descendantBase + i - 1
+static void spliceSubtree(std::vector<BVHNode>& out, const std::vector<BVHNode>& sub, int rootSlot, int descendantBase) {
+    for (size_t i = 0; i < sub.size(); ++i) {
+        BVHNode n = sub[i];
+        if (n.count < 0) n.leftFirst = descendantBase + n.leftFirst - 1;
+        out[i == 0 ? rootSlot : descendantBase + (int)i - 1] = n;
+    }
+}
+
+// Task-parallel build producing the same layout as buildSubtree: ranges above threshold
+// split with range-parallel binning/partition and recurse as two tasks, smaller ranges build serially.
+static std::vector<BVHNode> buildSubtreeParallel(BVHBuildContext& ctx, int start, int end, int threshold) {
+    std::vector<BVHNode> out;
+    if (end - start <= threshold) {
+        out.reserve(2 * (end - start));
+        buildSubtree(ctx, start, end, out);
+        return out;
+    }
+    glm::vec3 bmin, bmax;
+    int mid = splitNode(ctx, start, end, true, bmin, bmax);
+    std::vector<BVHNode> left, right;
+    ThreadPool::TaskGroup group;
+    ctx.pool->run(group, [&]() { right = buildSubtreeParallel(ctx, mid, end, threshold); });
+    left = buildSubtreeParallel(ctx, start, mid, threshold);
+    ctx.pool->wait(group);
+    out.resize(left.size() + right.size() + 1);
+    out[0] = {bmin, 1, bmax, -1};
+    spliceSubtree(out, left, 1, 3);
+    spliceSubtree(out, right, 2, 3 + (int)left.size() - 1);
+    return out;
+}
+
+void BVH::buildBLAS(const Mesh& mesh) {
+    int triCount = (int)mesh.triangleCount();
+    triIndices.resize(triCount);
+    for (int i = 0; i < triCount; ++i) triIndices[i] = i;
+    nodes.clear();
+    int threshold = std::max(parallelSubtreeThreshold, 4);
+    bool parallel = parallelBuild && triCount > threshold;
+    BVHBuildContext ctx{mesh, triIndices, splitMethod, std::clamp(sahBinCount, 2, kMaxSAHBins), 4, false, {}, {}, parallel ? &ThreadPool::shared() : nullptr};
+    if (splitMethod == BVHSplitMethod::BinnedSAH) {
+        ctx.prims.resize(triCount);
+        ctx.scratch.resize(triCount);
+        auto computePrims = [&](int s, int e, int) {
+            for (int i = s; i < e; ++i) {
+                ctx.prims[i].bmin = mesh.triangleMin(i);
+                ctx.prims[i].bmax = mesh.triangleMax(i);
+                ctx.prims[i].centroid = mesh.triangleCentroid(i);
+            }
+        };
+        if (parallel) ctx.pool->parallelFor(0, triCount, kParallelGrain, computePrims);
+        else computePrims(0, triCount, 0);
+    }
+    if (parallel) {
+        nodes = buildSubtreeParallel(ctx, 0, triCount, threshold);
+    } else {
+        nodes.reserve(triCount * 2);
+        buildSubtree(ctx, 0, triCount, nodes);
     }
+    builtSAHCost = computeSAHCost();
+    sahCostRatio = 1.0f;
 }
 
 // TLAS: build over mesh AABBs, leaves reference BVHInstance indices
 void BVH::buildTLAS(const std::vector<BVHInstance>& meshInstances, const std::vector<BVHNode>& meshRootNodes) {
     triIndices.clear();
     nodes.clear();
-    int numMeshes = (int)meshInstances.size();
-    // Each mesh's root node AABB
-    std::vector<int> meshIndices(numMeshes);
-    for (int i = 0; i < numMeshes; ++i) meshIndices[i] = i;
+    // A mesh without triangles (a failed load) still has a BLAS root: a count-0 node with
+    // inverted bounds, which the slab test accepts and traversal takes for an internal node
+    std::vector<int> meshIndices;
+    meshIndices.reserve(meshInstances.size());
+    for (int i = 0; i < (int)meshInstances.size(); ++i) {
+        if (meshRootNodes[i].count != 0) meshIndices.push_back(i);
+    }
+    int numMeshes = (int)meshIndices.size();
+    if (numMeshes == 0) return;
+    int leafSize = std::clamp(tlasMaxLeafSize, 1, kMaxTLASLeafSize);
+    if (tlasSplitMethod != BVHSplitMethod::Midpoint) {
+        buildTLASWithSAH(meshRootNodes, meshIndices, leafSize);
+        builtSAHCost = computeSAHCost();
+        sahCostRatio = 1.0f;
+        return;
+    }
     // Stack for iterative build
     std::vector<BVHBuildEntry> stack;
     stack.push_back({0, 0, numMeshes});
@@ -201,19 +524,12 @@ void BVH::buildTLAS(const std::vector<BVHInstance>& meshInstances, const std::ve
         }
         nodes[nidx].boundsMin = bmin;
         nodes[nidx].boundsMax = bmax;
-        if (count == 1) { // leaf: single instance
+        if (count <= leafSize) { // leaf: up to tlasMaxLeafSize instances
             nodes[nidx].leftFirst = (int)triIndices.size();
-            nodes[nidx].count = 1;
-            triIndices.push_back(meshIndices[start]);
+            nodes[nidx].count = count;
+            triIndices.insert(triIndices.end(), meshIndices.begin() + start, meshIndices.begin() + end);
             continue;
         }
-        //if (count == 2) { // leaf: two instances
-        //    nodes[nidx].leftFirst = (int)triIndices.size();
-        //    nodes[nidx].count = 2;
-        //    triIndices.push_back(meshIndices[start]);
-        //    triIndices.push_back(meshIndices[start+1]);
-        //    continue;
-        //}
         glm::vec3 extent = bmax - bmin;
         int axis = 0;
         if (extent.y > extent.x && extent.y > extent.z) axis = 1;
@@ -237,6 +553,213 @@ void BVH::buildTLAS(const std::vector<BVHInstance>& meshInstances, const std::ve
         stack.push_back({rightIdx, mid, end});
         stack.push_back({leftIdx, start, mid});
     }
+    builtSAHCost = computeSAHCost();
+    sahCostRatio = 1.0f;
+}
+
+// SAH TLAS: bins instance world AABBs like BinnedSAH does triangles. Leaves are the
+// triIndices ranges the builder leaves behind, so triIndices is a permutation of meshIndices.
+void BVH::buildTLASWithSAH(const std::vector<BVHNode>& meshRootNodes, const std::vector<int>& meshIndices, int leafSize) {
+    static const Mesh noMesh;
+    int numMeshes = (int)meshIndices.size();
+    triIndices = meshIndices;
+    int threshold = std::max(parallelSubtreeThreshold, leafSize);
+    bool parallel = parallelBuild && numMeshes > threshold;
+    // Sweep SAH is approximated by the finest binning; instance counts are small next to triangle counts
+    int binCount = tlasSplitMethod == BVHSplitMethod::SAH ? kMaxSAHBins : std::clamp(sahBinCount, 2, kMaxSAHBins);
+    BVHBuildContext ctx{noMesh, triIndices, BVHSplitMethod::BinnedSAH, binCount, leafSize, true, {}, {}, parallel ? &ThreadPool::shared() : nullptr};
+    ctx.prims.resize(meshRootNodes.size());
+    ctx.scratch.resize(numMeshes);
+    for (int i : meshIndices) {
+        ctx.prims[i].bmin = meshRootNodes[i].boundsMin;
+        ctx.prims[i].bmax = meshRootNodes[i].boundsMax;
+        ctx.prims[i].centroid = (meshRootNodes[i].boundsMin + meshRootNodes[i].boundsMax) * 0.5f;
+    }
+    if (parallel) {
+        nodes = buildSubtreeParallel(ctx, 0, numMeshes, threshold);
+    } else {
+        nodes.reserve(numMeshes * 2);
+        buildSubtree(ctx, 0, numMeshes, nodes);
+    }
+}
+
+// Recomputes node bounds bottom-up. Every builder allocates children after their parent,
+// so a reverse sweep visits children first. leafBounds(node, bmin, bmax) grows the bounds by
+// the leaf's primitives; [firstChanged, lastChanged] covers the nodes whose bounds changed.
+template <typename LeafBounds>
+static void refitNodes(std::vector<BVHNode>& nodes, LeafBounds leafBounds, int& firstChanged, int& lastChanged) {
+    firstChanged = (int)nodes.size();
+    lastChanged = -1;
+    for (int n = (int)nodes.size() - 1; n >= 0; --n) {
+        BVHNode& node = nodes[n];
+        glm::vec3 bmin(std::numeric_limits<float>::max());
+        glm::vec3 bmax(-std::numeric_limits<float>::max());
+        if (node.count >= 0) {
+            leafBounds(node, bmin, bmax);
+        } else {
+            bmin = glm::min(nodes[node.leftFirst].boundsMin, nodes[node.leftFirst + 1].boundsMin);
+            bmax = glm::max(nodes[node.leftFirst].boundsMax, nodes[node.leftFirst + 1].boundsMax);
+        }
+        if (bmin != node.boundsMin || bmax != node.boundsMax) {
+            node.boundsMin = bmin;
+            node.boundsMax = bmax;
+            firstChanged = std::min(firstChanged, n);
+            lastChanged = std::max(lastChanged, n);
+        }
+    }
+}
+
+bool BVH::refit(const Mesh& mesh) {
+    if (nodes.empty() || mesh.triangleCount() != triIndices.size()) {
+        buildBLAS(mesh);
+        return true;
+    }
+    if (builtSAHCost <= 0.0f) builtSAHCost = computeSAHCost(); // tree came from a file: it is the baseline
+    int firstChanged, lastChanged;
+    refitNodes(nodes, [&](const BVHNode& leaf, glm::vec3& bmin, glm::vec3& bmax) {
+        for (int i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; ++i) {
+            bmin = glm::min(bmin, mesh.triangleMin(triIndices[i]));
+            bmax = glm::max(bmax, mesh.triangleMax(triIndices[i]));
+        }
+    }, firstChanged, lastChanged);
+    sahCostRatio = builtSAHCost > 0.0f ? computeSAHCost() / builtSAHCost : 1.0f;
+    if (sahCostRatio > rebuildCostRatio) {
+        buildBLAS(mesh);
+        return true;
+    }
+    return false;
+}
+
+void BVH::refitTLAS(const std::vector<BVHNode>& meshRootNodes, int& firstChanged, int& lastChanged) {
+    refitNodes(nodes, [&](const BVHNode& leaf, glm::vec3& bmin, glm::vec3& bmax) {
+        for (int i = leaf.leftFirst; i < leaf.leftFirst + leaf.count; ++i) {
+            const BVHNode& meshRoot = meshRootNodes[triIndices[i]];
+            bmin = glm::min(bmin, meshRoot.boundsMin);
+            bmax = glm::max(bmax, meshRoot.boundsMax);
+        }
+    }, firstChanged, lastChanged);
+    if (builtSAHCost <= 0.0f) builtSAHCost = computeSAHCost();
+    sahCostRatio = builtSAHCost > 0.0f ? computeSAHCost() / builtSAHCost : 1.0f;
+}
+
+float BVH::computeSAHCost() const {
+    if (nodes.empty()) return 0.0f;
+    float rootArea = surfaceArea(nodes[0].boundsMin, nodes[0].boundsMax);
+    if (rootArea <= 0.0f) return 0.0f;
+    double cost = 0.0;
+    for (const BVHNode& node : nodes) {
+        float area = surfaceArea(node.boundsMin, node.boundsMax);
+        cost += node.count >= 0 ? (double)area * node.count : (double)area;
+    }
+    return (float)(cost / rootArea);
+}
+
+// Smallest power-of-two scale (as a biased float exponent) for which 255 steps from origin cover originMax
+static uint32_t quantizationExponent(float origin, float originMax) {
+    float extent = originMax - origin;
+    int e = extent > 0.0f ? (int)std::ceil(std::log2(extent / 255.0f)) : -126;
+    e = std::clamp(e, -126, 127);
+    while (e < 127 && origin + 255.0f * std::ldexp(1.0f, e) < originMax) ++e;
+    return (uint32_t)(e + 127);
+}
+
+// Conservative 8-bit child bounds: decoding origin + q * scale never shrinks the box
+static void quantizeBounds(const glm::vec3& origin, const glm::vec3& scale, const glm::vec3& cmin, const glm::vec3& cmax, uint32_t qlo[3], uint32_t qhi[3]) {
+    for (int a = 0; a < 3; ++a) {
+        int lo = std::clamp((int)std::floor((cmin[a] - origin[a]) / scale[a]), 0, 255);
+        int hi = std::clamp((int)std::ceil((cmax[a] - origin[a]) / scale[a]), 0, 255);
+        while (lo > 0 && origin[a] + lo * scale[a] > cmin[a]) --lo;
+        while (hi < 255 && origin[a] + hi * scale[a] < cmax[a]) ++hi;
+        qlo[a] = (uint32_t)lo;
+        qhi[a] = (uint32_t)hi;
+    }
+}
+
+// Greedy collapse: a wide node starts with its binary node's two children and repeatedly
+// opens the internal child with the largest surface area until all slots are used.
+void WideBVH::build(const BVH& bvh, int nodeWidth, bool quantize) {
+    width = nodeWidth <= 4 ? 4 : 8;
+    quantized = quantize;
+    nodeCount = 0;
+    depth = 0;
+    slots.clear();
+    words.clear();
+    if (bvh.nodes.empty()) return;
+    auto allocate = [&]() {
+        int idx = nodeCount++;
+        if (quantized) words.resize((size_t)nodeCount * wordsPerNode(), 0u);
+        else slots.resize((size_t)nodeCount * width, BVHNode{glm::vec3(0.0f), 0, glm::vec3(0.0f), 0});
+        return idx;
+    };
+    struct PendingNode {
+        int binary; // binary node whose subtree fills the wide node
+        int wide;
+        int level;
+    };
+    std::vector<PendingNode> stack;
+    stack.push_back({0, allocate(), 1});
+    std::vector<int> children;
+    while (!stack.empty()) {
+        PendingNode p = stack.back(); stack.pop_back();
+        depth = std::max(depth, p.level);
+        const BVHNode& parent = bvh.nodes[p.binary];
+        children.clear();
+        if (parent.count >= 0) {
+            children.push_back(p.binary); // the whole tree is one leaf
+        } else {
+            children.push_back(parent.leftFirst);
+            children.push_back(parent.leftFirst + 1);
+            while ((int)children.size() < width) {
+                int open = -1;
+                float openArea = -1.0f;
+                for (int k = 0; k < (int)children.size(); ++k) {
+                    const BVHNode& c = bvh.nodes[children[k]];
+                    float area = surfaceArea(c.boundsMin, c.boundsMax);
+                    if (c.count < 0 && area > openArea) {
+                        open = k;
+                        openArea = area;
+                    }
+                }
+                if (open < 0) break;
+                int first = bvh.nodes[children[open]].leftFirst;
+                children[open] = first;
+                children.insert(children.begin() + open + 1, first + 1);
+            }
+        }
+        glm::vec3 origin = parent.boundsMin;
+        glm::vec3 scale(1.0f);
+        uint32_t* node = quantized ? &words[(size_t)p.wide * wordsPerNode()] : nullptr;
+        if (quantized) {
+            uint32_t exponents = 0;
+            for (int a = 0; a < 3; ++a) {
+                uint32_t biased = quantizationExponent(origin[a], parent.boundsMax[a]);
+                scale[a] = std::ldexp(1.0f, (int)biased - 127);
+                exponents |= biased << (8 * a);
+                std::memcpy(&node[a], &origin[a], sizeof(float));
+            }
+            node[3] = exponents;
+        }
+        for (int k = 0; k < (int)children.size(); ++k) {
+            const BVHNode& c = bvh.nodes[children[k]];
+            int ref = c.leftFirst;
+            int count = c.count;
+            if (count < 0) {
+                ref = allocate();
+                stack.push_back({children[k], ref, p.level + 1});
+                if (quantized) node = &words[(size_t)p.wide * wordsPerNode()]; // allocate() may reallocate
+            }
+            if (!quantized) {
+                slots[(size_t)p.wide * width + k] = {c.boundsMin, ref, c.boundsMax, count};
+                continue;
+            }
+            uint32_t qlo[3], qhi[3];
+            quantizeBounds(origin, scale, c.boundsMin, c.boundsMax, qlo, qhi);
+            uint32_t countField = count < 0 ? 0xFFFFu : (uint32_t)count;
+            node[4 + 3 * k] = qlo[0] | (qlo[1] << 8) | (qlo[2] << 16) | (qhi[0] << 24);
+            node[5 + 3 * k] = qhi[1] | (qhi[2] << 8) | (countField << 16);
+            node[6 + 3 * k] = (uint32_t)ref;
+        }
+    }
 }
 
 bool BVH::saveToFile(const std::string& filename) const {
@@ -0,0 +1,503 @@
+#include "CPURenderer.h"
+#include "SobolSampler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+const glm::vec3 kAmbientLightColor(0.05f, 0.05f, 0.05f);
+const float kShadowCutoff = 0.05f; // SHADOW_CUTOFF: less transmitted light counts as blocked
+
+// Unlike Ray, leaves the direction as given; the shader normalizes exactly where this code does
+struct TraceRay {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+struct Hit {
+    float t = 1e30f;
+    glm::vec3 point;
+    glm::vec3 normal;
+    int materialIndex = -1;
+    int instanceIdx = -1;
+};
+
+// Sample dimensions of a path, as DIM_* in pathtracer_common.glsl
+const int kDimCamera = 0;
+const int kDimsPerBounce = 8;
+const int kDimDirection = 0;
+const int kDimLobe = 2;
+const int kDimRoulette = 3;
+const int kDimLight = 4;
+const int kDimBRDFLobe = 5;
+
+int bounceDimension(int bounce, int offset) {
+    return kDimsPerBounce * (bounce + 1) + offset;
+}
+
+// The shader's PathSampler: one sample index of a pixel's Sobol sequence
+struct PathSampler {
+    uint32_t pixel;
+    uint32_t index;
+    float get(int dimension) const { return SobolSampler::sample(pixel, index, dimension); }
+    glm::vec2 get2D(int dimension) const { return glm::vec2(get(dimension), get(dimension + 1)); }
+};
+
+glm::vec3 tangentToWorld(const glm::vec3& normal, const glm::vec3& dir) {
+    glm::vec3 up = std::abs(normal.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+    glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+    return glm::normalize(tangent * dir.x + bitangent * dir.y + normal * dir.z);
+}
+
+glm::vec3 randomHemisphereDirection(const glm::vec3& normal, glm::vec2 xi) {
+    float u = xi.x;
+    float v = xi.y;
+    float theta = std::acos(std::sqrt(1.0f - u));
+    float phi = 2.0f * 3.14159f * v;
+    return tangentToWorld(normal, glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)));
+}
+
+glm::vec3 fresnelSchlick(float cosTheta, const glm::vec3& F0) {
+    return F0 + (1.0f - F0) * std::pow(1.0f - cosTheta, 5.0f);
+}
+
+// The shader's opaque BRDF and its cosine/GGX mixture sampling; see pathtracer_common.glsl
+float opaqueAlpha(const Material& material) {
+    float rough = std::max(material.roughness, 0.02f);
+    return rough * rough;
+}
+
+float ggxD(float NdotH, float alpha) {
+    float alpha2 = alpha * alpha;
+    float denom = NdotH * NdotH * (alpha2 - 1.0f) + 1.0f;
+    return alpha2 / (3.14159f * denom * denom);
+}
+
+glm::vec3 opaqueBRDFCos(const glm::vec3& N, const glm::vec3& V, const glm::vec3& L, const Material& material) {
+    float NdotL = glm::dot(N, L);
+    if (NdotL <= 0.0f) return glm::vec3(0.0f);
+    float NdotV = std::max(glm::dot(N, V), 0.0f);
+    glm::vec3 H = glm::normalize(L + V);
+    glm::vec3 F0 = glm::mix(glm::vec3(0.04f), material.albedo, material.metallic);
+    glm::vec3 F = fresnelSchlick(std::max(glm::dot(H, V), 0.0f), F0);
+    float D = ggxD(std::max(glm::dot(N, H), 0.0f), opaqueAlpha(material));
+    float rough = std::max(material.roughness, 0.02f);
+    float k = (rough + 1.0f) * (rough + 1.0f) / 8.0f;
+    float G = NdotV / (NdotV * (1.0f - k) + k) * (NdotL / (NdotL * (1.0f - k) + k));
+    glm::vec3 specular = (F * D * G) / std::max(4.0f * NdotV * NdotL, 0.0001f);
+    glm::vec3 diffuse = (1.0f - F) * material.albedo / 3.14159f;
+    return glm::max(glm::vec3(0.0f), (diffuse + specular) * NdotL);
+}
+
+float specularLobeProbability(const glm::vec3& N, const glm::vec3& V, const Material& material) {
+    glm::vec3 F0 = glm::mix(glm::vec3(0.04f), material.albedo, material.metallic);
+    glm::vec3 F = fresnelSchlick(std::max(glm::dot(N, V), 0.0f), F0);
+    const glm::vec3 luminance(0.2126f, 0.7152f, 0.0722f);
+    float specular = glm::dot(F, luminance);
+    float diffuse = glm::dot((1.0f - F) * material.albedo, luminance);
+    return glm::clamp(specular / std::max(specular + diffuse, 1e-4f), 0.1f, 0.9f);
+}
+
+float opaqueBRDFPdf(const glm::vec3& N, const glm::vec3& V, const glm::vec3& L, const Material& material, float specularProbability) {
+    float NdotL = glm::dot(N, L);
+    if (NdotL <= 0.0f) return 0.0f;
+    glm::vec3 H = glm::normalize(L + V);
+    float NdotH = std::max(glm::dot(N, H), 0.0f);
+    float ggxPdf = ggxD(NdotH, opaqueAlpha(material)) * NdotH / std::max(4.0f * glm::dot(H, V), 1e-4f);
+    return glm::mix(NdotL / 3.14159f, ggxPdf, specularProbability);
+}
+
+glm::vec3 sampleOpaqueBRDF(const glm::vec3& N, const glm::vec3& V, const Material& material, float specularProbability, float lobe,
+                           glm::vec2 xi) {
+    if (lobe >= specularProbability) return randomHemisphereDirection(N, xi);
+    float alpha = opaqueAlpha(material);
+    float cosTheta = std::sqrt((1.0f - xi.x) / (1.0f + (alpha * alpha - 1.0f) * xi.x));
+    float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    float phi = 2.0f * 3.14159f * xi.y;
+    glm::vec3 H = tangentToWorld(N, glm::vec3(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta));
+    return glm::reflect(-V, H);
+}
+
+glm::vec3 reflectRay(const glm::vec3& incident, const glm::vec3& normal) {
+    return incident - 2.0f * glm::dot(incident, normal) * normal;
+}
+
+bool refractDir(const glm::vec3& incident, const glm::vec3& normal, float eta, glm::vec3& refr) {
+    float cosi = glm::clamp(glm::dot(-incident, normal), -1.0f, 1.0f);
+    float sint2 = std::max(0.0f, 1.0f - cosi * cosi);
+    float k = 1.0f - eta * eta * sint2;
+    if (k < 0.0f) return false; // total internal reflection
+    refr = glm::normalize(eta * incident + (eta * cosi - std::sqrt(k)) * normal);
+    return true;
+}
+
+bool intersectAABB(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& bmin, const glm::vec3& bmax, float& tmin) {
+    glm::vec3 t0 = (bmin - origin) * invDir;
+    glm::vec3 t1 = (bmax - origin) * invDir;
+    glm::vec3 tsmaller = glm::min(t0, t1);
+    glm::vec3 tbigger = glm::max(t0, t1);
+    tmin = std::max(std::max(tsmaller.x, tsmaller.y), tsmaller.z);
+    float tmax = std::min(std::min(tbigger.x, tbigger.y), tbigger.z);
+    return tmax >= std::max(tmin, 0.0f);
+}
+
+// One per tile task; counts the closest-hit and shadow queries it issues
+struct Tracer {
+    const CPUScene& scene;
+    glm::vec3 cameraPosition;
+    int lightSamples;
+    uint64_t rays = 0;
+    // Traversal stacks, grown to whatever depth the trees need and reused across rays
+    std::vector<int> tlasStack;
+    std::vector<int> blasStack;
+
+    // traverseBLASBinary: closest hit in object space
+    bool traverseBLAS(const TraceRay& ray, const BVHInstance& inst, Hit& hit) {
+        bool found = false;
+        std::vector<int>& stack = blasStack;
+        stack.clear();
+        stack.push_back(0);
+        glm::vec3 invDir = 1.0f / ray.direction;
+        while (!stack.empty()) {
+            int nidx = stack.back();
+            stack.pop_back();
+            const BVHNode& node = scene.blasNodes[inst.blasNodeOffset + nidx];
+            float tmin;
+            if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin) || tmin > hit.t) continue;
+            if (node.count > 0) {
+                // Four triangles per kernel call, in triIndices order like the shader's intersectBLASLeaf loop
+                const TriangleBlock* blocks = &scene.blasLeafBlocks.blocks[scene.blasLeafBlocks.nodeFirstBlock[inst.blasNodeOffset + nidx]];
+                for (int b = 0; b * 4 < node.count; ++b) {
+                    float t;
+                    int lane = RayKernels::intersectTriangleBlock(blocks[b], ray.origin, ray.direction, hit.t, t);
+                    if (lane < 0) continue;
+                    glm::vec3 edge1(blocks[b].e1[0][lane], blocks[b].e1[1][lane], blocks[b].e1[2][lane]);
+                    glm::vec3 edge2(blocks[b].e2[0][lane], blocks[b].e2[1][lane], blocks[b].e2[2][lane]);
+                    hit.t = t;
+                    hit.point = ray.origin + ray.direction * t;
+                    hit.normal = glm::normalize(glm::cross(edge1, edge2));
+                    hit.materialIndex = scene.triangleMaterials[inst.globalTriOffset + blocks[b].tri[lane]];
+                    found = true;
+                }
+            } else {
+                stack.push_back(node.leftFirst);
+                stack.push_back(node.leftFirst + 1);
+            }
+        }
+        return found;
+    }
+
+    // traverseTLAS: closest hit in world space
+    bool traverseTLAS(const TraceRay& ray, Hit& hit) {
+        ++rays;
+        hit = Hit();
+        if (scene.tlasNodes.empty()) return false;
+        bool found = false;
+        std::vector<int>& stack = tlasStack;
+        stack.clear();
+        stack.push_back(0);
+        glm::vec3 invDir = 1.0f / ray.direction;
+        while (!stack.empty()) {
+            const BVHNode& node = scene.tlasNodes[stack.back()];
+            stack.pop_back();
+            float tmin;
+            if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin) || tmin > hit.t) continue;
+            if (node.count > 0) {
+                for (int i = 0; i < node.count; ++i) {
+                    int instIdx = scene.tlasIndices[node.leftFirst + i];
+                    const BVHInstance& inst = scene.instances[instIdx];
+                    TraceRay localRay{glm::vec3(inst.inverseTransform * glm::vec4(ray.origin, 1.0f)),
+                                      glm::normalize(glm::vec3(inst.inverseTransform * glm::vec4(ray.direction, 0.0f)))};
+                    Hit local;
+                    if (!traverseBLAS(localRay, inst, local)) continue;
+                    glm::vec3 worldHit = glm::vec3(inst.transform * glm::vec4(local.point, 1.0f));
+                    float tWorld = glm::length(worldHit - ray.origin);
+                    if (tWorld < hit.t) {
+                        hit.t = tWorld;
+                        hit.point = worldHit;
+                        hit.normal = glm::normalize(glm::mat3(glm::transpose(inst.inverseTransform)) * local.normal);
+                        hit.materialIndex = local.materialIndex;
+                        hit.instanceIdx = instIdx;
+                        found = true;
+                    }
+                }
+            } else {
+                stack.push_back(node.leftFirst);
+                stack.push_back(node.leftFirst + 1);
+            }
+        }
+        return found;
+    }
+
+    // occludeBLASBinary: scales transmittance by the transparency of every surface closer than
+    // tMax; true once an opaque surface or too little light remains
+    bool occludeBLAS(const TraceRay& ray, const BVHInstance& inst, float tMax, float& transmittance) {
+        std::vector<int>& stack = blasStack;
+        stack.clear();
+        stack.push_back(0);
+        glm::vec3 invDir = 1.0f / ray.direction;
+        while (!stack.empty()) {
+            int nidx = stack.back();
+            stack.pop_back();
+            const BVHNode& node = scene.blasNodes[inst.blasNodeOffset + nidx];
+            float tmin;
+            if (!intersectAABB(ray.origin, invDir, node.boundsMin, node.boundsMax, tmin) || tmin > tMax) continue;
+            if (node.count > 0) {
+                const TriangleBlock* blocks = &scene.blasLeafBlocks.blocks[scene.blasLeafBlocks.nodeFirstBlock[inst.blasNodeOffset + nidx]];
+                for (int b = 0; b * 4 < node.count; ++b) {
+                    uint32_t lanes = RayKernels::intersectTriangleBlockAny(blocks[b], ray.origin, ray.direction, tMax);
+                    for (int lane = 0; lanes; ++lane, lanes >>= 1) {
+                        if (!(lanes & 1u)) continue;
+                        transmittance *= scene.materials[scene.triangleMaterials[inst.globalTriOffset + blocks[b].tri[lane]]].transparency;
+                        if (transmittance <= kShadowCutoff) return true;
+                    }
+                }
+            } else {
+                stack.push_back(node.leftFirst);
+                stack.push_back(node.leftFirst + 1);
+            }
+        }
+        return false;
+    }
+
+    // shadowTransmittance: fraction of light reaching maxDist, in one any-hit traversal
+    float shadowTransmittance(const glm::vec3& origin, const glm::vec3& dir, float maxDist) {
+        ++rays;
+        if (scene.tlasNodes.empty()) return 1.0f;
+        float transmittance = 1.0f;
+        std::vector<int>& stack = tlasStack;
+        stack.clear();
+        stack.push_back(0);
+        glm::vec3 invDir = 1.0f / dir;
+        while (!stack.empty()) {
+            const BVHNode& node = scene.tlasNodes[stack.back()];
+            stack.pop_back();
+            float tmin;
+            if (!intersectAABB(origin, invDir, node.boundsMin, node.boundsMax, tmin) || tmin > maxDist) continue;
+            if (node.count > 0) {
+                for (int i = 0; i < node.count; ++i) {
+                    const BVHInstance& inst = scene.instances[scene.tlasIndices[node.leftFirst + i]];
+                    glm::vec3 localDir = glm::vec3(inst.inverseTransform * glm::vec4(dir, 0.0f));
+                    TraceRay localRay{glm::vec3(inst.inverseTransform * glm::vec4(origin, 1.0f)), glm::normalize(localDir)};
+                    if (occludeBLAS(localRay, inst, maxDist * glm::length(localDir), transmittance)) return 0.0f;
+                }
+            } else {
+                stack.push_back(node.leftFirst);
+                stack.push_back(node.leftFirst + 1);
+            }
+        }
+        return transmittance;
+    }
+
+    bool shadowVisibility(const glm::vec3& origin, const glm::vec3& dir, float maxDist, float& visibility) {
+        visibility = shadowTransmittance(origin, dir, maxDist);
+        return visibility > kShadowCutoff;
+    }
+
+    glm::vec3 directLight(const Light& light, const glm::vec3& hitPoint, const glm::vec3& normal, const Material& material,
+                          const glm::vec3& viewDir) {
+        // Transparent dielectrics only get the specular lobe
+        if (material.transparency > 0.0f) {
+            glm::vec3 F0(std::pow((1.0f - material.ior) / (1.0f + material.ior), 2.0f));
+            glm::vec3 L;
+            float attenuation, visibility;
+            if (light.positionOrDirection.w == 1.0f) {
+                glm::vec3 lv = glm::vec3(light.positionOrDirection) - hitPoint;
+                float dist = std::max(glm::length(lv), 0.001f);
+                L = lv / dist;
+                attenuation = light.power / (dist * dist);
+                if (!shadowVisibility(hitPoint + L * 0.001f, L, dist, visibility)) return glm::vec3(0.0f);
+            } else {
+                L = glm::normalize(glm::vec3(light.positionOrDirection));
+                attenuation = light.power;
+                if (!shadowVisibility(hitPoint + L * 0.001f, L, 1e30f, visibility)) return glm::vec3(0.0f);
+            }
+            attenuation *= visibility;
+            float NdotL = std::max(glm::dot(normal, L), 0.0f);
+            if (NdotL <= 0.0f) return glm::vec3(0.0f);
+            glm::vec3 H = glm::normalize(L + viewDir);
+            float NdotH = std::max(glm::dot(normal, H), 0.0f);
+            float cosTheta = std::max(glm::dot(H, viewDir), 0.0f);
+            glm::vec3 F = fresnelSchlick(cosTheta, F0);
+            float rough = std::max(material.roughness, 0.02f);
+            float a = rough * rough;
+            float a2 = a * a;
+            float dDen = (NdotH * NdotH) * (a2 - 1.0f) + 1.0f;
+            float D = a2 / (3.14159f * dDen * dDen + 1e-6f);
+            float k = (rough + 1.0f) * (rough + 1.0f) / 8.0f;
+            float NdotV = std::max(glm::dot(normal, viewDir), 0.0f);
+            float Gv = NdotV / (NdotV * (1.0f - k) + k + 1e-6f);
+            float Gl = NdotL / (NdotL * (1.0f - k) + k + 1e-6f);
+            float denom = std::max(4.0f * NdotL * NdotV, 1e-4f);
+            glm::vec3 spec = (F * D * Gv * Gl) / denom;
+            return spec * light.color * attenuation * NdotL;
+        }
+        glm::vec3 lightDir;
+        float attenuation, visibility;
+        if (light.positionOrDirection.w == 1.0f) {
+            glm::vec3 lightVec = glm::vec3(light.positionOrDirection) - hitPoint;
+            float distance = std::max(glm::length(lightVec), 0.001f);
+            lightDir = glm::normalize(lightVec);
+            attenuation = light.power / (distance * distance);
+            if (!shadowVisibility(hitPoint + lightDir * 0.001f, lightDir, distance, visibility)) return glm::vec3(0.0f);
+        } else {
+            lightDir = glm::normalize(glm::vec3(light.positionOrDirection));
+            attenuation = light.power;
+            if (!shadowVisibility(hitPoint + lightDir * 0.001f, lightDir, 1e30f, visibility)) return glm::vec3(0.0f);
+        }
+        attenuation *= visibility;
+        return opaqueBRDFCos(normal, viewDir, lightDir, material) * (1.0f - material.reflectivity) * light.color * attenuation;
+    }
+
+    // Every light while there are at most lightSamples point lights, else the directional lights
+    // plus lightSamples power-weighted, stratified picks from the alias table, as in the shader
+    glm::vec3 calculateLighting(const glm::vec3& hitPoint, const glm::vec3& normal, const Material& material, const glm::vec3& viewDir,
+                                const PathSampler& sampler, int bounce) {
+        glm::vec3 color = (bounce > 0 || material.transparency > 0.0f) ? glm::vec3(0.0f) : kAmbientLightColor * material.albedo;
+        const LightTable& table = scene.lightTable;
+        bool sampled = lightSamples > 0 && table.pointLightCount > lightSamples;
+        int count = sampled ? table.directionalLightCount + lightSamples : static_cast<int>(scene.lights.size());
+        float pickOffset = sampled ? sampler.get(bounceDimension(bounce, kDimLight)) : 0.0f;
+        for (int i = 0; i < count; ++i) {
+            int light = i;
+            float weight = 1.0f;
+            if (sampled && i < table.directionalLightCount) {
+                light = table.entries[table.pointLightCount + i].light;
+            } else if (sampled) {
+                float pdf;
+                light = table.sample((float(i - table.directionalLightCount) + pickOffset) / float(lightSamples), pdf);
+                weight = 1.0f / (pdf * float(lightSamples));
+            }
+            color += directLight(scene.lights[light], hitPoint, normal, material, viewDir) * weight;
+        }
+        return color;
+    }
+
+    // The shader's main() for one pixel, without the debug and FPS overlays
+    glm::vec3 tracePixel(glm::vec2 fragCoord, glm::vec2 resolution, const glm::mat4& invView, const glm::mat4& invProj,
+                         int samples, int maxBounces) {
+        glm::vec2 uv = fragCoord / resolution;
+        glm::vec3 color(0.0f);
+        uint32_t pixel = SobolSampler::pixelSeed(static_cast<uint32_t>(fragCoord.x), static_cast<uint32_t>(fragCoord.y));
+        for (int samp = 0; samp < samples; ++samp) {
+            PathSampler sampler{pixel, static_cast<uint32_t>(samp)};
+            // calculateRay
+            glm::vec2 jittered = uv + sampler.get2D(kDimCamera) * 0.00002f;
+            glm::vec2 ndc = jittered * 2.0f - 1.0f;
+            glm::vec4 rayEye = invProj * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+            glm::vec3 currentOrigin = cameraPosition;
+            glm::vec3 currentDirection = glm::normalize(glm::vec3(invView * glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f)));
+            glm::vec3 throughput(1.0f);
+            glm::vec3 radiance(0.0f);
+            float currentIor = 1.0f;
+
+            for (int bounce = 0; bounce < maxBounces; ++bounce) {
+                Hit hit;
+                if (!traverseTLAS(TraceRay{currentOrigin, currentDirection}, hit)) {
+                    float t = 0.5f * (glm::normalize(currentDirection).y + 1.0f);
+                    radiance += throughput * glm::mix(glm::vec3(0.15f, 0.25f, 0.45f), glm::vec3(0.5f, 0.7f, 1.0f), t);
+                    break;
+                }
+                const Material& hitMaterial = scene.materials[hit.materialIndex];
+                glm::vec3 viewDir = -glm::normalize(currentDirection);
+                // Next-event estimation at every vertex, as in the shader
+                radiance += throughput * calculateLighting(hit.point, hit.normal, hitMaterial, viewDir, sampler, bounce);
+
+                float randVal = sampler.get(bounceDimension(bounce, kDimLobe));
+                if (hitMaterial.transparency > 0.0f) {
+                    bool entering = glm::dot(-currentDirection, hit.normal) > 0.0f;
+                    glm::vec3 N = entering ? hit.normal : -hit.normal;
+                    float extIor = currentIor;
+                    float nextIor = entering ? hitMaterial.ior : 1.0f;
+                    float eta = extIor / nextIor;
+                    float cosi = glm::clamp(glm::dot(-currentDirection, N), 0.0f, 1.0f);
+                    float F0 = std::pow((extIor - nextIor) / (extIor + nextIor), 2.0f);
+                    float fresnel = F0 + (1.0f - F0) * std::pow(1.0f - cosi, 5.0f);
+                    glm::vec3 refr;
+                    if (!refractDir(currentDirection, N, eta, refr)) {
+                        currentDirection = reflectRay(currentDirection, N);
+                        throughput *= glm::vec3(0.98f);
+                    } else {
+                        currentDirection = refr;
+                        currentIor = nextIor;
+                        glm::vec3 tint = glm::mix(glm::vec3(1.0f), hitMaterial.albedo, hitMaterial.transparency);
+                        glm::vec3 transmitWeight = tint * hitMaterial.transparency * (1.0f - fresnel);
+                        throughput *= glm::clamp(transmitWeight, glm::vec3(0.0f), glm::vec3(1.0f));
+                    }
+                } else if (randVal < hitMaterial.reflectivity) {
+                    currentDirection = reflectRay(currentDirection, hit.normal);
+                    throughput *= glm::vec3(0.95f);
+                } else {
+                    glm::vec3 V = -currentDirection;
+                    glm::vec3 N = glm::dot(hit.normal, V) < 0.0f ? -hit.normal : hit.normal;
+                    float specularProbability = specularLobeProbability(N, V, hitMaterial);
+                    glm::vec3 L = sampleOpaqueBRDF(N, V, hitMaterial, specularProbability, sampler.get(bounceDimension(bounce, kDimBRDFLobe)),
+                                                   sampler.get2D(bounceDimension(bounce, kDimDirection)));
+                    float pdf = opaqueBRDFPdf(N, V, L, hitMaterial, specularProbability);
+                    if (pdf <= 0.0f) break;
+                    currentDirection = L;
+                    throughput *= opaqueBRDFCos(N, V, L, hitMaterial) / pdf;
+                }
+                float pushDir = glm::dot(currentDirection, hit.normal) > 0.0f ? 1.0f : -1.0f;
+                currentOrigin = hit.point + hit.normal * pushDir * 0.003f;
+
+                if (bounce > 2) {
+                    float p = std::max(throughput.x, std::max(throughput.y, throughput.z));
+                    if (sampler.get(bounceDimension(bounce, kDimRoulette)) > p) break;
+                    throughput /= p;
+                }
+            }
+            // Each sample is clamped before it is averaged, as the shaders accumulate them
+            color += glm::clamp(radiance, 0.0f, 1.0f);
+        }
+        return color / float(samples);
+    }
+};
+}
+
+CPURenderStats CPURenderer::render(const Camera& camera, const CPURenderSettings& settings, std::vector<glm::vec3>& image) const {
+    CPURenderStats stats;
+    int width = std::max(settings.width, 1);
+    int height = std::max(settings.height, 1);
+    int tileSize = std::max(settings.tileSize, 1);
+    int samples = std::max(settings.samplesPerPixel, 1);
+    int maxBounces = settings.maxBounces > 0 ? settings.maxBounces : 5;
+    image.assign(static_cast<size_t>(width) * height, glm::vec3(0.0f));
+    const glm::mat4& invView = camera.invViewMatrix;
+    const glm::mat4& invProj = camera.invProjectionMatrix;
+    glm::vec2 resolution(static_cast<float>(width), static_cast<float>(height));
+
+    ThreadPool& pool = ThreadPool::shared();
+    ThreadPool::TaskGroup group;
+    std::atomic<uint64_t> rays{0};
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    auto start = std::chrono::high_resolution_clock::now();
+    // One task per tile; workers steal tiles from each other, so expensive regions (glass) balance out
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            pool.run(group, [&, tx, ty]() {
+                Tracer tracer{scene, camera.position, settings.lightSamples};
+                int x1 = std::min((tx + 1) * tileSize, width);
+                int y1 = std::min((ty + 1) * tileSize, height);
+                for (int y = ty * tileSize; y < y1; ++y) {
+                    for (int x = tx * tileSize; x < x1; ++x) {
+                        // gl_FragCoord: pixel centers, origin at the bottom left
+                        glm::vec2 fragCoord(x + 0.5f, (height - 1 - y) + 0.5f);
+                        image[static_cast<size_t>(y) * width + x] = tracer.tracePixel(fragCoord, resolution, invView, invProj, samples, maxBounces);
+                    }
+                }
+                rays.fetch_add(tracer.rays, std::memory_order_relaxed);
+            });
+        }
+    }
+    pool.wait(group);
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    stats.rays = rays.load();
+    stats.tiles = tilesX * tilesY;
+    stats.threads = pool.size();
+    return stats;
+}
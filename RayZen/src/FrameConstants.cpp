@@ -0,0 +1,61 @@
+#include "FrameConstants.h"
+#include "Logger.h"
+#include <cstring>
+#include <string>
+
+namespace {
+const GLuint64 kFenceTimeoutNs = 1000000000; // per wait; waiting continues until the slot is free
+}
+
+void FrameConstantRing::create() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0) alignment = 256;
+    slotStride = (static_cast<GLsizeiptr>(sizeof(FrameConstants)) + alignment - 1) / alignment * alignment;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, slotStride * kSlots, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, slotStride * kSlots, flags));
+    }
+    if (!mapped) glBufferData(GL_UNIFORM_BUFFER, slotStride * kSlots, nullptr, GL_DYNAMIC_DRAW);
+    Logger::info("Frame constants: " + std::to_string(kSlots) + " x " + std::to_string(slotStride) + " byte uniform buffer slots" +
+                 (mapped ? ", persistently mapped" : ", updated with glBufferSubData"));
+}
+
+void FrameConstantRing::publish(const FrameConstants& constants) {
+    if (!buffer) create();
+    if (slot >= 0 && !fences[slot]) fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot = (slot + 1) % kSlots;
+    if (fences[slot]) {
+        while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNs) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+    }
+    GLintptr offset = slot * slotStride;
+    if (mapped) {
+        std::memcpy(mapped + offset, &constants, sizeof(constants));
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(constants), &constants);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, kBinding, buffer, offset, sizeof(constants));
+}
+
+void FrameConstantRing::destroy() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (buffer) {
+        if (mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapped = nullptr;
+    slot = -1;
+}
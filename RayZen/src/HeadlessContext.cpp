@@ -0,0 +1,119 @@
+#include "HeadlessContext.h"
+#include "Logger.h"
+#include <cstring>
+#include <string>
+#ifdef RAYZEN_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef RAYZEN_HAVE_EGL
+namespace {
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) return false;
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return true;
+    }
+    return false;
+}
+}
+
+bool HeadlessContext::create() {
+    destroy();
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint eglMajor = 0, eglMinor = 0;
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &eglMajor, &eglMinor)) {
+        Logger::error("Headless: no EGL display could be initialized");
+        return false;
+    }
+    display = dpy;
+    const char* vendor = eglQueryString(dpy, EGL_VENDOR);
+    Logger::info("Headless: EGL " + std::to_string(eglMajor) + "." + std::to_string(eglMinor) + " (" + (vendor ? vendor : "unknown vendor") + ")");
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        Logger::error("Headless: EGL display has no desktop OpenGL support");
+        destroy();
+        return false;
+    }
+
+    // Rendering goes to an FBO, so the context only needs a surface where surfaceless contexts are unsupported
+    bool surfaceless = hasExtension(eglQueryString(dpy, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(dpy, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        Logger::error("Headless: no EGL config for desktop OpenGL");
+        destroy();
+        return false;
+    }
+
+    const int candidates[][2] = {{4, 6}, {4, 5}, {4, 3}};
+    for (const auto& candidate : candidates) {
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION_KHR, candidate[0],
+            EGL_CONTEXT_MINOR_VERSION_KHR, candidate[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+            EGL_NONE
+        };
+        EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+        if (ctx != EGL_NO_CONTEXT) {
+            context = ctx;
+            major = candidate[0];
+            minor = candidate[1];
+            break;
+        }
+        Logger::info("Headless: failed to create OpenGL context " + std::to_string(candidate[0]) + "." + std::to_string(candidate[1]) + ", trying lower version");
+    }
+    if (!context) {
+        Logger::error("Headless: no OpenGL 4.3+ core context available");
+        destroy();
+        return false;
+    }
+
+    EGLSurface surf = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surf = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+        if (surf == EGL_NO_SURFACE) {
+            Logger::error("Headless: failed to create EGL pbuffer surface");
+            destroy();
+            return false;
+        }
+        surface = surf;
+    }
+    if (!eglMakeCurrent(dpy, surf, surf, static_cast<EGLContext>(context))) {
+        Logger::error("Headless: failed to make the EGL context current");
+        destroy();
+        return false;
+    }
+    Logger::info("Headless: created OpenGL context " + std::to_string(major) + "." + std::to_string(minor) + (surfaceless ? " (surfaceless)" : " (pbuffer)"));
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (!display) return;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (surface) eglDestroySurface(display, surface);
+    if (context) eglDestroyContext(display, context);
+    eglTerminate(display);
+    display = context = surface = nullptr;
+    major = minor = 0;
+}
+#else
+bool HeadlessContext::create() {
+    Logger::error("Headless: this build has no EGL support");
+    return false;
+}
+
+void HeadlessContext::destroy() {}
+#endif
@@ -0,0 +1,171 @@
+#include "ImageIO.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace {
+unsigned char toByte(float value) {
+    return static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256] = {};
+    if (table[1] == 0) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<unsigned char>(value >> shift));
+}
+
+void writeChunk(std::ofstream& ofs, const char type[4], const std::vector<unsigned char>& payload) {
+    std::vector<unsigned char> chunk;
+    appendBigEndian(chunk, static_cast<uint32_t>(payload.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), payload.begin(), payload.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    ofs.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+bool hasExtension(const std::string& path, const std::string& extension) {
+    if (path.size() < extension.size()) return false;
+    return std::equal(extension.rbegin(), extension.rend(), path.rbegin(),
+        [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); });
+}
+}
+
+namespace ImageIO {
+bool writePPM(const std::string& path, int width, int height, const std::vector<glm::vec3>& image) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) return false;
+    ofs << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const glm::vec3& c = image[static_cast<size_t>(y) * width + x];
+            for (int k = 0; k < 3; ++k) row[x * 3 + k] = toByte(c[k]);
+        }
+        ofs.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+    return ofs.good();
+}
+
+bool writePNG(const std::string& path, int width, int height, const std::vector<glm::vec3>& image) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) return false;
+    const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    ofs.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<unsigned char> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, adaptive filtering, no interlace
+    writeChunk(ofs, "IHDR", header);
+
+    // Scanlines with filter type 0, stored as zlib stream of uncompressed deflate blocks
+    size_t rowBytes = static_cast<size_t>(width) * 3 + 1;
+    std::vector<unsigned char> raw(rowBytes * height);
+    for (int y = 0; y < height; ++y) {
+        unsigned char* row = raw.data() + rowBytes * y;
+        row[0] = 0;
+        for (int x = 0; x < width; ++x) {
+            const glm::vec3& c = image[static_cast<size_t>(y) * width + x];
+            for (int k = 0; k < 3; ++k) row[1 + x * 3 + k] = toByte(c[k]);
+        }
+    }
+    const size_t kMaxBlock = 65535;
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    zlib.reserve(raw.size() + raw.size() / kMaxBlock * 5 + 16);
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min(kMaxBlock, raw.size() - offset);
+        bool last = offset + blockSize == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+        zlib.push_back(static_cast<unsigned char>(~blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>((~blockSize >> 8) & 0xFF));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+    uint32_t a = 1, b = 0; // Adler-32
+    for (unsigned char byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+    writeChunk(ofs, "IDAT", zlib);
+    writeChunk(ofs, "IEND", {});
+    return ofs.good();
+}
+
+bool writePFM(const std::string& path, int width, int height, const std::vector<glm::vec3>& image) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) return false;
+    // Negative scale marks little-endian data; PFM stores the bottom row first
+    ofs << "PF\n" << width << " " << height << "\n-1.0\n";
+    std::vector<float> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; --y) {
+        for (int x = 0; x < width; ++x) {
+            const glm::vec3& c = image[static_cast<size_t>(y) * width + x];
+            for (int k = 0; k < 3; ++k) row[x * 3 + k] = c[k];
+        }
+        ofs.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+    }
+    return ofs.good();
+}
+
+bool write(const std::string& path, int width, int height, const std::vector<glm::vec3>& image) {
+    if (hasExtension(path, ".png")) return writePNG(path, width, height, image);
+    if (hasExtension(path, ".pfm")) return writePFM(path, width, height, image);
+    return writePPM(path, width, height, image);
+}
+
+bool readPFM(const std::string& path, int& width, int& height, std::vector<glm::vec3>& image) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::string magic;
+    float scale = 0.0f;
+    if (!(ifs >> magic >> width >> height >> scale) || magic != "PF" || width <= 0 || height <= 0 || scale == 0.0f) return false;
+    ifs.get(); // the single whitespace before the data
+    std::vector<float> data(static_cast<size_t>(width) * height * 3);
+    if (!ifs.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(float)))) return false;
+    const uint16_t probe = 1;
+    bool hostLittleEndian = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+    if ((scale < 0.0f) != hostLittleEndian) {
+        for (float& value : data) {
+            unsigned char bytes[4];
+            std::memcpy(bytes, &value, 4);
+            std::reverse(bytes, bytes + 4);
+            std::memcpy(&value, bytes, 4);
+        }
+    }
+    image.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        const float* row = data.data() + static_cast<size_t>(height - 1 - y) * width * 3;
+        for (int x = 0; x < width; ++x) image[static_cast<size_t>(y) * width + x] = glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]);
+    }
+    return true;
+}
+
+double rmse(const std::vector<glm::vec3>& image, const std::vector<glm::vec3>& reference) {
+    size_t count = std::min(image.size(), reference.size());
+    if (count == 0) return 0.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 d = image[i] - reference[i];
+        sum += double(d.x) * d.x + double(d.y) * d.y + double(d.z) * d.z;
+    }
+    return std::sqrt(sum / double(count * 3));
+}
+}
@@ -0,0 +1,61 @@
+#include "LightTable.h"
+#include <algorithm>
+
+LightTable LightTable::build(const std::vector<Light>& lights) {
+    LightTable table;
+    std::vector<int> pointLights, directionalLights;
+    std::vector<double> weights;
+    double total = 0.0;
+    for (int i = 0; i < static_cast<int>(lights.size()); ++i) {
+        const Light& light = lights[i];
+        if (!light.isPointLight()) {
+            directionalLights.push_back(i);
+            continue;
+        }
+        double luminance = 0.2126 * light.color.x + 0.7152 * light.color.y + 0.0722 * light.color.z;
+        weights.push_back(std::max(0.0, static_cast<double>(light.power) * luminance));
+        pointLights.push_back(i);
+        total += weights.back();
+    }
+    const int count = static_cast<int>(pointLights.size());
+    if (total <= 0.0) { // all black: pick uniformly
+        std::fill(weights.begin(), weights.end(), 1.0);
+        total = count;
+    }
+
+    // Split slots into under- and overfull ones and let each underfull slot borrow the rest of
+    // its probability from an overfull one
+    std::vector<double> scaled(count);
+    std::vector<int> small, large;
+    for (int i = 0; i < count; ++i) {
+        scaled[i] = weights[i] * count / total;
+        table.entries.push_back({1.0f, i, static_cast<float>(weights[i] / total), pointLights[i]});
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        int under = small.back(), over = large.back();
+        small.pop_back();
+        table.entries[under].threshold = static_cast<float>(scaled[under]);
+        table.entries[under].alias = over;
+        scaled[over] -= 1.0 - scaled[under];
+        if (scaled[over] < 1.0) {
+            large.pop_back();
+            small.push_back(over);
+        }
+    }
+    // Whatever is left over is full up to rounding and keeps threshold 1
+
+    for (int light : directionalLights) table.entries.push_back({1.0f, 0, 1.0f, light});
+    table.pointLightCount = count;
+    table.directionalLightCount = static_cast<int>(directionalLights.size());
+    return table;
+}
+
+int LightTable::sample(float u, float& pdf) const {
+    float scaled = u * pointLightCount;
+    int slot = std::min(static_cast<int>(scaled), pointLightCount - 1);
+    const LightAliasEntry* entry = &entries[slot];
+    if (scaled - slot >= entry->threshold) entry = &entries[entry->alias];
+    pdf = entry->pdf;
+    return entry->light;
+}
@@ -1,50 +1,247 @@
 #include "Mesh.h"
 #include "Logger.h"
-#include <fstream>
-#include <sstream>
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-bool Mesh::loadFromOBJ(const std::string& filename, int materialIndex) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        Logger::error("Failed to open OBJ file: " + filename);
-        return false;
+namespace {
+// Files are split into chunks of about this size, each ending after a newline
+const size_t kOBJChunkBytes = 4u << 20;
+
+// Read-only mapping of a whole file
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0;
+        if (ok && st.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ok = mapped != MAP_FAILED;
+            if (ok) {
+                madvise(mapped, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                data = static_cast<const char*>(mapped);
+                size = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        return ok;
     }
-    
-    std::vector<glm::vec3> vertices;
-    std::string line;
-    while (std::getline(file, line)) {
-        // Parse vertex lines (e.g., "v 0.0 1.0 0.0")
-        if (line.substr(0, 2) == "v ") {
-            std::istringstream iss(line.substr(2));
-            glm::vec3 v;
-            iss >> v.x >> v.y >> v.z;
-            vertices.push_back(v);
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isBlank(*p) && *p != '\n') ++p;
+    return p;
+}
+
+// Parses a decimal float such as "-1.25e-3" without allocating. Anything else (inf, nan, hex floats)
+// goes through strtof on a stack copy of the token, since the mapping is not NUL-terminated.
+const char* parseFloat(const char* p, const char* end, float& out) {
+    static const double kPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+                                    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+        if (mantissa < 1000000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+        else ++exponent; // beyond 19 digits only the magnitude matters
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+            if (mantissa < 1000000000000000000ull) {
+                mantissa = mantissa * 10 + (*p - '0');
+                --exponent;
+            }
         }
-        // Parse face lines (supports tokens like "3//1" by splitting on '/')
-        else if (line.substr(0, 2) == "f ") {
-            std::istringstream iss(line.substr(2));
-            std::vector<unsigned int> vertexIndices;
-            std::string token;
-            while (iss >> token) {
-                size_t pos = token.find('/');
-                std::string indexStr = (pos == std::string::npos) ? token : token.substr(0, pos);
-                unsigned int index = std::stoi(indexStr);
-                vertexIndices.push_back(index);
+    }
+    if (digits > 0 && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExp = false;
+        if (q < end && (*q == '-' || *q == '+')) negativeExp = *q++ == '-';
+        if (q < end && *q >= '0' && *q <= '9') {
+            int e = 0;
+            for (; q < end && *q >= '0' && *q <= '9'; ++q) e = std::min(e * 10 + (*q - '0'), 10000);
+            exponent += negativeExp ? -e : e;
+            p = q;
+        }
+    }
+    const char* tokenEnd = skipToken(p, end);
+    if (digits == 0 || p != tokenEnd) {
+        char buf[64];
+        size_t len = std::min(static_cast<size_t>(tokenEnd - start), sizeof(buf) - 1);
+        std::memcpy(buf, start, len);
+        buf[len] = '\0';
+        out = std::strtof(buf, nullptr);
+        return tokenEnd;
+    }
+    double value = static_cast<double>(mantissa);
+    while (exponent > 22) { value *= 1e22; exponent -= 22; }
+    while (exponent < -22) { value /= 1e22; exponent += 22; }
+    value = exponent >= 0 ? value * kPow10[exponent] : value / kPow10[-exponent];
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+// Parses the leading integer of a face token ("7", "-2", "7/1/3", "7//3"); false if there is none
+const char* parseIndex(const char* p, const char* end, long long& out, bool& ok) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    long long value = 0;
+    const char* digitsStart = p;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) value = std::min(value * 10 + (*p - '0'), 1LL << 40);
+    ok = p != digitsStart;
+    out = negative ? -value : value;
+    return skipToken(p, end);
+}
+
+// Output of the first pass over one chunk. Corners hold 0-based vertex indices, already fan
+// triangulated; corners from negative (relative) indices are stored relative to the chunk's first
+// vertex and listed in relativeCorners, to be shifted once the vertex counts of earlier chunks are known.
+struct OBJChunk {
+    std::vector<glm::vec3> vertices;
+    std::vector<long long> corners;
+    std::vector<size_t> relativeCorners;
+    bool malformedFace = false;
+};
+
+void parseOBJChunk(const char* p, const char* end, OBJChunk& chunk) {
+    // Rough preallocation: a typical "v"/"f" line is 25-40 bytes
+    chunk.vertices.reserve(static_cast<size_t>(end - p) / 64);
+    chunk.corners.reserve(static_cast<size_t>(end - p) / 16);
+    long long face[64];
+    bool faceRelative[64];
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!lineEnd) lineEnd = end;
+        if (lineEnd - p >= 2 && p[0] == 'v' && p[1] == ' ') {
+            glm::vec3 v(0.0f);
+            const char* q = p + 2;
+            for (int axis = 0; axis < 3; ++axis) {
+                q = skipBlanks(q, lineEnd);
+                if (q == lineEnd) break;
+                q = parseFloat(q, lineEnd, v[axis]);
+            }
+            chunk.vertices.push_back(v);
+        } else if (lineEnd - p >= 2 && p[0] == 'f' && p[1] == ' ') {
+            long long localVertexCount = static_cast<long long>(chunk.vertices.size());
+            int count = 0;
+            const char* q = skipBlanks(p + 2, lineEnd);
+            while (q < lineEnd) {
+                long long index;
+                bool ok;
+                q = skipBlanks(parseIndex(q, lineEnd, index, ok), lineEnd);
+                if (!ok || index == 0) {
+                    chunk.malformedFace = true;
+                    count = 0;
+                    break;
+                }
+                if (count == 64) continue; // polygons beyond 64 corners keep their first 64
+                faceRelative[count] = index < 0;
+                // OBJ indices are 1-based; negative ones count back from the last vertex seen
+                face[count++] = index > 0 ? index - 1 : localVertexCount + index;
             }
             // Triangulate the face (supports both triangles and polygons)
-            if (vertexIndices.size() >= 3) {
-                for (size_t i = 1; i < vertexIndices.size() - 1; ++i) {
-                    Triangle tri;
-                    // OBJ indices are 1-based.
-                    tri.v0 = vertices[vertexIndices[0] - 1];
-                    tri.v1 = vertices[vertexIndices[i] - 1];
-                    tri.v2 = vertices[vertexIndices[i + 1] - 1];
-                    tri.materialIndex = materialIndex;
-                    triangles.push_back(tri);
+            for (int i = 1; i + 1 < count; ++i) {
+                const int fan[3] = {0, i, i + 1};
+                for (int c : fan) {
+                    if (faceRelative[c]) chunk.relativeCorners.push_back(chunk.corners.size());
+                    chunk.corners.push_back(face[c]);
                 }
             }
         }
+        p = lineEnd + 1;
+    }
+}
+}
+
+bool Mesh::loadFromOBJ(const std::string& filename, int materialIndex) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        Logger::error("Failed to open OBJ file: " + filename);
+        return false;
+    }
+
+    // Newline-aligned chunks are parsed independently; vertex and triangle counts are stitched together afterwards
+    std::vector<const char*> bounds{file.data};
+    const char* fileEnd = file.data + file.size;
+    while (static_cast<size_t>(fileEnd - bounds.back()) > kOBJChunkBytes) {
+        const char* split = bounds.back() + kOBJChunkBytes;
+        const char* newline = static_cast<const char*>(std::memchr(split, '\n', static_cast<size_t>(fileEnd - split)));
+        if (!newline) break;
+        bounds.push_back(newline + 1);
+    }
+    bounds.push_back(fileEnd);
+    int chunkCount = static_cast<int>(bounds.size()) - 1;
+    std::vector<OBJChunk> chunks(chunkCount);
+    ThreadPool& pool = ThreadPool::shared();
+    pool.parallelFor(0, chunkCount, 1, [&](int begin, int end, int) {
+        for (int c = begin; c < end; ++c) parseOBJChunk(bounds[c], bounds[c + 1], chunks[c]);
+    });
+
+    // Positive indices are relative to this file's first vertex, which follows any vertices already in the mesh
+    size_t firstVertex = vertices.size();
+    size_t firstTriangle = indices.size();
+    std::vector<size_t> vertexBase(chunkCount + 1, 0), triangleBase(chunkCount + 1, 0);
+    for (int c = 0; c < chunkCount; ++c) {
+        vertexBase[c + 1] = vertexBase[c] + chunks[c].vertices.size();
+        triangleBase[c + 1] = triangleBase[c] + chunks[c].corners.size() / 3;
+        if (chunks[c].malformedFace) Logger::error("Skipped malformed face indices in OBJ file: " + filename);
+    }
+    vertices.resize(firstVertex + vertexBase[chunkCount]);
+    indices.resize(firstTriangle + triangleBase[chunkCount]);
+    materials.resize(firstTriangle + triangleBase[chunkCount], materialIndex);
+    std::atomic<bool> indexOutOfRange{false};
+    pool.parallelFor(0, chunkCount, 1, [&](int begin, int end, int) {
+        long long fileVertexCount = static_cast<long long>(vertexBase[chunkCount]);
+        for (int c = begin; c < end; ++c) {
+            OBJChunk& chunk = chunks[c];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + firstVertex + vertexBase[c]);
+            for (size_t corner : chunk.relativeCorners) chunk.corners[corner] += static_cast<long long>(vertexBase[c]);
+            glm::uvec3* out = indices.data() + firstTriangle + triangleBase[c];
+            for (size_t t = 0; t * 3 < chunk.corners.size(); ++t) {
+                for (int k = 0; k < 3; ++k) {
+                    long long corner = chunk.corners[t * 3 + k];
+                    if (corner < 0 || corner >= fileVertexCount) {
+                        indexOutOfRange.store(true, std::memory_order_relaxed);
+                        corner = 0;
+                    }
+                    out[t][k] = static_cast<unsigned int>(firstVertex + static_cast<size_t>(corner));
+                }
+            }
+        }
+    });
+    if (indexOutOfRange.load()) {
+        Logger::error("OBJ file references vertices that do not exist: " + filename);
+        vertices.resize(firstVertex);
+        indices.resize(firstTriangle);
+        materials.resize(firstTriangle);
+        return false;
     }
-    Logger::debug("Loaded " + std::to_string(triangles.size()) + " triangles.");
+    Logger::debug("Loaded " + std::to_string(indices.size()) + " triangles, " + std::to_string(vertices.size()) + " vertices.");
     return true;
 }
@@ -0,0 +1,180 @@
+#include "Profiler.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p) {
+    int rank = static_cast<int>(std::ceil(p * sorted.size())) - 1;
+    return sorted[std::clamp(rank, 0, static_cast<int>(sorted.size()) - 1)];
+}
+}
+
+Profiler& Profiler::shared() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::enableTrace(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tracePath = path;
+    threadIndex();
+}
+
+int Profiler::threadIndex() {
+    auto it = threads.find(std::this_thread::get_id());
+    if (it != threads.end()) return it->second;
+    int index = static_cast<int>(threads.size()) + 1;
+    threads.emplace(std::this_thread::get_id(), index);
+    return index;
+}
+
+void Profiler::record(const std::string& name, Clock::time_point begin, Clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    addSample(name, std::chrono::duration<double, std::milli>(end - begin).count(), begin, tracing() ? threadIndex() : 0);
+}
+
+void Profiler::addSample(const std::string& name, double ms, Clock::time_point begin, int thread) {
+    Series& s = series[name];
+    if (s.samples.size() < static_cast<size_t>(kWindow)) s.samples.push_back(ms);
+    else s.samples[s.next] = ms;
+    s.next = (s.next + 1) % kWindow;
+    ++s.total;
+    if (!tracing()) return;
+    if (traceEvents.size() >= kMaxTraceEvents) {
+        ++droppedTraceEvents;
+        return;
+    }
+    traceEvents.push_back({name, std::chrono::duration<double, std::micro>(begin - epoch).count(), ms * 1000.0, thread});
+}
+
+void Profiler::beginGPU(const std::string& name) {
+    if (gpuDepth++ > 0) return;
+    if (gpuSupported < 0) {
+        gpuSupported = (GLEW_VERSION_3_3 || GLEW_ARB_timer_query) ? 1 : 0;
+        if (!gpuSupported) Logger::info("Profiler: GL_TIME_ELAPSED queries unavailable, GPU passes are not timed");
+    }
+    activeGPUQuery = false;
+    if (!gpuSupported) return;
+    GPUPass& pass = gpuPasses[name];
+    if (pass.queries[0] == 0) glGenQueries(kGPUQueries, pass.queries);
+    if (pass.pending == kGPUQueries) collectPass(name, pass);
+    if (pass.pending == kGPUQueries) return;
+    pass.submitted[pass.next] = Clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, pass.queries[pass.next]);
+    activeGPUPass = &pass;
+    activeGPUQuery = true;
+}
+
+void Profiler::endGPU() {
+    if (gpuDepth == 0 || --gpuDepth > 0 || !activeGPUQuery) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    activeGPUPass->next = (activeGPUPass->next + 1) % kGPUQueries;
+    ++activeGPUPass->pending;
+    activeGPUPass = nullptr;
+    activeGPUQuery = false;
+}
+
+void Profiler::collectPass(const std::string& name, GPUPass& pass) {
+    while (pass.pending > 0) {
+        int slot = (pass.next - pass.pending + kGPUQueries) % kGPUQueries;
+        GLuint available = 0;
+        glGetQueryObjectuiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsedNs);
+        --pass.pending;
+        // The pass ran between its submission and now; anything longer is a bogus result (llvmpipe
+        // reports one for the first query of a context) and is dropped
+        double ms = static_cast<double>(elapsedNs) / 1.0e6;
+        if (ms > std::chrono::duration<double, std::milli>(Clock::now() - pass.submitted[slot]).count()) continue;
+        std::lock_guard<std::mutex> lock(mutex);
+        addSample(name, ms, pass.submitted[slot], 0);
+    }
+}
+
+void Profiler::collectGPU() {
+    for (auto& entry : gpuPasses) collectPass(entry.first, entry.second);
+}
+
+void Profiler::releaseGPU() {
+    for (auto& entry : gpuPasses) {
+        if (entry.second.queries[0] != 0) glDeleteQueries(kGPUQueries, entry.second.queries);
+    }
+    gpuPasses.clear();
+    activeGPUPass = nullptr;
+    activeGPUQuery = false;
+    gpuDepth = 0;
+}
+
+Profiler::Stats Profiler::stats(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats result;
+    auto it = series.find(name);
+    if (it == series.end() || it->second.samples.empty()) return result;
+    std::vector<double> sorted = it->second.samples;
+    std::sort(sorted.begin(), sorted.end());
+    result.count = static_cast<int>(sorted.size());
+    result.total = it->second.total;
+    result.p50 = percentile(sorted, 0.50);
+    result.p95 = percentile(sorted, 0.95);
+    result.p99 = percentile(sorted, 0.99);
+    result.max = sorted.back();
+    return result;
+}
+
+void Profiler::logSummary(const std::string& title) const {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& entry : series) names.push_back(entry.first);
+    }
+    if (names.empty()) return;
+    Logger::info("Profile [" + title + "], ms over the last " + std::to_string(kWindow) + " samples per scope:");
+    for (const std::string& name : names) {
+        Stats s = stats(name);
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(3) << "  " << name << ": n=" << s.total << " p50=" << s.p50 << " p95=" << s.p95
+             << " p99=" << s.p99 << " max=" << s.max;
+        Logger::info(line.str());
+    }
+}
+
+bool Profiler::writeTrace() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tracePath.empty()) return false;
+    std::ofstream json(tracePath, std::ios::trunc);
+    json << std::fixed << std::setprecision(3);
+    json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    json << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}";
+    for (const auto& entry : threads) {
+        std::string threadName = entry.second == 1 ? "main" : "thread " + std::to_string(entry.second);
+        json << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << entry.second
+             << ", \"args\": {\"name\": " << jsonString(threadName) << "}}";
+    }
+    for (const TraceEvent& e : traceEvents) {
+        json << ",\n  {\"name\": " << jsonString(e.name) << ", \"cat\": " << (e.thread == 0 ? "\"gpu\"" : "\"cpu\"")
+             << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread << ", \"ts\": " << e.startUs << ", \"dur\": " << e.durationUs << "}";
+    }
+    json << "\n]}\n";
+    if (!json.good()) {
+        Logger::error("Profiler: failed to write trace " + tracePath);
+        return false;
+    }
+    Logger::info("Profiler: " + std::to_string(traceEvents.size()) + " trace events written to " + tracePath +
+                 (droppedTraceEvents ? " (" + std::to_string(droppedTraceEvents) + " dropped past the limit)" : ""));
+    return true;
+}
+
+std::string jsonString(const std::string& value) {
+    std::string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out + "\"";
+}
@@ -0,0 +1,295 @@
+#include "RayKernels.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+const float kParallelEpsilon = 0.0001f; // |det| below this counts as parallel, as in hitTriangle
+const float kMinHitT = 0.0001f;
+
+// Shared by traverseRay and the packet traversals: blocks of one leaf node
+inline const TriangleBlock* leafBlocks(const BVHLeafBlocks& leaves, int nodeOffset, int node) {
+    return leaves.blocks.data() + leaves.nodeFirstBlock[nodeOffset + node];
+}
+
+inline int blockCount(const BVHNode& leaf) {
+    return (leaf.count + 3) / 4;
+}
+
+template <int N>
+uint32_t intersectPacketAABBScalar(const RayPacket<N>& p, const BVHNode& node) {
+    uint32_t mask = 0;
+    for (int i = 0; i < N; ++i) {
+        glm::vec3 origin(p.ox[i], p.oy[i], p.oz[i]);
+        glm::vec3 invDir(p.invDx[i], p.invDy[i], p.invDz[i]);
+        float tEnter;
+        if (RayKernels::intersectAABB(origin, invDir, node, p.tMax[i], tEnter)) mask |= 1u << i;
+    }
+    return mask;
+}
+
+#if defined(__SSE2__)
+// Slab test for four consecutive rays of a packet
+inline uint32_t intersectAABB4(const float* ox, const float* oy, const float* oz, const float* ix, const float* iy, const float* iz,
+                               const float* tMax, const BVHNode& node) {
+    __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.x), _mm_loadu_ps(ox)), _mm_loadu_ps(ix));
+    __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.y), _mm_loadu_ps(oy)), _mm_loadu_ps(iy));
+    __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMin.z), _mm_loadu_ps(oz)), _mm_loadu_ps(iz));
+    __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.x), _mm_loadu_ps(ox)), _mm_loadu_ps(ix));
+    __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.y), _mm_loadu_ps(oy)), _mm_loadu_ps(iy));
+    __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.boundsMax.z), _mm_loadu_ps(oz)), _mm_loadu_ps(iz));
+    // Operand order follows glm::min/max and std::min/max, so NaN lanes (0 * inf) resolve like the scalar test
+    __m128 tmin = _mm_max_ps(_mm_min_ps(t1z, t0z), _mm_max_ps(_mm_min_ps(t1y, t0y), _mm_min_ps(t1x, t0x)));
+    __m128 tmax = _mm_min_ps(_mm_max_ps(t1z, t0z), _mm_min_ps(_mm_max_ps(t1y, t0y), _mm_max_ps(t1x, t0x)));
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(tmax, _mm_max_ps(_mm_setzero_ps(), tmin)), _mm_cmpngt_ps(tmin, _mm_loadu_ps(tMax)));
+    return static_cast<uint32_t>(_mm_movemask_ps(hit));
+}
+#endif
+
+#if defined(__SSE2__)
+// Möller–Trumbore on all four lanes; returns the mask of lanes hit with kMinHitT < t < tMax
+inline int hitMask4(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax, __m128& t) {
+    __m128 dx = _mm_set1_ps(dir.x), dy = _mm_set1_ps(dir.y), dz = _mm_set1_ps(dir.z);
+    __m128 e1x = _mm_load_ps(block.e1[0]), e1y = _mm_load_ps(block.e1[1]), e1z = _mm_load_ps(block.e1[2]);
+    __m128 e2x = _mm_load_ps(block.e2[0]), e2y = _mm_load_ps(block.e2[1]), e2z = _mm_load_ps(block.e2[2]);
+    // h = cross(dir, edge2), a = dot(edge1, h)
+    __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+    __m128 absA = _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+    __m128 valid = _mm_cmpnlt_ps(absA, _mm_set1_ps(kParallelEpsilon));
+    if (!_mm_movemask_ps(valid)) return 0;
+    __m128 f = _mm_div_ps(_mm_set1_ps(1.0f), a);
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_load_ps(block.v0[0]));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_load_ps(block.v0[1]));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_load_ps(block.v0[2]));
+    __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+    // The scalar kernel only rejects u < 0 or u > 1, so NaN passes there too; cmpnlt/cmpngt keep that
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpnlt_ps(u, _mm_setzero_ps()), _mm_cmpngt_ps(u, _mm_set1_ps(1.0f))));
+    // q = cross(s, edge1)
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpnlt_ps(v, _mm_setzero_ps()), _mm_cmpngt_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f))));
+    t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+    valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpgt_ps(t, _mm_set1_ps(kMinHitT)), _mm_cmplt_ps(t, _mm_set1_ps(tMax))));
+    return _mm_movemask_ps(valid);
+}
+#endif
+
+// One lane of the block, in the operation order of the shader's hitTriangle; t is unchecked
+inline bool hitLane(const TriangleBlock& block, int lane, const glm::vec3& origin, const glm::vec3& dir, float& t) {
+    glm::vec3 v0(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+    glm::vec3 edge1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+    glm::vec3 edge2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+    glm::vec3 h = glm::cross(dir, edge2);
+    float a = glm::dot(edge1, h);
+    if (std::abs(a) < kParallelEpsilon) return false;
+    float f = 1.0f / a;
+    glm::vec3 s = origin - v0;
+    float u = f * glm::dot(s, h);
+    if (u < 0.0f || u > 1.0f) return false;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = f * glm::dot(dir, q);
+    if (v < 0.0f || u + v > 1.0f) return false;
+    t = f * glm::dot(edge2, q);
+    return true;
+}
+
+// Runs the leaf blocks for every ray of the packet in mask
+template <int N>
+void intersectPacketLeaf(const BVHNode& leaf, const TriangleBlock* blocks, uint32_t mask, RayPacket<N>& p) {
+    for (int i = 0; i < N; ++i) {
+        if (!(mask & (1u << i))) continue;
+        glm::vec3 origin(p.ox[i], p.oy[i], p.oz[i]);
+        glm::vec3 dir(p.dx[i], p.dy[i], p.dz[i]);
+        for (int b = 0; b < blockCount(leaf); ++b) {
+            float t;
+            int lane = RayKernels::intersectTriangleBlock(blocks[b], origin, dir, p.tMax[i], t);
+            if (lane >= 0) {
+                p.tMax[i] = t;
+                p.hitTri[i] = blocks[b].tri[lane];
+            }
+        }
+    }
+}
+
+template <int N>
+void traversePacketImpl(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, RayPacket<N>& p) {
+    thread_local std::vector<int> stack; // grows to the tree depth, reused across queries
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int nidx = stack.back();
+        stack.pop_back();
+        const BVHNode& node = nodes[nidx];
+        uint32_t mask = RayKernels::intersectPacketAABB(p, node);
+        if (!mask) continue;
+        if (node.count > 0) {
+            intersectPacketLeaf(node, leafBlocks(leaves, nodeOffset, nidx), mask, p);
+        } else {
+            stack.push_back(node.leftFirst);
+            stack.push_back(node.leftFirst + 1);
+        }
+    }
+}
+}
+
+void BVHLeafBlocks::append(const BVH& bvh, const Mesh& mesh) {
+    nodeFirstBlock.reserve(nodeFirstBlock.size() + bvh.nodes.size());
+    for (const BVHNode& node : bvh.nodes) {
+        nodeFirstBlock.push_back(static_cast<int>(blocks.size()));
+        if (node.count <= 0) continue;
+        for (int first = 0; first < node.count; first += 4) {
+            TriangleBlock block{};
+            for (int lane = 0; lane < 4; ++lane) {
+                block.tri[lane] = -1;
+                if (first + lane >= node.count) continue;
+                int tri = bvh.triIndices[node.leftFirst + first + lane];
+                glm::vec3 v0 = mesh.corner(tri, 0);
+                glm::vec3 e1 = mesh.corner(tri, 1) - v0;
+                glm::vec3 e2 = mesh.corner(tri, 2) - v0;
+                for (int a = 0; a < 3; ++a) {
+                    block.v0[a][lane] = v0[a];
+                    block.e1[a][lane] = e1[a];
+                    block.e2[a][lane] = e2[a];
+                }
+                block.tri[lane] = tri;
+            }
+            blocks.push_back(block);
+        }
+    }
+}
+
+namespace RayKernels {
+const char* simdLevel() {
+#if defined(__AVX2__)
+    return "AVX2";
+#elif defined(__SSE2__)
+    return "SSE";
+#else
+    return "scalar";
+#endif
+}
+
+// Lane by lane with the same operation order as the shader's hitTriangle, so both versions agree bit for bit
+int intersectTriangleBlockScalar(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax, float& tHit) {
+    int best = -1;
+    for (int lane = 0; lane < 4; ++lane) {
+        float t;
+        if (hitLane(block, lane, origin, dir, t) && t > kMinHitT && t < tMax) {
+            tMax = t;
+            tHit = t;
+            best = lane;
+        }
+    }
+    return best;
+}
+
+int intersectTriangleBlock(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax, float& tHit) {
+#if defined(__SSE2__)
+    __m128 t;
+    int mask = hitMask4(block, origin, dir, tMax, t);
+    if (!mask) return -1;
+    alignas(16) float ts[4];
+    _mm_store_ps(ts, t);
+    // Lowest lane wins ties, like testing the triangles in order with a strict comparison
+    int best = -1;
+    for (int lane = 0; lane < 4; ++lane) {
+        if ((mask & (1 << lane)) && (best < 0 || ts[lane] < ts[best])) best = lane;
+    }
+    tHit = ts[best];
+    return best;
+#else
+    return intersectTriangleBlockScalar(block, origin, dir, tMax, tHit);
+#endif
+}
+
+uint32_t intersectTriangleBlockAny(const TriangleBlock& block, const glm::vec3& origin, const glm::vec3& dir, float tMax) {
+#if defined(__SSE2__)
+    __m128 t;
+    return static_cast<uint32_t>(hitMask4(block, origin, dir, tMax, t));
+#else
+    uint32_t mask = 0;
+    for (int lane = 0; lane < 4; ++lane) {
+        float t;
+        if (hitLane(block, lane, origin, dir, t) && t > kMinHitT && t < tMax) mask |= 1u << lane;
+    }
+    return mask;
+#endif
+}
+
+uint32_t intersectPacketAABB(const RayPacket<4>& p, const BVHNode& node) {
+#if defined(__SSE2__)
+    return intersectAABB4(p.ox, p.oy, p.oz, p.invDx, p.invDy, p.invDz, p.tMax, node);
+#else
+    return intersectPacketAABBScalar(p, node);
+#endif
+}
+
+uint32_t intersectPacketAABB(const RayPacket<8>& p, const BVHNode& node) {
+#if defined(__AVX2__)
+    __m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMin.x), _mm256_loadu_ps(p.ox)), _mm256_loadu_ps(p.invDx));
+    __m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMin.y), _mm256_loadu_ps(p.oy)), _mm256_loadu_ps(p.invDy));
+    __m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMin.z), _mm256_loadu_ps(p.oz)), _mm256_loadu_ps(p.invDz));
+    __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMax.x), _mm256_loadu_ps(p.ox)), _mm256_loadu_ps(p.invDx));
+    __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMax.y), _mm256_loadu_ps(p.oy)), _mm256_loadu_ps(p.invDy));
+    __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.boundsMax.z), _mm256_loadu_ps(p.oz)), _mm256_loadu_ps(p.invDz));
+    __m256 tmin = _mm256_max_ps(_mm256_min_ps(t1z, t0z), _mm256_max_ps(_mm256_min_ps(t1y, t0y), _mm256_min_ps(t1x, t0x)));
+    __m256 tmax = _mm256_min_ps(_mm256_max_ps(t1z, t0z), _mm256_min_ps(_mm256_max_ps(t1y, t0y), _mm256_max_ps(t1x, t0x)));
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tmax, _mm256_max_ps(_mm256_setzero_ps(), tmin), _CMP_GE_OQ),
+                               _mm256_cmp_ps(tmin, _mm256_loadu_ps(p.tMax), _CMP_NGT_UQ));
+    return static_cast<uint32_t>(_mm256_movemask_ps(hit));
+#elif defined(__SSE2__)
+    // Two SSE halves
+    return intersectAABB4(p.ox, p.oy, p.oz, p.invDx, p.invDy, p.invDz, p.tMax, node) |
+           intersectAABB4(p.ox + 4, p.oy + 4, p.oz + 4, p.invDx + 4, p.invDy + 4, p.invDz + 4, p.tMax + 4, node) << 4;
+#else
+    return intersectPacketAABBScalar(p, node);
+#endif
+}
+
+int traverseRay(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, const glm::vec3& origin, const glm::vec3& dir, float& tHit, bool simdLeaves) {
+    int hitTri = -1;
+    tHit = 1e30f;
+    thread_local std::vector<int> stack; // grows to the tree depth, reused across queries
+    stack.clear();
+    stack.push_back(0);
+    glm::vec3 invDir = 1.0f / dir;
+    while (!stack.empty()) {
+        int nidx = stack.back();
+        stack.pop_back();
+        const BVHNode& node = nodes[nidx];
+        float tEnter;
+        if (!intersectAABB(origin, invDir, node, tHit, tEnter)) continue;
+        if (node.count > 0) {
+            const TriangleBlock* blocks = leafBlocks(leaves, nodeOffset, nidx);
+            for (int b = 0; b < blockCount(node); ++b) {
+                float t;
+                int lane = simdLeaves ? intersectTriangleBlock(blocks[b], origin, dir, tHit, t)
+                                      : intersectTriangleBlockScalar(blocks[b], origin, dir, tHit, t);
+                if (lane >= 0) {
+                    tHit = t;
+                    hitTri = blocks[b].tri[lane];
+                }
+            }
+        } else {
+            stack.push_back(node.leftFirst);
+            stack.push_back(node.leftFirst + 1);
+        }
+    }
+    return hitTri;
+}
+
+void traversePacket(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, RayPacket<4>& packet) {
+    traversePacketImpl(nodes, leaves, nodeOffset, packet);
+}
+
+void traversePacket(const BVHNode* nodes, const BVHLeafBlocks& leaves, int nodeOffset, RayPacket<8>& packet) {
+    traversePacketImpl(nodes, leaves, nodeOffset, packet);
+}
+}
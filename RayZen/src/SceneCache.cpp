@@ -0,0 +1,168 @@
+#include "SceneCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char kMagic[8] = {'R', 'Z', 'S', 'C', 'E', 'N', 'E', '\0'};
+// Sections start on cache-line boundaries so mapped pointers are suitably aligned for every element type
+const uint64_t kSectionAlignment = 64;
+
+struct SceneCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t key;
+    uint64_t transformHash;
+    uint64_t fileBytes;
+    struct {
+        uint64_t offset;
+        uint64_t bytes;
+    } sections[SceneCache::SectionCount];
+};
+
+uint64_t alignUp(uint64_t value) {
+    return (value + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+}
+}
+
+SceneCache::~SceneCache() {
+    close();
+}
+
+bool SceneCache::open(const std::string& path, uint64_t key) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SceneCacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (mapped == MAP_FAILED) return false;
+
+    const SceneCacheHeader* header = static_cast<const SceneCacheHeader*>(mapped);
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0 &&
+                 header->version == kVersion &&
+                 header->headerBytes == sizeof(SceneCacheHeader) &&
+                 header->key == key &&
+                 header->fileBytes == size;
+    for (int s = 0; valid && s < SectionCount; ++s) {
+        uint64_t offset = header->sections[s].offset;
+        uint64_t bytes = header->sections[s].bytes;
+        valid = offset % kSectionAlignment == 0 && offset >= sizeof(SceneCacheHeader) && offset <= size && bytes <= size - offset;
+    }
+    if (!valid) {
+        munmap(mapped, size);
+        return false;
+    }
+    // Uploads read every section front to back right after opening
+    madvise(mapped, size, MADV_WILLNEED);
+    mapping = mapped;
+    mappingSize = size;
+    return true;
+}
+
+void SceneCache::close() {
+    if (mapping) munmap(mapping, mappingSize);
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+uint64_t SceneCache::transformHash() const {
+    return mapping ? static_cast<const SceneCacheHeader*>(mapping)->transformHash : 0;
+}
+
+SceneCache::SectionData SceneCache::section(Section s) const {
+    SectionData d;
+    if (!mapping) return d;
+    const SceneCacheHeader* header = static_cast<const SceneCacheHeader*>(mapping);
+    d.data = static_cast<const char*>(mapping) + header->sections[s].offset;
+    d.bytes = header->sections[s].bytes;
+    return d;
+}
+
+bool SceneCache::write(const std::string& path, uint64_t key, uint64_t transformHash, const SectionData (&sections)[SectionCount]) {
+    SceneCacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.headerBytes = sizeof(SceneCacheHeader);
+    header.key = key;
+    header.transformHash = transformHash;
+    uint64_t offset = alignUp(sizeof(SceneCacheHeader));
+    for (int s = 0; s < SectionCount; ++s) {
+        header.sections[s].offset = offset;
+        header.sections[s].bytes = sections[s].bytes;
+        offset = alignUp(offset + sections[s].bytes);
+    }
+    header.fileBytes = offset;
+
+    std::string tmpPath = path + ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!ofs) return false;
+        const char zeros[kSectionAlignment] = {};
+        uint64_t written = 0;
+        auto pad = [&](uint64_t target) {
+            ofs.write(zeros, static_cast<std::streamsize>(target - written));
+            written = target;
+        };
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        written = sizeof(header);
+        for (int s = 0; s < SectionCount; ++s) {
+            pad(header.sections[s].offset);
+            ofs.write(static_cast<const char*>(sections[s].data), static_cast<std::streamsize>(sections[s].bytes));
+            written += sections[s].bytes;
+        }
+        pad(header.fileBytes);
+        if (!ofs.good()) {
+            ofs.close();
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+// MurmurHash64A over 8-byte words
+uint64_t SceneCache::hashBytes(const void* data, size_t bytes, uint64_t seed) {
+    const uint64_t m = 0xC6A4A7935BD1E995ull;
+    const int r = 47;
+    uint64_t h = seed ^ (bytes * m);
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + (bytes & ~size_t(7));
+    for (; p != end; p += 8) {
+        uint64_t k;
+        std::memcpy(&k, p, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    size_t tail = bytes & 7;
+    if (tail) {
+        uint64_t k = 0;
+        std::memcpy(&k, p, tail);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
@@ -0,0 +1,124 @@
+#include "SceneRayQuery.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+const int kBatchGrain = 256; // rays per parallel chunk
+}
+
+SceneRayQuery::SceneRayQuery(const BVH& tlas, const std::vector<BVHInstance>& instances,
+                             std::vector<const BVH*> blas, std::vector<const BVHLeafBlocks*> leaves)
+    : tlas(tlas), instances(instances), blas(std::move(blas)), leaves(std::move(leaves)) {}
+
+bool SceneRayQuery::traverseBLAS(const BVH& bvh, const BVHLeafBlocks& leaves, const glm::vec3& origin, const glm::vec3& dir,
+                                 bool anyHit, float& tHit, int& triangle) const {
+    if (bvh.nodes.empty()) return false;
+    bool found = false;
+    thread_local std::vector<int> stack; // grows to the tree depth, reused across queries
+    stack.clear();
+    stack.push_back(0);
+    glm::vec3 invDir = 1.0f / dir;
+    while (!stack.empty()) {
+        int nidx = stack.back();
+        stack.pop_back();
+        const BVHNode& node = bvh.nodes[nidx];
+        float tEnter;
+        if (!RayKernels::intersectAABB(origin, invDir, node, tHit, tEnter)) continue;
+        if (node.count > 0) {
+            const TriangleBlock* blocks = &leaves.blocks[leaves.nodeFirstBlock[nidx]];
+            for (int b = 0; b * 4 < node.count; ++b) {
+                if (anyHit) {
+                    uint32_t lanes = RayKernels::intersectTriangleBlockAny(blocks[b], origin, dir, tHit);
+                    if (!lanes) continue;
+                    int lane = 0;
+                    while (!(lanes & (1u << lane))) ++lane;
+                    triangle = blocks[b].tri[lane];
+                    return true;
+                }
+                float t;
+                int lane = RayKernels::intersectTriangleBlock(blocks[b], origin, dir, tHit, t);
+                if (lane < 0) continue;
+                tHit = t;
+                triangle = blocks[b].tri[lane];
+                found = true;
+            }
+        } else {
+            // Only children the ray enters are pushed, the nearer one last so closer hits shrink tHit sooner
+            int left = node.leftFirst, right = node.leftFirst + 1;
+            float tLeft, tRight;
+            bool hitLeft = RayKernels::intersectAABB(origin, invDir, bvh.nodes[left], tHit, tLeft);
+            bool hitRight = RayKernels::intersectAABB(origin, invDir, bvh.nodes[right], tHit, tRight);
+            if (hitLeft && hitRight) {
+                stack.push_back(tLeft <= tRight ? right : left);
+                stack.push_back(tLeft <= tRight ? left : right);
+            } else if (hitLeft) {
+                stack.push_back(left);
+            } else if (hitRight) {
+                stack.push_back(right);
+            }
+        }
+    }
+    return found;
+}
+
+bool SceneRayQuery::traverse(const QueryRay& ray, bool anyHit, RayQueryHit& hit) const {
+    hit = RayQueryHit();
+    hit.t = ray.tMax;
+    if (tlas.nodes.empty()) return false;
+    bool found = false;
+    thread_local std::vector<int> stack; // grows to the tree depth, reused across queries
+    stack.clear();
+    stack.push_back(0);
+    glm::vec3 invDir = 1.0f / ray.direction;
+    while (!stack.empty()) {
+        const BVHNode& node = tlas.nodes[stack.back()];
+        stack.pop_back();
+        float tEnter;
+        if (!RayKernels::intersectAABB(ray.origin, invDir, node, hit.t, tEnter)) continue;
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; ++i) {
+                int instIdx = tlas.triIndices[node.leftFirst + i];
+                const BVHInstance& inst = instances[instIdx];
+                const BVH* instBLAS = blas[inst.meshIndex];
+                const BVHLeafBlocks* instLeaves = leaves[inst.meshIndex];
+                if (!instBLAS || !instLeaves) continue;
+                glm::vec3 localOrigin(inst.inverseTransform * glm::vec4(ray.origin, 1.0f));
+                glm::vec3 localDir(inst.inverseTransform * glm::vec4(ray.direction, 0.0f));
+                if (!traverseBLAS(*instBLAS, *instLeaves, localOrigin, localDir, anyHit, hit.t, hit.triangle)) continue;
+                hit.instance = instIdx;
+                found = true;
+                if (anyHit) return true;
+            }
+        } else {
+            stack.push_back(node.leftFirst);
+            stack.push_back(node.leftFirst + 1);
+        }
+    }
+    return found;
+}
+
+bool SceneRayQuery::closestHit(const QueryRay& ray, RayQueryHit& hit) const {
+    return traverse(ray, false, hit);
+}
+
+bool SceneRayQuery::anyHit(const QueryRay& ray) const {
+    RayQueryHit hit;
+    return traverse(ray, true, hit);
+}
+
+void SceneRayQuery::closestHits(const std::vector<QueryRay>& rays, std::vector<RayQueryHit>& hits) const {
+    hits.assign(rays.size(), RayQueryHit());
+    ThreadPool::shared().parallelFor(0, static_cast<int>(rays.size()), kBatchGrain, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) traverse(rays[i], false, hits[i]);
+    });
+}
+
+void SceneRayQuery::anyHits(const std::vector<QueryRay>& rays, std::vector<char>& occluded) const {
+    occluded.assign(rays.size(), 0);
+    ThreadPool::shared().parallelFor(0, static_cast<int>(rays.size()), kBatchGrain, [&](int begin, int end, int) {
+        RayQueryHit hit;
+        for (int i = begin; i < end; ++i) occluded[i] = traverse(rays[i], true, hit) ? 1 : 0;
+    });
+}
@@ -0,0 +1,89 @@
+#include "SobolSampler.h"
+
+namespace {
+// Joe and Kuo's primitive polynomials and initial direction numbers for Sobol dimensions 1..3;
+// dimension 0 is the van der Corput sequence
+struct SobolPolynomial {
+    int degree;
+    uint32_t coefficients; // inner coefficients, highest first
+    uint32_t initial[3];
+};
+const SobolPolynomial kPolynomials[SobolSampler::kDimensions - 1] = {
+    {1, 0, {1, 0, 0}},
+    {2, 1, {1, 3, 0}},
+    {3, 1, {1, 3, 1}},
+};
+
+std::vector<uint32_t> buildMatrices() {
+    std::vector<uint32_t> columns(SobolSampler::kDimensions * 32);
+    for (int bit = 0; bit < 32; ++bit) columns[bit] = 1u << (31 - bit);
+    for (int d = 1; d < SobolSampler::kDimensions; ++d) {
+        const SobolPolynomial& poly = kPolynomials[d - 1];
+        uint32_t* v = &columns[d * 32];
+        for (int bit = 0; bit < 32; ++bit) {
+            if (bit < poly.degree) {
+                v[bit] = poly.initial[bit] << (31 - bit);
+                continue;
+            }
+            v[bit] = v[bit - poly.degree] ^ (v[bit - poly.degree] >> poly.degree);
+            for (int k = 1; k < poly.degree; ++k) {
+                if ((poly.coefficients >> (poly.degree - 1 - k)) & 1u) v[bit] ^= v[bit - k];
+            }
+        }
+    }
+    return columns;
+}
+
+uint32_t hashUint(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t reverseBits(uint32_t x) {
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+// Owen scramble: the Laine-Karras permutation applied to the bit-reversed value
+uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+}
+
+namespace SobolSampler {
+const std::vector<uint32_t>& matrices() {
+    static const std::vector<uint32_t> columns = buildMatrices();
+    return columns;
+}
+
+uint32_t pixelSeed(uint32_t x, uint32_t y) {
+    return hashUint(x ^ hashUint(y));
+}
+
+float sample(uint32_t pixel, uint32_t index, int dimension) {
+    const uint32_t* columns = matrices().data();
+    uint32_t setSeed = hashUint(pixel ^ hashUint(static_cast<uint32_t>(dimension / kDimensions)));
+    int d = dimension % kDimensions;
+    uint32_t x = 0;
+    int bit = 0;
+    for (uint32_t i = nestedUniformScramble(index, setSeed); i != 0; i >>= 1, ++bit) {
+        if (i & 1u) x ^= columns[d * 32 + bit];
+    }
+    x = nestedUniformScramble(x, hashUint(setSeed + static_cast<uint32_t>(d)));
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+}
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+// Identifies the pool and worker running on this thread; -1 for non-worker threads
+thread_local const ThreadPool* tlsPool = nullptr;
+thread_local int tlsWorkerIndex = -1;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i <= threadCount; ++i) queues.push_back(std::make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back(&ThreadPool::workerLoop, this, (int)i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+        stopping.store(true);
+    }
+    sleepCv.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::run(TaskGroup& group, std::function<void()> task) {
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+    int target = (tlsPool == this && tlsWorkerIndex >= 0) ? tlsWorkerIndex : (int)workers.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mtx);
+        queues[target]->tasks.push_back({std::move(task), &group});
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleepMtx);
+    }
+    sleepCv.notify_one();
+}
+
+bool ThreadPool::tryRunOne(int self) {
+    Task task;
+    bool found = false;
+    int queueCount = (int)queues.size();
+    // Non-worker threads own the injection queue. Popping the own deque LIFO keeps nested
+    // waits depth-first; other queues are stolen from the front, where the largest tasks sit.
+    int own = self >= 0 ? self : queueCount - 1;
+    {
+        std::lock_guard<std::mutex> lock(queues[own]->mtx);
+        if (!queues[own]->tasks.empty()) {
+            task = std::move(queues[own]->tasks.back());
+            queues[own]->tasks.pop_back();
+            found = true;
+        }
+    }
+    for (int k = 0; !found && k < queueCount; ++k) {
+        int victim = (queueCount - 1 + k) % queueCount;
+        if (victim == own) continue;
+        std::lock_guard<std::mutex> lock(queues[victim]->mtx);
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found) return false;
+    queued.fetch_sub(1, std::memory_order_acq_rel);
+    task.fn();
+    task.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void ThreadPool::workerLoop(int index) {
+    tlsPool = this;
+    tlsWorkerIndex = index;
+    while (true) {
+        if (tryRunOne(index)) continue;
+        std::unique_lock<std::mutex> lock(sleepMtx);
+        sleepCv.wait(lock, [&] { return stopping.load() || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping.load() && queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
+
+void ThreadPool::wait(TaskGroup& group) {
+    int self = (tlsPool == this) ? tlsWorkerIndex : -1;
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (!tryRunOne(self)) std::this_thread::yield();
+    }
+}
+
+int ThreadPool::chunkCount(int begin, int end, int grain) const {
+    int count = end - begin;
+    if (count <= 0) return 0;
+    int maxChunks = (int)size() * 4;
+    return std::max(1, std::min(maxChunks, count / std::max(1, grain)));
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain, const std::function<void(int, int, int)>& fn) {
+    int chunks = chunkCount(begin, end, grain);
+    if (chunks == 0) return;
+    if (chunks == 1) {
+        fn(begin, end, 0);
+        return;
+    }
+    int count = end - begin;
+    TaskGroup group;
+    for (int c = 1; c < chunks; ++c) {
+        int chunkBegin = begin + (int)((long long)count * c / chunks);
+        int chunkEnd = begin + (int)((long long)count * (c + 1) / chunks);
+        run(group, [&fn, chunkBegin, chunkEnd, c]() { fn(chunkBegin, chunkEnd, c); });
+    }
+    fn(begin, begin + (int)((long long)count / chunks), 0);
+    wait(group);
+}
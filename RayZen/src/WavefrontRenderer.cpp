@@ -0,0 +1,123 @@
+#include "WavefrontRenderer.h"
+#include "Logger.h"
+#include <string>
+
+namespace {
+// Threads per group of the queue-driven kernels, QUEUE_GROUP_SIZE in wavefront_common.glsl
+const GLuint kQueueGroupSize = 256;
+const GLuint kTileSize = 8; // generate and accumulate run on 8x8 pixel tiles
+
+// Layout of wavefront_common.glsl: std430 PathState size, then the queue buffer's three
+// dispatch headers followed by one pixel-sized entry range per queue
+const size_t kPathStateBytes = 144;
+const size_t kQueueHeaderBytes = 4 * sizeof(GLuint);
+const int kQueueCount = 3;
+const int kConnectQueue = 2;
+const GLuint kPathBinding = 14;
+const GLuint kQueueBinding = 15;
+
+// Writes an indirect dispatch header: groups x 1 x 1, then the entry count
+void setQueueHeader(GLuint buffer, int queue, GLuint entries) {
+    const GLuint header[4] = {(entries + kQueueGroupSize - 1) / kQueueGroupSize, 1, 1, entries};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, queue * kQueueHeaderBytes, sizeof(header), header);
+}
+
+GLuint queueEntries(GLuint buffer, int queue) {
+    GLuint header[4] = {0, 0, 0, 0};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, queue * kQueueHeaderBytes, sizeof(header), header);
+    return header[3];
+}
+}
+
+bool WavefrontPathTracer::create(const std::function<GLuint(const char*)>& loadKernel) {
+    destroy();
+    generateProgram = loadKernel("../shaders/wavefront_generate.comp");
+    extendProgram = loadKernel("../shaders/wavefront_extend.comp");
+    shadeProgram = loadKernel("../shaders/wavefront_shade.comp");
+    connectProgram = loadKernel("../shaders/wavefront_connect.comp");
+    accumulateProgram = loadKernel("../shaders/wavefront_accumulate.comp");
+    if (!generateProgram || !extendProgram || !shadeProgram || !connectProgram || !accumulateProgram) {
+        Logger::error("Wavefront: failed to build the compute kernels");
+        destroy();
+        return false;
+    }
+    const GLuint programs[5] = {generateProgram, extendProgram, shadeProgram, connectProgram, accumulateProgram};
+    for (int i = 0; i < 5; ++i) sampleIndexLocations[i] = glGetUniformLocation(programs[i], "sampleIndex");
+    for (int i = 0; i < 3; ++i) bounceLocations[i] = glGetUniformLocation(programs[i + 1], "bounce");
+    glGenBuffers(1, &pathBuffer);
+    glGenBuffers(1, &queueBuffer);
+    return true;
+}
+
+void WavefrontPathTracer::destroy() {
+    for (GLuint* program : {&generateProgram, &extendProgram, &shadeProgram, &connectProgram, &accumulateProgram}) {
+        if (*program) glDeleteProgram(*program);
+        *program = 0;
+    }
+    for (GLuint* buffer : {&pathBuffer, &queueBuffer}) {
+        if (*buffer) glDeleteBuffers(1, buffer);
+        *buffer = 0;
+    }
+    capacity = 0;
+}
+
+void WavefrontPathTracer::reserve(size_t pixels) {
+    if (pixels <= capacity) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, pathBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, pixels * kPathStateBytes, nullptr, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, queueBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, kQueueCount * (kQueueHeaderBytes + pixels * sizeof(GLuint)), nullptr, GL_DYNAMIC_COPY);
+    capacity = pixels;
+    Logger::debug("Wavefront: buffers resized for " + std::to_string(pixels) + " paths");
+}
+
+void WavefrontPathTracer::render(int width, int height, int maxBounces, int sampleIndex, GLuint accumulationTexture) {
+    if (!ready() || width <= 0 || height <= 0) return;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    reserve(pixels);
+    const GLuint programs[5] = {generateProgram, extendProgram, shadeProgram, connectProgram, accumulateProgram};
+    for (int i = 0; i < 5; ++i) glProgramUniform1i(programs[i], sampleIndexLocations[i], sampleIndex);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPathBinding, pathBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kQueueBinding, queueBuffer);
+
+    // Camera paths for every pixel fill in-queue 0 in pixel order
+    const GLuint tilesX = (static_cast<GLuint>(width) + kTileSize - 1) / kTileSize;
+    const GLuint tilesY = (static_cast<GLuint>(height) + kTileSize - 1) / kTileSize;
+    setQueueHeader(queueBuffer, 0, static_cast<GLuint>(pixels));
+    glUseProgram(generateProgram);
+    glDispatchCompute(tilesX, tilesY, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    const bool logQueues = Logger::getLevel() <= LogLevel::DEBUG;
+    std::string queueSizes = std::to_string(pixels);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, queueBuffer);
+    for (int bounce = 0; bounce < maxBounces; ++bounce) {
+        // The shaders derive the in/out queues from the bounce parity
+        int inQueue = bounce & 1, outQueue = inQueue ^ 1;
+        setQueueHeader(queueBuffer, outQueue, 0);
+        setQueueHeader(queueBuffer, kConnectQueue, 0);
+        for (int i = 0; i < 3; ++i) glProgramUniform1i(programs[i + 1], bounceLocations[i], bounce);
+
+        glUseProgram(extendProgram);
+        glDispatchComputeIndirect(inQueue * kQueueHeaderBytes);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        glUseProgram(shadeProgram);
+        glDispatchComputeIndirect(inQueue * kQueueHeaderBytes);
+        // The shade pass wrote the queue headers the next dispatches read
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+        glUseProgram(connectProgram);
+        glDispatchComputeIndirect(kConnectQueue * kQueueHeaderBytes);
+        // Headers the shaders appended to are next reset and read back through buffer calls
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        if (logQueues) queueSizes += " -> " + std::to_string(queueEntries(queueBuffer, outQueue));
+    }
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    glBindImageTexture(0, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glUseProgram(accumulateProgram);
+    glDispatchCompute(tilesX, tilesY, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    if (logQueues) Logger::debug("Wavefront live paths per bounce: " + queueSizes);
+}
@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <cstddef>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -19,6 +20,7 @@
 #include <system_error>
 #include <chrono>
 #include <memory>
+#include <random>
 
 #include "Ray.h"
 #include "Scene.h"
@@ -28,6 +30,18 @@
 #include "BVH.h"
 #include "Logger.h"
 #include "GameObject.h"
+#include "ThreadPool.h"
+#include "SceneCache.h"
+#include "CPURenderer.h"
+#include "LightTable.h"
+#include "HeadlessContext.h"
+#include "ImageIO.h"
+#include "RayKernels.h"
+#include "SceneRayQuery.h"
+#include "WavefrontRenderer.h"
+#include "FrameConstants.h"
+#include "Profiler.h"
+#include "SobolSampler.h"
 
 namespace fs = std::filesystem;
 
@@ -38,22 +52,44 @@ unsigned int SCR_HEIGHT = 600;
 // Function prototypes
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window, Camera& camera, float deltaTime);
-GLuint loadShaders(const char* vertexPath, const char* fragmentPath);
+GLuint loadShaders(const char* vertexPath, const char* fragmentPath, bool* fromCache = nullptr, const std::vector<std::string>& defines = {});
+GLuint loadComputeShader(const char* computePath, const std::vector<std::string>& defines = {});
+GLuint loadWavefrontKernel(const char* computePath);
+struct PathTracerVariant;
+PathTracerVariant pathTracerVariantFor(const Scene& scene, bool debugOverlays, bool fpsOverlay);
+std::vector<std::string> pathTracerDefines(const PathTracerVariant& variant);
+GLuint loadPathTracer(const PathTracerVariant& variant, bool* fromCache = nullptr);
+void adoptPathTracerProgram(const PathTracerVariant& variant, GLuint program);
+void selectPathTracerVariant(const PathTracerVariant& variant);
+bool launchPathTracerCompile(GLFWwindow* shareWindow, const PathTracerVariant& variant, const char* profileLabel);
 void sendSceneDataToShader(GLuint shaderProgram, const Scene& scene, int bounceBudget);
 void setupQuad(GLuint& quadVAO, GLuint& quadVBO);
-void initializeSSBOs(const Scene& scene, bool forceRebuildBVH = false);
+struct BLASInitStats;
+BLASInitStats initializeSSBOs(const Scene& scene, bool forceRebuildBVH = false);
 void updateDynamicBVHAndSSBOs(Scene& scene);
-void buildRasterMeshes(const Scene& scene);
+void buildRasterMeshes();
 void renderRasterized(const Scene& scene);
 void cleanupRasterMeshes();
 void sendRasterSceneData(GLuint shaderProgram, const Scene& scene);
 void runPathTracerWarmup(GLFWwindow* window, Scene& scene, int warmupFrames);
+void prepareAccumulation(GLuint shaderProgram, const Scene& scene, int bounceBudget);
+void finishAccumulation();
+void traceWavefrontSample(int bounceBudget);
+void sendDebugUniforms(GLuint shaderProgram);
+bool pickTriangle(const glm::vec3& origin, const glm::vec3& direction, int& instance, int& triangle);
+void finishProfiling();
+void logBLASBuilderComparison(const Scene& scene);
+void logTLASBuilderComparison(const Scene& scene);
+void logRayKernelBenchmark(const Scene& scene);
+int runCPUReferenceRender(const Scene& scene, const std::string& outputPath, const CPURenderSettings& settings);
+struct HeadlessSettings;
+int runHeadlessRender(Scene& scene, const HeadlessSettings& settings, bool forceRebuildBVH);
 
 // Global variables
 GLuint quadVAO, quadVBO;
 GLuint shaderProgram;
 GLuint rasterShaderProgram;
-GLuint triangleSSBO, materialSSBO, lightSSBO;
+GLuint triangleSSBO, vertexSSBO, triangleMaterialSSBO, materialSSBO, lightSSBO, lightTableSSBO, sobolSSBO;
 GLuint tlasNodeSSBO, tlasTriIdxSSBO, blasNodeSSBO, blasTriIdxSSBO, bvhInstanceSSBO;
 float lastFrame = 0.0f;
 float deltaTime = 0.0f;
@@ -63,81 +99,169 @@ int debugBVHMode = 0; // 0 = TLAS, 1 = BLAS
 int debugSelectedBLAS = 0;
 int debugSelectedTri = 0;
 bool editorMode = false;
+BVHSplitMethod gBLASSplitMethod = BVHSplitMethod::BinnedSAH; // the app default; BVH itself defaults to the sweep builder
+int gBLASBinCount = 16;
+bool gBLASParallelBuild = true;
+BVHSplitMethod gTLASSplitMethod = BVHSplitMethod::BinnedSAH;
+int gTLASMaxLeafSize = 4;
+float gTLASRebuildRatio = 1.3f; // rebuild the TLAS once refits raise its SAH cost by this factor
+int gBLASNodeWidth = 2;         // BLAS node format for the shader: binary, or BVH4/BVH8 collapsed
+bool gBLASNodeQuantized = false; // 8-bit child bounds for wide nodes
+int gLightSamples = 4;          // shadow rays per shading point once point lights outnumber it; 0 samples every light
+const int kMaxBounceBudget = 5; // largest bounce budget any path-traced frame asks for
+int gBLASStackEntries = 0;      // deepest BVH4/BVH8 traversal stack any uploaded BLAS needs
+int gWavefrontBLASStackSize = 0; // RZ_BLAS_STACK_SIZE the wavefront kernels were built with
 
 std::atomic<bool> gPathTracerReady{false};
 std::atomic<GLuint> gPathTracerProgramHandle{0};
 std::atomic<double> gPathTracerCompileMs{0.0};
+std::atomic<bool> gPathTracerFromCache{false}; // loaded from the program binary cache instead of compiled
 std::thread gPathTracerThread;
 GLFWwindow* gPathTracerCompileWindow = nullptr;
 
-struct RasterMeshGPU {
-    GLuint vao = 0;
-    GLuint vbo = 0;
-    GLsizei vertexCount = 0;
+// Raster path VAO: positions come from vertexSSBO and indices from triangleSSBO, shared with the path tracer
+static GLuint gRasterVAO = 0;
+
+// Per-mesh BLAS load-or-build phase of initializeSSBOs
+struct BLASInitStats {
+    int built = 0;
+    int loaded = 0;
+    double wallMs = 0.0; // elapsed time of the concurrent phase
+    double taskMs = 0.0; // sum of per-mesh load/build times
 };
 
-struct RasterVertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    int materialIndex;
+// CPU copy of what the BLAS, instance and TLAS SSBOs hold, so per-frame updates only touch what changed
+struct DynamicSceneState {
+    std::vector<const Mesh*> objectMeshes; // mesh of each game object when the buffers were laid out
+    std::vector<int> objectSlot;           // unique mesh slot of each game object
+    std::vector<const Mesh*> meshes;       // unique meshes in slot order
+    std::vector<BVH> meshBLAS;             // per slot, refit when its mesh deforms; empty while still only in the cache
+    std::vector<BVHLeafBlocks> meshLeafBlocks; // per slot, SoA leaves for CPU ray queries; built on first pick, dropped when the BLAS changes
+    std::vector<int> meshNodeOffset, meshTriOffset, meshGlobalTriOffset; // node offsets in GPU node units
+    std::vector<int> meshNodeCount;        // GPU nodes per slot
+    std::vector<int> meshVertexOffset, meshVertexCount; // vertex range of each slot in the vertex buffer
+    std::vector<BVHInstance> instances;
+    std::vector<BVHNode> localRoots;       // object-space BLAS root per instance
+    std::vector<BVHNode> worldRoots;       // localRoots under the instance transform
+    BVH tlas;
+    // Scene cache the buffers were uploaded from. Slots whose BLAS was never needed on the CPU
+    // still read their nodes from the mapping (see slotBLAS) instead of holding a copy.
+    std::unique_ptr<SceneCache> cache;
+    struct CachedRange { int nodeOffset, nodeCount, triOffset, triCount; };
+    std::vector<CachedRange> cachedBLAS;   // per slot, in binary nodes / tri indices of the cache sections
+    uint64_t version = 0;                  // bumped whenever uploaded geometry or transforms change
 };
 
-static std::unordered_map<const Mesh*, RasterMeshGPU> gRasterMeshCache;
+static DynamicSceneState gDynamicScene;
+
+// Progressive accumulation: running mean of the path tracer's samples in an RGBA32F image,
+// restarted whenever the view, the scene or the resolution changes
+struct AccumulationState {
+    bool enabled = true;
+    int targetSamples = 0; // stop tracing once the mean holds this many samples; 0 = never
+    GLuint texture = 0;
+    int width = 0, height = 0;
+    int samples = 0;
+    glm::mat4 viewProjection{0.0f}; // camera the mean belongs to
+    uint64_t sceneVersion = 0;
+    int bounceBudget = 0;
+    std::chrono::high_resolution_clock::time_point start;
+};
+static AccumulationState gAccumulation;
+bool gWavefront = false; // trace with the wavefront compute kernels; the fragment shader only presents
+static WavefrontPathTracer gWavefrontTracer;
+static FrameConstantRing gFrameConstants;
+
+// Locations of the path tracer fragment shader's uniforms outside FrameConstants, looked up once per program
+struct PathTracerUniforms {
+    GLuint program = 0;
+    GLint debugShowLights = -1, debugShowBVH = -1, debugBVHMode = -1, debugSelectedBLAS = -1, debugSelectedTri = -1;
+    GLint uniformFps = -1, hideOverlay = -1, accumulate = -1, sampleIndex = -1, displayAccumulated = -1;
+};
+static PathTracerUniforms gPathTracerUniforms;
+
+static const PathTracerUniforms& pathTracerUniforms(GLuint program) {
+    PathTracerUniforms& u = gPathTracerUniforms;
+    if (u.program != program) {
+        u.program = program;
+        u.debugShowLights = glGetUniformLocation(program, "debugShowLights");
+        u.debugShowBVH = glGetUniformLocation(program, "debugShowBVH");
+        u.debugBVHMode = glGetUniformLocation(program, "debugBVHMode");
+        u.debugSelectedBLAS = glGetUniformLocation(program, "debugSelectedBLAS");
+        u.debugSelectedTri = glGetUniformLocation(program, "debugSelectedTri");
+        u.uniformFps = glGetUniformLocation(program, "uniformFps");
+        u.hideOverlay = glGetUniformLocation(program, "hideOverlay");
+        u.accumulate = glGetUniformLocation(program, "accumulate");
+        u.sampleIndex = glGetUniformLocation(program, "sampleIndex");
+        u.displayAccumulated = glGetUniformLocation(program, "displayAccumulated");
+    }
+    return u;
+}
+static std::unordered_map<GLuint, size_t> gSSBOCapacity; // allocated bytes per dynamic SSBO
+
+// Offscreen benchmark run: the camera orbits the world y axis through the origin by orbitDegrees
+// over a fixed number of frames, rendered to an FBO through an EGL context
+struct HeadlessSettings {
+    int width = 800;
+    int height = 600;
+    int frames = 60;
+    float orbitDegrees = 0.0f;
+    std::string imagePath = "headless.png"; // last frame; .png, .pfm or .ppm
+    std::string timingsPath;                // per-frame timings as JSON, skipped when empty
+    std::string referencePath;              // PFM to measure the accumulated image's RMSE against
+};
 
 struct ShaderBinaryMetadata {
-    uint64_t vertexTimestamp = 0;
-    uint64_t fragmentTimestamp = 0;
+    static const uint32_t kVersion = 2;
+    uint32_t version = kVersion;
     uint32_t binaryFormat = 0;
-    uint32_t binaryLength = 0;
+    uint64_t sourceHash = 0; // expanded source of every stage plus the define set
+    uint64_t driverHash = 0; // GL vendor, renderer and version strings
+    uint64_t binaryHash = 0; // contents of the .bin file, so a truncated or damaged one is never handed to GL
+    uint64_t binaryLength = 0;
 };
 
-// Serialize a vector of POD types to a binary file
-template <typename T>
-bool saveVectorToFile(const std::string& filename, const std::vector<T>& vec) {
-    std::ofstream ofs(filename, std::ios::binary);
-    if (!ofs) return false;
-    size_t size = vec.size();
-    ofs.write(reinterpret_cast<const char*>(&size), sizeof(size));
-    ofs.write(reinterpret_cast<const char*>(vec.data()), sizeof(T) * size);
-    return ofs.good();
-}
-
-template <typename T>
-bool loadVectorFromFile(const std::string& filename, std::vector<T>& vec) {
-    std::ifstream ifs(filename, std::ios::binary);
-    if (!ifs) return false;
-    size_t size = 0;
-    ifs.read(reinterpret_cast<char*>(&size), sizeof(size));
-    if (!ifs) return false;
-    vec.resize(size);
-    ifs.read(reinterpret_cast<char*>(vec.data()), sizeof(T) * size);
-    return ifs.good();
-}
+// Compile-time specialization of the path tracer fragment shader, one linked program (and one
+// binary cache file) per distinct value. The defaults are the generic kernel; see pathTracerDefines.
+struct PathTracerVariant {
+    bool transparency = true;  // some material is transparent
+    int lightSampling = -1;    // 0 every light, 1 lightSamples point lights, -1 decided per shading point
+    int maxLights = 65536;     // lights evaluated per shading point, rounded up to a power of two
+    int maxBounces = 1024;
+    int blasStackSize = 64;    // wide BLAS traversal stack entries, rounded up to a power of two
+    bool debugOverlays = true; // BVH wireframes and light markers
+    bool fpsOverlay = true;
+
+    bool operator==(const PathTracerVariant& o) const {
+        return transparency == o.transparency && lightSampling == o.lightSampling && maxLights == o.maxLights &&
+               maxBounces == o.maxBounces && blasStackSize == o.blasStackSize && debugOverlays == o.debugOverlays &&
+               fpsOverlay == o.fpsOverlay;
+    }
+    bool operator!=(const PathTracerVariant& o) const { return !(*this == o); }
+};
 
-// Save/load a BVH (nodes + triIndices)
-bool saveBVHToFile(const std::string& base, const BVH& bvh) {
-    return saveVectorToFile(base + ".nodes.bin", bvh.nodes) &&
-           saveVectorToFile(base + ".tris.bin", bvh.triIndices);
-}
-bool loadBVHFromFile(const std::string& base, BVH& bvh) {
-    return loadVectorFromFile(base + ".nodes.bin", bvh.nodes) &&
-           loadVectorFromFile(base + ".tris.bin", bvh.triIndices);
-}
-
-// Save/load BVHInstance vector
-bool saveBVHInstancesToFile(const std::string& filename, const std::vector<BVHInstance>& insts) {
-    return saveVectorToFile(filename, insts);
-}
-bool loadBVHInstancesFromFile(const std::string& filename, std::vector<BVHInstance>& insts) {
-    return loadVectorFromFile(filename, insts);
-}
+// Linked path tracer programs by define list, so toggling a debug overlay back off reuses the
+// production program instead of relinking it
+static std::unordered_map<std::string, GLuint> gPathTracerPrograms;
+static PathTracerVariant gPathTracerVariant; // variant of shaderProgram
+static PathTracerVariant gPendingPathTracerVariant; // variant compiling on gPathTracerThread
+static bool gPathTracerVariantPending = false;
 
 int main(int argc, char** argv) {
     // Parse CLI log level and BVH rebuild flag
     LogLevel logLevel = LogLevel::INFO;
     bool forceRebuildBVH = false;
     bool requestPathTracerOnly = false;
+    bool compareBLASBuilders = false;
+    bool benchmarkRayKernels = false;
     int warmupFrames = 0;
+    double profileIntervalSeconds = 0.0; // 0 only logs the profile summary on exit
+    std::string cpuRenderPath;
+    bool headless = false;
+    HeadlessSettings headlessSettings;
+    CPURenderSettings cpuSettings;
+    cpuSettings.width = static_cast<int>(SCR_WIDTH);
+    cpuSettings.height = static_cast<int>(SCR_HEIGHT);
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--log=debug") logLevel = LogLevel::DEBUG;
@@ -145,6 +269,121 @@ int main(int argc, char** argv) {
         else if (arg == "--log=error") logLevel = LogLevel::ERROR;
         else if (arg == "--rebuild-bvh") forceRebuildBVH = true;
         else if (arg == "--path-tracer-only") requestPathTracerOnly = true;
+        else if (arg == "--bvh-compare") compareBLASBuilders = true;
+        else if (arg == "--ray-bench") benchmarkRayKernels = true;
+        else if (arg == "--bvh-split=midpoint") gBLASSplitMethod = BVHSplitMethod::Midpoint;
+        else if (arg == "--bvh-split=sweep") gBLASSplitMethod = BVHSplitMethod::SAH;
+        else if (arg == "--bvh-split=binned") gBLASSplitMethod = BVHSplitMethod::BinnedSAH;
+        else if (arg == "--bvh-serial") gBLASParallelBuild = false;
+        else if (arg == "--bvh-width=2") gBLASNodeWidth = 2;
+        else if (arg == "--bvh-width=4") gBLASNodeWidth = 4;
+        else if (arg == "--bvh-width=8") gBLASNodeWidth = 8;
+        else if (arg == "--bvh-quantize") gBLASNodeQuantized = true;
+        else if (arg == "--tlas-split=midpoint") gTLASSplitMethod = BVHSplitMethod::Midpoint;
+        else if (arg == "--tlas-split=sweep") gTLASSplitMethod = BVHSplitMethod::SAH;
+        else if (arg == "--tlas-split=binned") gTLASSplitMethod = BVHSplitMethod::BinnedSAH;
+        else if (arg.rfind("--tlas-rebuild-ratio=", 0) == 0) {
+            std::string value = arg.substr(std::string("--tlas-rebuild-ratio=").size());
+            try {
+                gTLASRebuildRatio = std::max(1.0f, std::stof(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --tlas-rebuild-ratio: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--tlas-leaf=", 0) == 0) {
+            std::string value = arg.substr(std::string("--tlas-leaf=").size());
+            try {
+                gTLASMaxLeafSize = std::clamp(std::stoi(value), 1, 16);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --tlas-leaf: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--bvh-bins=", 0) == 0) {
+            std::string value = arg.substr(std::string("--bvh-bins=").size());
+            try {
+                gBLASBinCount = std::clamp(std::stoi(value), 2, 64);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --bvh-bins: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--cpu-render=", 0) == 0) cpuRenderPath = arg.substr(std::string("--cpu-render=").size());
+        else if (arg.rfind("--cpu-spp=", 0) == 0) {
+            std::string value = arg.substr(std::string("--cpu-spp=").size());
+            try {
+                cpuSettings.samplesPerPixel = std::max(1, std::stoi(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --cpu-spp: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--cpu-size=", 0) == 0) {
+            std::string value = arg.substr(std::string("--cpu-size=").size());
+            size_t x = value.find('x');
+            try {
+                if (x == std::string::npos) throw std::invalid_argument(value);
+                cpuSettings.width = std::max(1, std::stoi(value.substr(0, x)));
+                cpuSettings.height = std::max(1, std::stoi(value.substr(x + 1)));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --cpu-size (expected WxH): " << value << std::endl;
+            }
+        }
+        else if (arg == "--headless") headless = true;
+        else if (arg == "--no-accumulation") gAccumulation.enabled = false;
+        else if (arg == "--wavefront") gWavefront = true;
+        else if (arg.rfind("--light-samples=", 0) == 0) {
+            std::string value = arg.substr(std::string("--light-samples=").size());
+            try {
+                gLightSamples = std::max(0, std::stoi(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --light-samples: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--target-spp=", 0) == 0) {
+            std::string value = arg.substr(std::string("--target-spp=").size());
+            try {
+                gAccumulation.targetSamples = std::max(0, std::stoi(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --target-spp: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--headless-out=", 0) == 0) headlessSettings.imagePath = arg.substr(std::string("--headless-out=").size());
+        else if (arg.rfind("--headless-json=", 0) == 0) headlessSettings.timingsPath = arg.substr(std::string("--headless-json=").size());
+        else if (arg.rfind("--headless-reference=", 0) == 0) headlessSettings.referencePath = arg.substr(std::string("--headless-reference=").size());
+        else if (arg.rfind("--headless-frames=", 0) == 0) {
+            std::string value = arg.substr(std::string("--headless-frames=").size());
+            try {
+                headlessSettings.frames = std::max(1, std::stoi(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --headless-frames: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--headless-orbit=", 0) == 0) {
+            std::string value = arg.substr(std::string("--headless-orbit=").size());
+            try {
+                headlessSettings.orbitDegrees = std::stof(value);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --headless-orbit: " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--headless-size=", 0) == 0) {
+            std::string value = arg.substr(std::string("--headless-size=").size());
+            size_t x = value.find('x');
+            try {
+                if (x == std::string::npos) throw std::invalid_argument(value);
+                headlessSettings.width = std::max(1, std::stoi(value.substr(0, x)));
+                headlessSettings.height = std::max(1, std::stoi(value.substr(x + 1)));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --headless-size (expected WxH): " << value << std::endl;
+            }
+        }
+        else if (arg.rfind("--trace=", 0) == 0) Profiler::shared().enableTrace(arg.substr(std::string("--trace=").size()));
+        else if (arg.rfind("--profile-interval=", 0) == 0) {
+            std::string value = arg.substr(std::string("--profile-interval=").size());
+            try {
+                profileIntervalSeconds = std::max(0.0, std::stod(value));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for --profile-interval: " << value << std::endl;
+            }
+        }
         else if (arg.rfind("--warmup-frames=", 0) == 0) {
             std::string value = arg.substr(std::string("--warmup-frames=").size());
             try {
@@ -167,11 +406,12 @@ int main(int argc, char** argv) {
         oss << std::fixed << std::setprecision(3) << ms;
         return oss.str();
     };
-    auto logStartupStep = [&](const std::string& label) {
+    auto logStartupStep = [&](const std::string& label, const std::string& detail = "") {
         auto now = std::chrono::high_resolution_clock::now();
         double sinceLast = std::chrono::duration<double, std::milli>(now - startupCheckpoint).count();
         double total = std::chrono::duration<double, std::milli>(now - startupStart).count();
-        Logger::info("Startup step [" + label + "]: " + formatMs(sinceLast) + " ms (" + formatMs(total) + " ms total)");
+        Logger::info("Startup step [" + label + "]: " + formatMs(sinceLast) + " ms (" + formatMs(total) + " ms total)" + (detail.empty() ? "" : "; " + detail));
+        Profiler::shared().record("startup/" + label, startupCheckpoint, now);
         startupCheckpoint = now;
     };
 
@@ -179,15 +419,102 @@ int main(int argc, char** argv) {
         auto begin = std::chrono::high_resolution_clock::now();
         bool ok = mesh->loadFromOBJ(path, materialIndex);
         auto end = std::chrono::high_resolution_clock::now();
+        Profiler::shared().record("load/mesh " + label, begin, end);
         double elapsed = std::chrono::duration<double, std::milli>(end - begin).count();
         if (!ok) {
             Logger::error("Mesh load failed [" + label + "] from " + path);
         } else {
-            Logger::info("Mesh load [" + label + "] " + std::to_string(mesh->triangles.size()) + " tris in " + formatMs(elapsed) + " ms");
+            std::error_code sizeError;
+            double megabytes = static_cast<double>(fs::file_size(path, sizeError)) / (1024.0 * 1024.0);
+            if (sizeError) megabytes = 0.0;
+            Logger::info("Mesh load [" + label + "] " + std::to_string(mesh->triangleCount()) + " tris in " + formatMs(elapsed) + " ms (" +
+                formatMs(megabytes) + " MB, " + formatMs(elapsed > 0.0 ? megabytes * 1000.0 / elapsed : 0.0) + " MB/s)");
         }
         return ok;
     };
 
+    // Define scene
+    Scene scene;
+
+    // Define camera
+    scene.camera = Camera(
+        glm::vec3(0.0f, 0.0f, 3.0f), // Position
+        glm::vec3(0.0f, 0.0f, -1.0f), // Direction
+        glm::vec3(0.0f, 1.0f, 0.0f), // Up vector
+        70.0f, // FOV
+        float(SCR_WIDTH) / float(SCR_HEIGHT), // Aspect ratio
+        0.1f, // Near plane
+        100.0f // Far plane
+    );
+
+    // Define materials
+    scene.materials = {
+        // 0: Red matte
+        Material(glm::vec3(0.8f, 0.3f, 0.3f), 0.0f, 1.0f, 0.0f, 0.0f, 1.5f),
+        // 1: Green metallic (moderate roughness to avoid mirror-like look)
+        Material(glm::vec3(0.1f, 0.7f, 0.1f), 1.0f, 0.35f, 0.3f, 0.0f, 1.5f),
+        // 2: Mirror
+        Material(glm::vec3(1.0f), 1.0f, 0.05f, 1.0f, 0.0f, 1.5f),
+        // 3: Glass (slight blue tint for visibility)
+        Material(glm::vec3(0.85f, 0.95f, 1.0f), 0.0f, 0.02f, 0.05f, 0.94f, 1.5f),
+        // 4: Rough surface
+        Material(glm::vec3(0.6f, 0.4f, 0.2f), 0.0f, 0.9f, 0.2f, 0.0f, 1.5f)
+    };
+
+    // Define lights
+    scene.lights.push_back(Light(glm::vec4(5.0f, 5.0f, 5.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 300.0f)); // Point light at (5, 5, 5)
+    scene.lights.push_back(Light(glm::vec4(0.8f, 1.4f, 0.3f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), 2.0f)); // Directional light with direction (0.8, 1.4, 0.3)
+
+    // Define game objects
+    // Create shared meshes
+    auto floorMesh = std::make_shared<Mesh>();
+    auto monkeyMesh = std::make_shared<Mesh>();
+    auto monkey2Mesh = std::make_shared<Mesh>();
+    auto movingCubeMesh = std::make_shared<Mesh>();
+    auto movingCubeMesh2 = std::make_shared<Mesh>();
+    auto movingCubeMesh3 = std::make_shared<Mesh>();
+    auto glassMesh = std::make_shared<Mesh>();
+    loadMeshWithTiming(floorMesh, "../meshes/cube.obj", 0, "floor");
+    loadMeshWithTiming(monkeyMesh, "../meshes/monkey.obj", 1, "monkey A");
+    loadMeshWithTiming(monkey2Mesh, "../meshes/monkey.obj", 2, "monkey B");
+    loadMeshWithTiming(movingCubeMesh, "../meshes/car.obj", 0, "car");
+    loadMeshWithTiming(movingCubeMesh2, "../meshes/monkey.obj", 0, "monkey C");
+    loadMeshWithTiming(movingCubeMesh3, "../meshes/monkey.obj", 0, "monkey D");
+    loadMeshWithTiming(glassMesh, "../meshes/monkey.obj", 3, "glass monkey");
+    logStartupStep("Mesh loading");
+
+    // Add GameObjects to the scene
+    scene.gameObjects.push_back(GameObject{floorMesh, glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(8.0f, 0.5f, 8.0f)), glm::vec3(0.0f, -3.0f, 0.0f))});
+    scene.gameObjects.push_back(GameObject{monkeyMesh, glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, 0.0f, 0.0f))});
+    scene.gameObjects.push_back(GameObject{monkey2Mesh, glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0.0f, 0.0f))});
+    scene.gameObjects.push_back(GameObject{movingCubeMesh, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f))});
+    scene.gameObjects.push_back(GameObject{movingCubeMesh2, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -4.f))});
+    scene.gameObjects.push_back(GameObject{movingCubeMesh3, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 4.f))});
+    scene.gameObjects.push_back(GameObject{glassMesh, glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1.2f)), glm::vec3(2.5f, 0.8f, 2.5f))});
+    logStartupStep("Scene graph build");
+
+    if (compareBLASBuilders) {
+        logBLASBuilderComparison(scene);
+        logTLASBuilderComparison(scene);
+        logStartupStep("BVH builder comparison");
+    }
+
+    // The ray kernel benchmark and CPU reference renderer need no window or GL context
+    if (benchmarkRayKernels) {
+        logRayKernelBenchmark(scene);
+        logStartupStep("Ray kernel benchmark");
+        if (cpuRenderPath.empty()) return 0;
+    }
+    if (!cpuRenderPath.empty()) {
+        cpuSettings.lightSamples = gLightSamples;
+        int status = runCPUReferenceRender(scene, cpuRenderPath, cpuSettings);
+        finishProfiling();
+        return status;
+    }
+    if (headless) {
+        return runHeadlessRender(scene, headlessSettings, forceRebuildBVH);
+    }
+
     // Print control scheme at startup
     Logger::info("==== RayZen Controls ====");
     Logger::info("WASD: Move camera");
@@ -266,53 +593,30 @@ int main(int argc, char** argv) {
     auto rasterCompileStart = std::chrono::high_resolution_clock::now();
     rasterShaderProgram = loadShaders("../shaders/editor_vertex.glsl", "../shaders/editor_fragment.glsl");
     auto rasterCompileEnd = std::chrono::high_resolution_clock::now();
+    Profiler::shared().record("shader/raster compile", rasterCompileStart, rasterCompileEnd);
     Logger::info(std::string("Raster shader compile/link time: ") + std::to_string(std::chrono::duration<double, std::milli>(rasterCompileEnd - rasterCompileStart).count()) + " ms");
 
-    int contextMajor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
-    int contextMinor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
-    auto launchAsyncPathTracerCompile = [&](GLFWwindow* shareWindow) -> bool {
-        glfwDefaultWindowHints();
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, contextMajor);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, contextMinor);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-        if (contextMajor >= 4) {
-            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
-        }
-        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-        GLFWwindow* hidden = glfwCreateWindow(16, 16, "RayZenPathTracerCompile", nullptr, shareWindow);
-        glfwDefaultWindowHints();
-        if (!hidden) {
-            return false;
-        }
-        gPathTracerCompileWindow = hidden;
-        gPathTracerThread = std::thread([hidden]() {
-            glfwMakeContextCurrent(hidden);
-            auto start = std::chrono::high_resolution_clock::now();
-            GLuint program = loadShaders("../shaders/vertex_shader.glsl", "../shaders/fragment_shader.glsl");
-            auto end = std::chrono::high_resolution_clock::now();
-            glFinish();
-            gPathTracerProgramHandle.store(program, std::memory_order_release);
-            gPathTracerCompileMs.store(std::chrono::duration<double, std::milli>(end - start).count(), std::memory_order_release);
-            gPathTracerReady.store(true, std::memory_order_release);
-            glfwMakeContextCurrent(nullptr);
-        });
-        return true;
-    };
+    // Production kernel for this scene; debug overlays get their own variant when first toggled on
+    PathTracerVariant startupVariant = pathTracerVariantFor(scene, debugShowLights || debugShowBVH, true);
     bool userLockedEditorMode = false;
-    bool forceImmediatePathTracer = requestPathTracerOnly || warmupFrames > 0;
+    bool forceImmediatePathTracer = requestPathTracerOnly || warmupFrames > 0 || gWavefront;
     if (!forceImmediatePathTracer) {
-        awaitingPathTracerReady = launchAsyncPathTracerCompile(window);
+        awaitingPathTracerReady = launchPathTracerCompile(window, startupVariant, "shader/path tracer compile");
     }
     if (forceImmediatePathTracer || !awaitingPathTracerReady) {
         if (!forceImmediatePathTracer && !awaitingPathTracerReady) {
             Logger::info("Async path tracer compile unavailable; compiling on primary context");
         }
         auto pathTracerStart = std::chrono::high_resolution_clock::now();
-        shaderProgram = loadShaders("../shaders/vertex_shader.glsl", "../shaders/fragment_shader.glsl");
+        bool fromCache = false;
+        adoptPathTracerProgram(startupVariant, loadPathTracer(startupVariant, &fromCache));
         auto pathTracerEnd = std::chrono::high_resolution_clock::now();
+        Profiler::shared().record("shader/path tracer compile", pathTracerStart, pathTracerEnd);
         gPathTracerCompileMs.store(std::chrono::duration<double, std::milli>(pathTracerEnd - pathTracerStart).count(), std::memory_order_release);
         gPathTracerReady.store(true, std::memory_order_release);
-        Logger::info(std::string("Path tracer shader compile/link time: ") + std::to_string(gPathTracerCompileMs.load()) + " ms");
+        gPathTracerFromCache.store(fromCache, std::memory_order_release);
+        Logger::info(std::string("Path tracer shader compile/link time: ") + std::to_string(gPathTracerCompileMs.load()) + " ms" +
+                     (fromCache ? " (program binary cache hit)" : ""));
     } else {
         shaderProgram = 0;
         editorMode = true;
@@ -324,70 +628,21 @@ int main(int argc, char** argv) {
     setupQuad(quadVAO, quadVBO);
     logStartupStep("Fullscreen quad setup");
 
-    // Define scene
-    Scene scene;
-
-    // Define camera
-    scene.camera = Camera(
-        glm::vec3(0.0f, 0.0f, 3.0f), // Position
-        glm::vec3(0.0f, 0.0f, -1.0f), // Direction
-        glm::vec3(0.0f, 1.0f, 0.0f), // Up vector
-        70.0f, // FOV
-        float(SCR_WIDTH) / float(SCR_HEIGHT), // Aspect ratio
-        0.1f, // Near plane
-        100.0f // Far plane
-    );
-
-    // Define materials
-    scene.materials = {
-        // 0: Red matte
-        Material(glm::vec3(0.8f, 0.3f, 0.3f), 0.0f, 1.0f, 0.0f, 0.0f, 1.5f),
-        // 1: Green metallic (moderate roughness to avoid mirror-like look)
-        Material(glm::vec3(0.1f, 0.7f, 0.1f), 1.0f, 0.35f, 0.3f, 0.0f, 1.5f),
-        // 2: Mirror
-        Material(glm::vec3(1.0f), 1.0f, 0.05f, 1.0f, 0.0f, 1.5f),
-        // 3: Glass (slight blue tint for visibility)
-        Material(glm::vec3(0.85f, 0.95f, 1.0f), 0.0f, 0.02f, 0.05f, 0.94f, 1.5f),
-        // 4: Rough surface
-        Material(glm::vec3(0.6f, 0.4f, 0.2f), 0.0f, 0.9f, 0.2f, 0.0f, 1.5f)
-    };
-
-    // Define lights
-    scene.lights.push_back(Light(glm::vec4(5.0f, 5.0f, 5.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 300.0f)); // Point light at (5, 5, 5)
-    scene.lights.push_back(Light(glm::vec4(0.8f, 1.4f, 0.3f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f), 2.0f)); // Directional light with direction (0.8, 1.4, 0.3)
-
-    // Define game objects
-    // Create shared meshes
-    auto floorMesh = std::make_shared<Mesh>();
-    auto monkeyMesh = std::make_shared<Mesh>();
-    auto monkey2Mesh = std::make_shared<Mesh>();
-    auto movingCubeMesh = std::make_shared<Mesh>();
-    auto movingCubeMesh2 = std::make_shared<Mesh>();
-    auto movingCubeMesh3 = std::make_shared<Mesh>();
-    auto glassMesh = std::make_shared<Mesh>();
-    loadMeshWithTiming(floorMesh, "../meshes/cube.obj", 0, "floor");
-    loadMeshWithTiming(monkeyMesh, "../meshes/monkey.obj", 1, "monkey A");
-    loadMeshWithTiming(monkey2Mesh, "../meshes/monkey.obj", 2, "monkey B");
-    loadMeshWithTiming(movingCubeMesh, "../meshes/car.obj", 0, "car");
-    loadMeshWithTiming(movingCubeMesh2, "../meshes/monkey.obj", 0, "monkey C");
-    loadMeshWithTiming(movingCubeMesh3, "../meshes/monkey.obj", 0, "monkey D");
-    loadMeshWithTiming(glassMesh, "../meshes/monkey.obj", 3, "glass monkey");
-    logStartupStep("Mesh loading");
-
-    // Add GameObjects to the scene
-    scene.gameObjects.push_back(GameObject{floorMesh, glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(8.0f, 0.5f, 8.0f)), glm::vec3(0.0f, -3.0f, 0.0f))});
-    scene.gameObjects.push_back(GameObject{monkeyMesh, glm::translate(glm::mat4(1.0f), glm::vec3(-4.0f, 0.0f, 0.0f))});
-    scene.gameObjects.push_back(GameObject{monkey2Mesh, glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0.0f, 0.0f))});
-    scene.gameObjects.push_back(GameObject{movingCubeMesh, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f))});
-    scene.gameObjects.push_back(GameObject{movingCubeMesh2, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -4.f))});
-    scene.gameObjects.push_back(GameObject{movingCubeMesh3, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 4.f))});
-    scene.gameObjects.push_back(GameObject{glassMesh, glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(1.2f)), glm::vec3(2.5f, 0.8f, 2.5f))});
-    logStartupStep("Scene graph build");
-
     // Initialize SSBOs (initial build)
-    initializeSSBOs(scene, forceRebuildBVH);
-    logStartupStep("SSBO/BVH init");
-    buildRasterMeshes(scene);
+    BLASInitStats blasStats = initializeSSBOs(scene, forceRebuildBVH);
+    std::string blasDetail;
+    if (blasStats.built + blasStats.loaded > 0) {
+        blasDetail = "BLAS " + std::to_string(blasStats.built) + " built, " + std::to_string(blasStats.loaded) + " loaded on " +
+            std::to_string(ThreadPool::shared().size()) + " threads: " + formatMs(blasStats.wallMs) + " ms wall vs " +
+            formatMs(blasStats.taskMs) + " ms summed, speedup " + formatMs(blasStats.wallMs > 0.0 ? blasStats.taskMs / blasStats.wallMs : 0.0) + "x";
+    }
+    logStartupStep("SSBO/BVH init", blasDetail);
+    // After the BVH build, so the kernels' BLAS traversal stack fits the uploaded trees
+    if (gWavefront && !gWavefrontTracer.create(loadWavefrontKernel)) {
+        Logger::error("Wavefront kernels unavailable; falling back to the fragment shader path tracer");
+        gWavefront = false;
+    }
+    buildRasterMeshes();
     logStartupStep("Raster mesh build");
     Logger::info("Glass monkey material index 3 at gameObject index " + std::to_string(scene.gameObjects.size()-1));
     logStartupStep("Startup ready");
@@ -405,13 +660,20 @@ int main(int argc, char** argv) {
     const int frameLogLimit = 100;
     const int vsyncRestoreFrame = 5;
     bool vsyncRestored = false;
+    Profiler& profiler = Profiler::shared();
+    auto lastProfileSummary = std::chrono::high_resolution_clock::now();
     while (!glfwWindowShouldClose(window)) {
         auto frameStart = std::chrono::high_resolution_clock::now();
+        profiler.collectGPU();
+        if (profileIntervalSeconds > 0.0 && std::chrono::duration<double>(frameStart - lastProfileSummary).count() >= profileIntervalSeconds) {
+            profiler.logSummary("last " + formatMs(profileIntervalSeconds) + " s");
+            lastProfileSummary = frameStart;
+        }
 
         if (awaitingPathTracerReady && gPathTracerReady.load(std::memory_order_acquire)) {
             GLuint program = gPathTracerProgramHandle.exchange(0, std::memory_order_acq_rel);
             if (program != 0) {
-                shaderProgram = program;
+                adoptPathTracerProgram(startupVariant, program);
                 awaitingPathTracerReady = false;
                 if (!userLockedEditorMode) {
                     editorMode = false;
@@ -421,7 +683,8 @@ int main(int argc, char** argv) {
                 vsyncRestored = false;
                 glfwSwapInterval(0);
                 double compileMs = gPathTracerCompileMs.load(std::memory_order_acquire);
-                Logger::info(std::string("Path tracer shader ready (compile/link time: ") + formatMs(compileMs) + " ms)" + (userLockedEditorMode ? std::string(" Press F1 to enable path tracer when ready.") : std::string("")));
+                Logger::info(std::string("Path tracer shader ready (compile/link time: ") + formatMs(compileMs) + " ms" +
+                             (gPathTracerFromCache.load(std::memory_order_acquire) ? ", program binary cache hit)" : ")") + (userLockedEditorMode ? std::string(" Press F1 to enable path tracer when ready.") : std::string("")));
             } else {
                 Logger::error("Path tracer shader compilation failed; remaining in editor mode");
                 awaitingPathTracerReady = false;
@@ -433,8 +696,7 @@ int main(int argc, char** argv) {
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
-        processInput(window, scene.camera, deltaTime);
-        scene.camera.updateViewMatrix();
+        processInput(window, scene.camera, deltaTime); // moving or turning updates the view matrices
         auto afterInput = std::chrono::high_resolution_clock::now();
 
         static bool editorKeyPressed = false;
@@ -507,53 +769,20 @@ int main(int argc, char** argv) {
             float ndcY = 1.0f - 2.0f * float(mouseY) / float(SCR_HEIGHT);
             // Unproject to world ray
             glm::vec4 rayClip(ndcX, ndcY, -1.0f, 1.0f);
-            glm::mat4 invProj = glm::inverse(scene.camera.projectionMatrix);
-            glm::mat4 invView = glm::inverse(scene.camera.viewMatrix);
-            glm::vec4 rayEye = invProj * rayClip;
+            glm::vec4 rayEye = scene.camera.invProjectionMatrix * rayClip;
             rayEye = glm::vec4(rayEye.x, rayEye.y, -1.0f, 0.0f);
-            glm::vec3 rayDir = glm::normalize(glm::vec3(invView * rayEye));
+            glm::vec3 rayDir = glm::normalize(glm::vec3(scene.camera.invViewMatrix * rayEye));
             glm::vec3 rayOrigin = scene.camera.position;
-            float closestT = 1e30f;
-            int pickedBLAS = -1, pickedTri = -1;
-            for (size_t objIdx = 0; objIdx < scene.gameObjects.size(); ++objIdx) {
-                const auto& obj = scene.gameObjects[objIdx];
-                const auto& mesh = obj.mesh;
-                glm::mat4 invTransform = glm::inverse(obj.transform);
-                glm::vec3 localOrigin = glm::vec3(invTransform * glm::vec4(rayOrigin, 1.0f));
-                glm::vec3 localDir = glm::normalize(glm::vec3(invTransform * glm::vec4(rayDir, 0.0f)));
-                for (size_t triIdx = 0; triIdx < mesh->triangles.size(); ++triIdx) {
-                    const auto& tri = mesh->triangles[triIdx];
-                    // Möller–Trumbore intersection
-                    glm::vec3 v0 = tri.v0, v1 = tri.v1, v2 = tri.v2;
-                    glm::vec3 edge1 = v1 - v0;
-                    glm::vec3 edge2 = v2 - v0;
-                    glm::vec3 h = glm::cross(localDir, edge2);
-                    float a = glm::dot(edge1, h);
-                    if (fabs(a) < 1e-6f) continue;
-                    float f = 1.0f / a;
-                    glm::vec3 s = localOrigin - v0;
-                    float u = f * glm::dot(s, h);
-                    if (u < 0.0f || u > 1.0f) continue;
-                    glm::vec3 q = glm::cross(s, edge1);
-                    float v = f * glm::dot(localDir, q);
-                    if (v < 0.0f || u + v > 1.0f) continue;
-                    float t = f * glm::dot(edge2, q);
-                    if (t > 0.0001f && t < closestT) {
-                        closestT = t;
-                        pickedBLAS = (int)objIdx;
-                        pickedTri = (int)triIdx;
-                    }
-                }
-            }
-            if (pickedBLAS >= 0 && pickedTri >= 0) {
-                debugSelectedBLAS = pickedBLAS;
-                debugSelectedTri = pickedTri;
-            }
+            // Keeps the previous selection when the ray hits nothing
+            pickTriangle(rayOrigin, rayDir, debugSelectedBLAS, debugSelectedTri);
         }
 
-        // Update camera aspect ratio and projection matrix each frame
-        scene.camera.aspectRatio = float(SCR_WIDTH) / float(SCR_HEIGHT);
-        scene.camera.updateProjectionMatrix();
+        // Follow the window's aspect ratio; the projection only changes on a resize
+        float aspectRatio = float(SCR_WIDTH) / float(SCR_HEIGHT);
+        if (aspectRatio != scene.camera.aspectRatio) {
+            scene.camera.aspectRatio = aspectRatio;
+            scene.camera.updateProjectionMatrix();
+        }
 
         // Rotate the first cube
         //scene.meshes[0].transform = glm::rotate(scene.meshes[0].transform, deltaTime, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -565,7 +794,7 @@ int main(int argc, char** argv) {
         //    GameObject& movingCube = scene.gameObjects.back();
         //    float x = -2.0f + 2.0f * sin(animTime);
         //    float y = 0.5f + 0.5f * cos(animTime * 0.5f);
-        //    movingCube.transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+        //    movingCube.setTransform(glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f)));
         //}
 
         // Update dynamic BVH/SSBOs for game objects
@@ -574,11 +803,18 @@ int main(int argc, char** argv) {
 
         if (editorMode || shaderProgram == 0) {
             auto beforeRender = std::chrono::high_resolution_clock::now();
+            profiler.beginGPU("gpu/raster");
             renderRasterized(scene);
+            profiler.endGPU();
             auto afterRender = std::chrono::high_resolution_clock::now();
             glfwSwapBuffers(window);
             glfwPollEvents();
             auto frameEnd = std::chrono::high_resolution_clock::now();
+            profiler.record("editor/input", frameStart, afterInput);
+            profiler.record("editor/bvh", afterInput, afterBVH);
+            profiler.record("editor/render", beforeRender, afterRender);
+            profiler.record("editor/swap", afterRender, frameEnd);
+            profiler.record("editor/total", frameStart, frameEnd);
             if (frameCounter < frameLogLimit) {
                 double totalMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
                 double inputMs = std::chrono::duration<double, std::milli>(afterInput - frameStart).count();
@@ -596,25 +832,16 @@ int main(int argc, char** argv) {
             continue;
         }
 
+        selectPathTracerVariant(pathTracerVariantFor(scene, debugShowLights || debugShowBVH, true));
+
         // Send scene data to the shader
-    int bounceBudget = (frameCounter == 0) ? 1 : 5;
+    int bounceBudget = (frameCounter == 0) ? 1 : kMaxBounceBudget;
     sendSceneDataToShader(shaderProgram, scene, bounceBudget);
+        prepareAccumulation(shaderProgram, scene, bounceBudget);
+        if (gWavefront) traceWavefrontSample(bounceBudget);
         auto afterSend = std::chrono::high_resolution_clock::now();
 
-        // Set debugShowLights uniform
-        GLint debugLoc = glGetUniformLocation(shaderProgram, "debugShowLights");
-        glUniform1i(debugLoc, debugShowLights ? 1 : 0);
-        // Set debugShowBVH uniform
-        GLint bvhLoc = glGetUniformLocation(shaderProgram, "debugShowBVH");
-        glUniform1i(bvhLoc, debugShowBVH ? 1 : 0);
-        // Set debugBVHMode uniform
-        GLint modeLoc = glGetUniformLocation(shaderProgram, "debugBVHMode");
-        glUniform1i(modeLoc, debugBVHMode);
-        // Set debugSelectedBLAS and debugSelectedTri uniforms
-        GLint selBLASLoc = glGetUniformLocation(shaderProgram, "debugSelectedBLAS");
-        glUniform1i(selBLASLoc, debugSelectedBLAS);
-        GLint selTriLoc = glGetUniformLocation(shaderProgram, "debugSelectedTri");
-        glUniform1i(selTriLoc, debugSelectedTri);
+        sendDebugUniforms(shaderProgram);
 
         // Render the quad
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -626,15 +853,17 @@ int main(int argc, char** argv) {
         float alpha = 0.1f; // Smoothing factor (0.0 = no smoothing, 1.0 = instant)
         if (smoothedFps == 0.0f) smoothedFps = fps;
         else smoothedFps = alpha * fps + (1.0f - alpha) * smoothedFps;
-        GLint fpsLoc = glGetUniformLocation(shaderProgram, "uniformFps");
-        glUniform1f(fpsLoc, smoothedFps);
+        glUniform1f(pathTracerUniforms(shaderProgram).uniformFps, smoothedFps);
         auto useProgEnd = std::chrono::high_resolution_clock::now();
         if (firstFrame) {
             firstUseProgramMs = std::chrono::duration<double, std::milli>(useProgEnd - useProgStart).count();
         }
         glBindVertexArray(quadVAO);
         auto drawStart = std::chrono::high_resolution_clock::now();
+        profiler.beginGPU("gpu/path tracer");
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        finishAccumulation();
+        profiler.endGPU();
         auto drawEnd = std::chrono::high_resolution_clock::now();
         if (firstFrame) {
             firstDrawMs = std::chrono::duration<double, std::milli>(drawEnd - drawStart).count();
@@ -646,6 +875,12 @@ int main(int argc, char** argv) {
         glfwSwapBuffers(window);
         glfwPollEvents();
         auto frameEnd = std::chrono::high_resolution_clock::now();
+        profiler.record("frame/input", frameStart, afterInput);
+        profiler.record("frame/bvh", afterInput, afterBVH);
+        profiler.record("frame/send", afterBVH, afterSend);
+        profiler.record("frame/render", afterSend, drawEnd);
+        profiler.record("frame/swap", drawEnd, frameEnd);
+        profiler.record("frame/total", frameStart, frameEnd);
 
         if (!vsyncRestored && frameCounter >= vsyncRestoreFrame) {
             glfwSwapInterval(1);
@@ -679,6 +914,10 @@ int main(int argc, char** argv) {
         gPathTracerCompileWindow = nullptr;
     }
     cleanupRasterMeshes();
+    gWavefrontTracer.destroy();
+    gFrameConstants.destroy();
+    finishProfiling();
+    glDeleteTextures(1, &gAccumulation.texture);
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
 
@@ -739,26 +978,77 @@ void processInput(GLFWwindow* window, Camera& camera, float deltaTime) {
     }
 }
 
-GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
-    fs::path vertexAbs = fs::absolute(fs::path(vertexPath));
-    fs::path fragmentAbs = fs::absolute(fs::path(fragmentPath));
+// Reads a shader file, expanding `#include "file"` lines (relative to the including file)
+static std::string readShaderSource(const fs::path& path, int depth = 0) {
+    std::ifstream file(path);
+    if (!file) {
+        Logger::error("Failed to open shader source " + path.string());
+        return "";
+    }
+    std::ostringstream source;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t");
+        if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+            size_t open = line.find('"', first), close = line.rfind('"');
+            if (depth < 8 && open != std::string::npos && close > open) {
+                source << readShaderSource(path.parent_path() / line.substr(open + 1, close - open - 1), depth + 1);
+                continue;
+            }
+            Logger::error("Malformed or too deeply nested #include in " + path.string() + ": " + line);
+        }
+        source << line << '\n';
+    }
+    return source.str();
+}
 
-    auto toTimestamp = [](const fs::path& path) -> uint64_t {
-        std::error_code ec;
-        auto ft = fs::last_write_time(path, ec);
-        if (ec) return 0;
-        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(ft.time_since_epoch()).count());
-    };
+// Inserts a `#define` line per entry ("NAME" or "NAME VALUE") right after the #version line
+static std::string injectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    if (defines.empty()) return source;
+    std::string block;
+    for (const std::string& define : defines) block += "#define " + define + "\n";
+    size_t insertAt = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t lineEnd = source.find('\n', version);
+        insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    return source.substr(0, insertAt) + block + source.substr(insertAt);
+}
+
+struct ShaderStageSource {
+    GLenum type;
+    const char* path;
+};
 
-    uint64_t vertexTimestamp = toTimestamp(vertexAbs);
-    uint64_t fragmentTimestamp = toTimestamp(fragmentAbs);
+// Compiles and links the given stages with the defines injected into each, going through the
+// program binary cache next to the first stage. A cached binary is only used when the expanded
+// sources and defines, the GL vendor/renderer/version and the binary's own hash all match what
+// it was written with; anything else, including glProgramBinary rejecting it, compiles from source.
+static GLuint loadProgram(const std::vector<ShaderStageSource>& stages, const std::vector<std::string>& defines = {},
+                          bool* fromCache = nullptr) {
+    if (fromCache) *fromCache = false;
+    std::vector<fs::path> paths;
+    std::vector<std::string> sources;
+    std::string cacheKeyBase, pathList;
+    uint64_t sourceHash = SceneCache::hashValue(stages.size(), 0);
+    for (size_t i = 0; i < stages.size(); ++i) {
+        paths.push_back(fs::absolute(fs::path(stages[i].path)));
+        sources.push_back(injectDefines(readShaderSource(paths[i]), defines));
+        sourceHash = SceneCache::hashValue(stages[i].type, sourceHash);
+        sourceHash = SceneCache::hashBytes(sources[i].data(), sources[i].size(), sourceHash);
+        cacheKeyBase += (i ? "_" : "") + paths[i].filename().string();
+        pathList += (i ? "|" : "") + paths[i].string();
+    }
+    std::string defineList;
+    for (const std::string& define : defines) defineList += define + ";";
 
-    fs::path cacheDir = vertexAbs.parent_path() / "cache";
+    fs::path cacheDir = paths[0].parent_path() / "cache";
     std::error_code cacheEc;
     fs::create_directories(cacheDir, cacheEc);
 
-    std::string cacheKeyBase = vertexAbs.filename().string() + "_" + fragmentAbs.filename().string();
-    std::string cacheKey = cacheKeyBase + "_" + std::to_string(std::hash<std::string>{}(vertexAbs.string() + "|" + fragmentAbs.string()));
+    // Each path and define set gets its own file, so variants of one shader do not evict each other
+    std::string cacheKey = cacheKeyBase + "_" + std::to_string(std::hash<std::string>{}(pathList + "#" + defineList));
     fs::path binaryPath = cacheDir / (cacheKey + ".bin");
     fs::path metaPath = cacheDir / (cacheKey + ".meta");
 
@@ -773,84 +1063,81 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
     }
     bool canUseBinary = binaryFormatCount > 0;
 
+    std::string driver;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const GLubyte* value = glGetString(name);
+        driver += (value ? reinterpret_cast<const char*>(value) : "unknown") + std::string("|");
+    }
+    uint64_t driverHash = SceneCache::hashBytes(driver.data(), driver.size());
+
     if (canUseBinary && fs::exists(binaryPath) && fs::exists(metaPath)) {
         ShaderBinaryMetadata meta{};
         std::ifstream metaFile(metaPath, std::ios::binary);
-        if (metaFile.read(reinterpret_cast<char*>(&meta), sizeof(meta)) &&
-            meta.vertexTimestamp == vertexTimestamp &&
-            meta.fragmentTimestamp == fragmentTimestamp &&
-            meta.binaryLength > 0) {
-            std::vector<char> binary(meta.binaryLength);
+        std::string mismatch;
+        if (!metaFile.read(reinterpret_cast<char*>(&meta), sizeof(meta)) || meta.version != ShaderBinaryMetadata::kVersion) mismatch = "old metadata format";
+        else if (meta.sourceHash != sourceHash) mismatch = "sources or defines changed";
+        else if (meta.driverHash != driverHash) mismatch = "GL driver changed";
+        std::vector<char> binary;
+        if (mismatch.empty()) {
+            std::error_code sizeEc;
+            binary.resize(static_cast<size_t>(meta.binaryLength));
             std::ifstream binFile(binaryPath, std::ios::binary);
-            if (binFile.read(binary.data(), binary.size())) {
-                GLuint program = glCreateProgram();
-                glProgramBinary(program, meta.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
-                GLint linked = GL_FALSE;
-                glGetProgramiv(program, GL_LINK_STATUS, &linked);
-                if (linked == GL_TRUE) {
-                    Logger::info("Loaded shader binary cache for " + cacheKeyBase);
-                    return program;
-                }
-                Logger::info("Shader binary cache invalid for " + cacheKeyBase + ", recompiling");
-                glDeleteProgram(program);
+            if (meta.binaryLength == 0 || fs::file_size(binaryPath, sizeEc) != meta.binaryLength || sizeEc ||
+                !binFile.read(binary.data(), binary.size()) || SceneCache::hashBytes(binary.data(), binary.size()) != meta.binaryHash) {
+                mismatch = "binary file damaged";
+            }
+        }
+        if (mismatch.empty()) {
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, meta.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (linked == GL_TRUE) {
+                Logger::info("Loaded shader binary cache for " + cacheKeyBase);
+                if (fromCache) *fromCache = true;
+                return program;
             }
+            glDeleteProgram(program);
+            while (glGetError() != GL_NO_ERROR) {} // an unsupported binary format also raises GL_INVALID_ENUM
+            mismatch = "driver rejected the binary";
         }
+        Logger::info("Shader binary cache for " + cacheKeyBase + " not used (" + mismatch + "), recompiling");
     }
 
-    // Read vertex and fragment shader files
-    std::ifstream vShaderFile(vertexAbs);
-    std::ifstream fShaderFile(fragmentAbs);
-    std::stringstream vShaderStream, fShaderStream;
-
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-
-    std::string vertexCode = vShaderStream.str();
-    std::string fragmentCode = fShaderStream.str();
-
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-
-    // Compile vertex shader
-    GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, nullptr);
-    glCompileShader(vertex);
     int success;
     char infoLog[512];
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertex, 512, nullptr, infoLog);
-        Logger::error(std::string("Vertex Shader Compilation Error: ") + infoLog);
-    }
-
-    // Compile fragment shader
-    GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, nullptr);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragment, 512, nullptr, infoLog);
-        Logger::error(std::string("Fragment Shader Compilation Error: ") + infoLog);
-    }
-
-    // Link shaders
     GLuint shaderProgram = glCreateProgram();
     if (canUseBinary) {
         glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
-    glAttachShader(shaderProgram, vertex);
-    glAttachShader(shaderProgram, fragment);
+    std::vector<GLuint> shaders;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const char* code = sources[i].c_str();
+        GLuint shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 1, &code, nullptr);
+        glCompileShader(shader);
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+            const char* stageName = stages[i].type == GL_VERTEX_SHADER ? "Vertex" : stages[i].type == GL_FRAGMENT_SHADER ? "Fragment" : "Compute";
+            Logger::error(std::string(stageName) + " Shader Compilation Error (" + paths[i].filename().string() + "): " + infoLog);
+        }
+        glAttachShader(shaderProgram, shader);
+        shaders.push_back(shader);
+    }
+
+    // Link shaders
     glLinkProgram(shaderProgram);
     glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
     if (!success) {
         glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
         Logger::error(std::string("Shader Program Linking Error: ") + infoLog);
     }
+    for (GLuint shader : shaders) {
+        glDeleteShader(shader);
+    }
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-
-    if (canUseBinary) {
+    if (canUseBinary && success) {
         GLint binaryLength = 0;
         glGetProgramiv(shaderProgram, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
         if (binaryLength > 0) {
@@ -861,12 +1148,13 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
             if (lengthWritten > 0) {
                 binary.resize(lengthWritten);
                 ShaderBinaryMetadata meta{};
-                meta.vertexTimestamp = vertexTimestamp;
-                meta.fragmentTimestamp = fragmentTimestamp;
                 meta.binaryFormat = binaryFormat;
-                meta.binaryLength = static_cast<uint32_t>(binary.size());
-                std::ofstream binOut(binaryPath, std::ios::binary);
-                std::ofstream metaOut(metaPath, std::ios::binary);
+                meta.sourceHash = sourceHash;
+                meta.driverHash = driverHash;
+                meta.binaryHash = SceneCache::hashBytes(binary.data(), binary.size());
+                meta.binaryLength = binary.size();
+                std::ofstream binOut(binaryPath, std::ios::binary | std::ios::trunc);
+                std::ofstream metaOut(metaPath, std::ios::binary | std::ios::trunc);
                 if (binOut.write(binary.data(), binary.size()) &&
                     metaOut.write(reinterpret_cast<const char*>(&meta), sizeof(meta))) {
                     Logger::info("Wrote shader binary cache for " + cacheKeyBase);
@@ -878,203 +1166,602 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
     return shaderProgram;
 }
 
-std::vector<Triangle> combineTriangles(const Scene& scene) {
-    std::vector<Triangle> allTriangles;
+GLuint loadShaders(const char* vertexPath, const char* fragmentPath, bool* fromCache, const std::vector<std::string>& defines) {
+    return loadProgram({{GL_VERTEX_SHADER, vertexPath}, {GL_FRAGMENT_SHADER, fragmentPath}}, defines, fromCache);
+}
+
+// Unlike loadShaders, returns 0 when the program fails to link, so callers can fall back
+GLuint loadComputeShader(const char* computePath, const std::vector<std::string>& defines) {
+    GLuint program = loadProgram({{GL_COMPUTE_SHADER, computePath}}, defines);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// RZ_BLAS_STACK_SIZE for the uploaded BLASes: a power-of-two bucket, so a deeper tree rarely needs
+// another program
+static int blasStackSizeBucket() {
+    int size = 64;
+    while (size < gBLASStackEntries) size *= 2;
+    return size;
+}
+
+// The wavefront kernels share the megakernel's bounce bound, so both clamp the budget alike
+GLuint loadWavefrontKernel(const char* computePath) {
+    gWavefrontBLASStackSize = blasStackSizeBucket();
+    return loadComputeShader(computePath, {"RZ_MAX_BOUNCES " + std::to_string(kMaxBounceBudget),
+                                           "RZ_BLAS_STACK_SIZE " + std::to_string(gWavefrontBLASStackSize)});
+}
+
+// Specializes the path tracer for what scene contains, mirroring the run-time decisions of
+// calculateLighting: opaque scenes drop the transparency paths, the light sampling mode is fixed,
+// and the lighting and bounce loops get constant bounds. The light bound is a power-of-two
+// bucket, so adding a light rarely needs another variant.
+PathTracerVariant pathTracerVariantFor(const Scene& scene, bool debugOverlays, bool fpsOverlay) {
+    PathTracerVariant variant;
+    variant.transparency = std::any_of(scene.materials.begin(), scene.materials.end(),
+                                       [](const Material& material) { return material.transparency > 0.0f; });
+    int pointLights = static_cast<int>(std::count_if(scene.lights.begin(), scene.lights.end(),
+                                                     [](const Light& light) { return light.isPointLight(); }));
+    int directionalLights = static_cast<int>(scene.lights.size()) - pointLights;
+    bool sampled = gLightSamples > 0 && pointLights > gLightSamples;
+    variant.lightSampling = sampled ? 1 : 0;
+    int lightsPerPoint = sampled ? directionalLights + gLightSamples : static_cast<int>(scene.lights.size());
+    variant.maxLights = 1;
+    while (variant.maxLights < lightsPerPoint) variant.maxLights *= 2;
+    variant.maxBounces = kMaxBounceBudget;
+    variant.blasStackSize = blasStackSizeBucket();
+    variant.debugOverlays = debugOverlays;
+    variant.fpsOverlay = fpsOverlay;
+    return variant;
+}
+
+// The RZ_ defines of pathtracer_common.glsl and fragment_shader.glsl for variant
+std::vector<std::string> pathTracerDefines(const PathTracerVariant& variant) {
+    return {
+        "RZ_TRANSPARENCY " + std::to_string(variant.transparency ? 1 : 0),
+        "RZ_LIGHT_SAMPLING " + std::to_string(variant.lightSampling),
+        "RZ_MAX_LIGHTS " + std::to_string(variant.maxLights),
+        "RZ_MAX_BOUNCES " + std::to_string(variant.maxBounces),
+        "RZ_BLAS_STACK_SIZE " + std::to_string(variant.blasStackSize),
+        "RZ_DEBUG_OVERLAYS " + std::to_string(variant.debugOverlays ? 1 : 0),
+        "RZ_FPS_OVERLAY " + std::to_string(variant.fpsOverlay ? 1 : 0),
+    };
+}
+
+static std::string pathTracerVariantKey(const PathTracerVariant& variant) {
+    std::string key;
+    for (const std::string& define : pathTracerDefines(variant)) key += (key.empty() ? "" : ", ") + define;
+    return key;
+}
+
+// Touches no globals, so the async compile thread can call it
+GLuint loadPathTracer(const PathTracerVariant& variant, bool* fromCache) {
+    return loadShaders("../shaders/vertex_shader.glsl", "../shaders/fragment_shader.glsl", fromCache, pathTracerDefines(variant));
+}
+
+// Makes program, linked from variant, the current shaderProgram
+void adoptPathTracerProgram(const PathTracerVariant& variant, GLuint program) {
+    gPathTracerPrograms[pathTracerVariantKey(variant)] = program;
+    gPathTracerVariant = variant;
+    shaderProgram = program;
+}
+
+// Hidden window sharing objects with shareWindow's context, created on first use and kept for
+// every later compile; null when the platform cannot create it
+static GLFWwindow* pathTracerCompileContext(GLFWwindow* shareWindow) {
+    if (gPathTracerCompileWindow) return gPathTracerCompileWindow;
+    int contextMajor = glfwGetWindowAttrib(shareWindow, GLFW_CONTEXT_VERSION_MAJOR);
+    int contextMinor = glfwGetWindowAttrib(shareWindow, GLFW_CONTEXT_VERSION_MINOR);
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, contextMajor);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, contextMinor);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (contextMajor >= 4) {
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    gPathTracerCompileWindow = glfwCreateWindow(16, 16, "RayZenPathTracerCompile", nullptr, shareWindow);
+    glfwDefaultWindowHints();
+    return gPathTracerCompileWindow;
+}
+
+// Starts linking variant on gPathTracerThread; gPathTracerReady is set once gPathTracerProgramHandle
+// holds the program (0 on failure). Returns false when no shared context is available.
+bool launchPathTracerCompile(GLFWwindow* shareWindow, const PathTracerVariant& variant, const char* profileLabel) {
+    GLFWwindow* hidden = pathTracerCompileContext(shareWindow);
+    if (!hidden) {
+        return false;
+    }
+    if (gPathTracerThread.joinable()) {
+        gPathTracerThread.join(); // only called once the previous compile has reported ready
+    }
+    gPathTracerReady.store(false, std::memory_order_release);
+    gPathTracerThread = std::thread([hidden, variant, profileLabel]() {
+        glfwMakeContextCurrent(hidden);
+        auto start = std::chrono::high_resolution_clock::now();
+        bool fromCache = false;
+        GLuint program = loadPathTracer(variant, &fromCache);
+        auto end = std::chrono::high_resolution_clock::now();
+        Profiler::shared().record(profileLabel, start, end);
+        glFinish();
+        gPathTracerProgramHandle.store(program, std::memory_order_release);
+        gPathTracerCompileMs.store(std::chrono::duration<double, std::milli>(end - start).count(), std::memory_order_release);
+        gPathTracerFromCache.store(fromCache, std::memory_order_release);
+        gPathTracerReady.store(true, std::memory_order_release);
+        glfwMakeContextCurrent(nullptr);
+    });
+    return true;
+}
+
+// Switches shaderProgram to variant. A variant not linked yet is compiled (from the binary cache
+// when possible) on the shared-context thread, and the current program keeps rendering until it
+// is ready; without a shared context it is linked here instead.
+void selectPathTracerVariant(const PathTracerVariant& variant) {
+    if (gPathTracerVariantPending) {
+        if (!gPathTracerReady.load(std::memory_order_acquire)) return;
+        gPathTracerVariantPending = false;
+        std::string key = pathTracerVariantKey(gPendingPathTracerVariant);
+        Logger::info("Path tracer variant (" + key + ") compile/link time: " + std::to_string(gPathTracerCompileMs.load(std::memory_order_acquire)) +
+                     " ms on the compile thread" + (gPathTracerFromCache.load(std::memory_order_acquire) ? " (program binary cache hit)" : ""));
+        gPathTracerPrograms[key] = gPathTracerProgramHandle.exchange(0, std::memory_order_acq_rel);
+    }
+    if (shaderProgram != 0 && variant == gPathTracerVariant) return;
+    std::string key = pathTracerVariantKey(variant);
+    auto it = gPathTracerPrograms.find(key);
+    if (it != gPathTracerPrograms.end()) {
+        adoptPathTracerProgram(variant, it->second);
+        return;
+    }
+    if (launchPathTracerCompile(glfwGetCurrentContext(), variant, "shader/path tracer variant compile")) {
+        gPendingPathTracerVariant = variant;
+        gPathTracerVariantPending = true;
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    bool fromCache = false;
+    GLuint program = loadPathTracer(variant, &fromCache);
+    auto end = std::chrono::high_resolution_clock::now();
+    Profiler::shared().record("shader/path tracer variant compile", start, end);
+    Logger::info("Path tracer variant (" + key + ") compile/link time: " +
+                 std::to_string(std::chrono::duration<double, std::milli>(end - start).count()) + " ms" +
+                 (fromCache ? " (program binary cache hit)" : ""));
+    adoptPathTracerProgram(variant, program);
+}
+
+// Replaces the whole contents of an SSBO, reallocating only when it outgrew its storage
+static void uploadSSBO(GLuint buffer, const void* data, size_t bytes) {
+    size_t& capacity = gSSBOCapacity[buffer];
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    if (bytes > capacity) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+        capacity = bytes;
+    } else if (bytes > 0) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, data);
+    }
+}
+
+// Uploads count elements to an SSBO starting at element firstElement
+template <typename T>
+static void uploadSSBORange(GLuint buffer, int firstElement, const T* data, size_t count) {
+    if (count == 0) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, firstElement * sizeof(T), count * sizeof(T), data);
+}
+
+static void configureBLAS(BVH& blas) {
+    blas.splitMethod = gBLASSplitMethod;
+    blas.sahBinCount = gBLASBinCount;
+    blas.parallelBuild = gBLASParallelBuild;
+}
+
+static void configureTLAS(BVH& tlas) {
+    tlas.tlasSplitMethod = gTLASSplitMethod;
+    tlas.tlasMaxLeafSize = gTLASMaxLeafSize;
+    tlas.sahBinCount = gBLASBinCount;
+    tlas.parallelBuild = gBLASParallelBuild;
+    tlas.rebuildCostRatio = gTLASRebuildRatio;
+}
+
+// Size of one BLAS node in the shader's format: a binary node, or a wide node with all its child slots
+static size_t gpuNodeWords() {
+    if (gBLASNodeWidth == 2) return sizeof(BVHNode) / sizeof(uint32_t);
+    int width = gBLASNodeWidth <= 4 ? 4 : 8;
+    return gBLASNodeQuantized ? 4 + 3 * width : width * sizeof(BVHNode) / sizeof(uint32_t);
+}
+
+// Appends a BLAS to the shader's node buffer (collapsing it for wide formats); returns its node count
+static int appendGPUNodes(const BVH& blas, std::vector<uint32_t>& out) {
+    if (gBLASNodeWidth == 2) {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(blas.nodes.data());
+        out.insert(out.end(), words, words + blas.nodes.size() * gpuNodeWords());
+        return static_cast<int>(blas.nodes.size());
+    }
+    WideBVH wide;
+    wide.build(blas, gBLASNodeWidth, gBLASNodeQuantized);
+    if (wide.traversalStackSize() > gBLASStackEntries) {
+        gBLASStackEntries = wide.traversalStackSize();
+        Logger::debug("Wide BLAS of depth " + std::to_string(wide.depth) + " needs " + std::to_string(gBLASStackEntries) + " traversal stack entries");
+    }
+    const uint32_t* words = wide.quantized ? wide.words.data() : reinterpret_cast<const uint32_t*>(wide.slots.data());
+    out.insert(out.end(), words, words + wide.byteSize() / sizeof(uint32_t));
+    return wide.nodeCount;
+}
+
+// Unique meshes in first-use order; objectSlot[i] is the slot of gameObjects[i].mesh.
+// Objects sharing a Mesh share one BLAS and one triangle range.
+struct SceneMeshTable {
+    std::vector<const Mesh*> meshes;
+    std::vector<int> objectSlot;
+};
+
+static SceneMeshTable collectUniqueMeshes(const Scene& scene) {
+    SceneMeshTable table;
+    std::unordered_map<const Mesh*, int> slots;
+    table.objectSlot.reserve(scene.gameObjects.size());
     for (const auto& obj : scene.gameObjects) {
-        for (const auto& tri : obj.mesh->triangles) {
-            Triangle transformed;
-            // Transform each vertex (assumes the obj.transform is rotation/translation/uniform scale)
-            transformed.v0 = glm::vec3(obj.transform * glm::vec4(tri.v0, 1.0f));
-            transformed.v1 = glm::vec3(obj.transform * glm::vec4(tri.v1, 1.0f));
-            transformed.v2 = glm::vec3(obj.transform * glm::vec4(tri.v2, 1.0f));
-            transformed.materialIndex = tri.materialIndex;
-            allTriangles.push_back(transformed);
+        auto it = slots.emplace(obj.mesh.get(), (int)table.meshes.size()).first;
+        if (it->second == (int)table.meshes.size()) table.meshes.push_back(obj.mesh.get());
+        table.objectSlot.push_back(it->second);
+    }
+    return table;
+}
+
+// Appends a mesh to the flattened geometry buffers, rebasing its corners onto the shared vertex buffer
+static void appendMeshGeometry(const Mesh& mesh, std::vector<glm::vec3>& vertices, std::vector<glm::uvec3>& corners, std::vector<int>& materials) {
+    glm::uvec3 base(static_cast<unsigned int>(vertices.size()));
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    for (const glm::uvec3& tri : mesh.indices) corners.push_back(tri + base);
+    materials.insert(materials.end(), mesh.materials.begin(), mesh.materials.end());
+}
+
+// World-space AABB of a mesh root node under an instance transform
+static BVHNode transformRootNode(const BVHNode& meshRoot, const glm::mat4& transform) {
+    glm::vec3 corners[8];
+    corners[0] = meshRoot.boundsMin;
+    corners[1] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
+    corners[2] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
+    corners[3] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMax.z);
+    corners[4] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMin.z);
+    corners[5] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
+    corners[6] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
+    corners[7] = meshRoot.boundsMax;
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    for (int c = 0; c < 8; ++c) {
+        glm::vec3 tc = glm::vec3(transform * glm::vec4(corners[c], 1.0f));
+        bmin = glm::min(bmin, tc);
+        bmax = glm::max(bmax, tc);
+    }
+    BVHNode instRoot = meshRoot;
+    instRoot.boundsMin = bmin;
+    instRoot.boundsMax = bmax;
+    return instRoot;
+}
+
+// Cache key over everything the cached buffers depend on: file format, element layouts, builder
+// settings, the object-to-mesh mapping and every mesh's geometry. Transforms are not part of it;
+// when only they changed, the TLAS is rebuilt over the cached BLASes.
+static uint64_t computeSceneCacheKey(const SceneMeshTable& meshTable) {
+    std::vector<uint64_t> meshHashes(meshTable.meshes.size());
+    ThreadPool::shared().parallelFor(0, static_cast<int>(meshHashes.size()), 1, [&](int begin, int end, int) {
+        for (int m = begin; m < end; ++m) {
+            const Mesh& mesh = *meshTable.meshes[m];
+            uint64_t h = SceneCache::hashBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(glm::vec3), 0);
+            h = SceneCache::hashBytes(mesh.indices.data(), mesh.indices.size() * sizeof(glm::uvec3), h);
+            meshHashes[m] = SceneCache::hashBytes(mesh.materials.data(), mesh.materials.size() * sizeof(int), h);
         }
+    });
+    uint64_t h = SceneCache::hashValue(SceneCache::kVersion, 0);
+    h = SceneCache::hashValue(sizeof(BVHNode), h);
+    h = SceneCache::hashValue(gBLASSplitMethod, h);
+    h = SceneCache::hashValue(gBLASBinCount, h);
+    h = SceneCache::hashValue(gTLASSplitMethod, h);
+    h = SceneCache::hashValue(gTLASMaxLeafSize, h);
+    h = SceneCache::hashBytes(meshTable.objectSlot.data(), meshTable.objectSlot.size() * sizeof(int), h);
+    return SceneCache::hashBytes(meshHashes.data(), meshHashes.size() * sizeof(uint64_t), h);
+}
+
+static uint64_t computeTransformHash(const Scene& scene) {
+    uint64_t h = 0;
+    for (const auto& obj : scene.gameObjects) h = SceneCache::hashValue(obj.transform, h);
+    return h;
+}
+
+// BLAS of a mesh slot, copied out of the mapped scene cache the first time the CPU needs it
+static BVH& slotBLAS(DynamicSceneState& dyn, size_t slot) {
+    BVH& blas = dyn.meshBLAS[slot];
+    if (blas.nodes.empty() && dyn.cache) {
+        const DynamicSceneState::CachedRange& range = dyn.cachedBLAS[slot];
+        size_t count;
+        const BVHNode* nodes = dyn.cache->sectionAs<BVHNode>(SceneCache::BLASNodes, count);
+        const int* triIndices = dyn.cache->sectionAs<int>(SceneCache::BLASTriIndices, count);
+        blas.nodes.assign(nodes + range.nodeOffset, nodes + range.nodeOffset + range.nodeCount);
+        blas.triIndices.assign(triIndices + range.triOffset, triIndices + range.triOffset + range.triCount);
+    }
+    return blas;
+}
+
+// Leaf blocks of a mesh slot's BLAS, built the first time a CPU ray query needs them
+static const BVHLeafBlocks& slotLeafBlocks(DynamicSceneState& dyn, size_t slot) {
+    BVHLeafBlocks& leaves = dyn.meshLeafBlocks[slot];
+    if (leaves.nodeFirstBlock.empty()) leaves.append(slotBLAS(dyn, slot), *dyn.meshes[slot]);
+    return leaves;
+}
+
+// Closest triangle along a world ray, through the CPU copies of the TLAS and BLASes the shader
+// traverses; instance is the game object index, triangle indexes its mesh. Both are left
+// unchanged on a miss.
+bool pickTriangle(const glm::vec3& origin, const glm::vec3& direction, int& instance, int& triangle) {
+    DynamicSceneState& dyn = gDynamicScene;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<const BVH*> slotTrees;
+    std::vector<const BVHLeafBlocks*> slotLeaves;
+    for (size_t slot = 0; slot < dyn.meshes.size(); ++slot) {
+        slotLeaves.push_back(&slotLeafBlocks(dyn, slot));
+        slotTrees.push_back(&slotBLAS(dyn, slot));
     }
-    return allTriangles;
+    SceneRayQuery query(dyn.tlas, dyn.instances, std::move(slotTrees), std::move(slotLeaves));
+    RayQueryHit hit;
+    if (!query.closestHit(QueryRay{origin, direction}, hit)) return false;
+    if (hit.instance != instance || hit.triangle != triangle) {
+        double us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        Logger::debug("Picked object " + std::to_string(hit.instance) + ", triangle " + std::to_string(hit.triangle) + " in " + std::to_string(us) + " us");
+    }
+    instance = hit.instance;
+    triangle = hit.triangle;
+    return true;
 }
 
-void initializeSSBOs(const Scene& scene, bool forceRebuildBVH) {
+BLASInitStats initializeSSBOs(const Scene& scene, bool forceRebuildBVH) {
+    BLASInitStats stats;
     // Cache directory
-    std::string cacheDir = "bvh_cache/v2/";
+    std::string cacheDir = "bvh_cache/";
     if (!fs::exists(cacheDir)) {
         fs::create_directories(cacheDir);
         Logger::info("Created BVH cache directory: " + cacheDir);
     }
 
-    // Try to load SSBO-ready data from cache
-    std::vector<Triangle> allTriangles;
-    std::vector<BVHNode> allBLASNodes;
-    std::vector<int> allBLASTriIndices;
-    std::vector<BVHInstance> meshInstances;
-    std::vector<BVHNode> tlasNodes;
-    std::vector<int> tlasTriIndices;
-    bool loadedSSBOCache = false;
-    std::string ssboCachePrefix = cacheDir + "ssbo_v2_";
-    if (!forceRebuildBVH &&
-        fs::exists(ssboCachePrefix + "triangles.bin") &&
-        fs::exists(ssboCachePrefix + "blasnodes.bin") &&
-        fs::exists(ssboCachePrefix + "blastris.bin") &&
-        fs::exists(ssboCachePrefix + "instances.bin") &&
-        fs::exists(ssboCachePrefix + "tlasnodes.bin") &&
-        fs::exists(ssboCachePrefix + "tlastris.bin")) {
-        loadedSSBOCache =
-            loadVectorFromFile(ssboCachePrefix + "triangles.bin", allTriangles) &&
-            loadVectorFromFile(ssboCachePrefix + "blasnodes.bin", allBLASNodes) &&
-            loadVectorFromFile(ssboCachePrefix + "blastris.bin", allBLASTriIndices) &&
-            loadVectorFromFile(ssboCachePrefix + "instances.bin", meshInstances) &&
-            loadVectorFromFile(ssboCachePrefix + "tlasnodes.bin", tlasNodes) &&
-            loadVectorFromFile(ssboCachePrefix + "tlastris.bin", tlasTriIndices);
-        if (loadedSSBOCache) {
-            // Invalidate if scene object count changed since cache write
-            if (meshInstances.size() != scene.gameObjects.size()) {
-                Logger::info("Cache invalidated: game object count changed (was " + std::to_string(meshInstances.size()) + ", now " + std::to_string(scene.gameObjects.size()) + ")");
-                loadedSSBOCache = false;
-                allTriangles.clear(); allBLASNodes.clear(); allBLASTriIndices.clear();
-                meshInstances.clear(); tlasNodes.clear(); tlasTriIndices.clear();
-            } else {
-                Logger::info("Loaded SSBO data from cache");
-            }
+    SceneMeshTable meshTable = collectUniqueMeshes(scene);
+    size_t meshCount = meshTable.meshes.size();
+    Logger::info(std::to_string(scene.gameObjects.size()) + " game objects reference " + std::to_string(meshCount) + " unique meshes");
+    auto keyStart = std::chrono::high_resolution_clock::now();
+    uint64_t cacheKey = computeSceneCacheKey(meshTable);
+    uint64_t transformHash = computeTransformHash(scene);
+    std::ostringstream keyHex;
+    keyHex << std::hex << std::setw(16) << std::setfill('0') << cacheKey;
+    std::string cachePath = cacheDir + "scene_" + keyHex.str() + ".rzc";
+    Logger::info("Scene cache key " + keyHex.str() + " hashed in " +
+        std::to_string(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - keyStart).count()) + " ms");
+
+    DynamicSceneState& dyn = gDynamicScene;
+    size_t objectCount = scene.gameObjects.size();
+    dyn.objectMeshes.clear();
+    for (const auto& obj : scene.gameObjects) dyn.objectMeshes.push_back(obj.mesh.get());
+    dyn.objectSlot = meshTable.objectSlot;
+    dyn.meshes = meshTable.meshes;
+    dyn.meshBLAS.assign(meshCount, BVH());
+    for (auto& blas : dyn.meshBLAS) configureBLAS(blas);
+    dyn.meshLeafBlocks.assign(meshCount, BVHLeafBlocks());
+    dyn.cachedBLAS.assign(meshCount, DynamicSceneState::CachedRange{});
+    dyn.tlas = BVH();
+    configureTLAS(dyn.tlas);
+
+    // The uploads read through these: into the mapped cache on a hit, into the built arrays otherwise
+    const glm::vec3* vertices = nullptr;
+    const glm::uvec3* corners = nullptr;
+    const int* triMaterials = nullptr;
+    const BVHNode* blasNodes = nullptr;
+    const int* blasTriIndices = nullptr;
+    size_t vertexCount = 0, triangleCount = 0, blasNodeCount = 0, blasTriIndexCount = 0;
+    std::vector<glm::vec3> builtVertices;
+    std::vector<glm::uvec3> builtCorners;
+    std::vector<int> builtMaterials;
+    std::vector<BVHNode> builtBLASNodes;
+    std::vector<int> builtBLASTriIndices;
+    bool tlasCached = false;
+
+    dyn.cache = std::make_unique<SceneCache>();
+    auto mapStart = std::chrono::high_resolution_clock::now();
+    bool cacheHit = !forceRebuildBVH && dyn.cache->open(cachePath, cacheKey);
+    if (cacheHit) {
+        size_t rangeCount;
+        const DynamicSceneState::CachedRange* ranges = dyn.cache->sectionAs<DynamicSceneState::CachedRange>(SceneCache::MeshRanges, rangeCount);
+        size_t materialCount;
+        vertices = dyn.cache->sectionAs<glm::vec3>(SceneCache::Vertices, vertexCount);
+        corners = dyn.cache->sectionAs<glm::uvec3>(SceneCache::TriangleCorners, triangleCount);
+        triMaterials = dyn.cache->sectionAs<int>(SceneCache::TriangleMaterials, materialCount);
+        blasNodes = dyn.cache->sectionAs<BVHNode>(SceneCache::BLASNodes, blasNodeCount);
+        blasTriIndices = dyn.cache->sectionAs<int>(SceneCache::BLASTriIndices, blasTriIndexCount);
+        // The key already covers the layout; this only guards against a damaged file
+        cacheHit = rangeCount == meshCount && materialCount == triangleCount;
+        for (size_t m = 0; cacheHit && m < meshCount; ++m) {
+            const auto& r = ranges[m];
+            cacheHit = r.nodeCount > 0 && r.nodeOffset >= 0 && r.triOffset >= 0 && r.triCount >= 0 &&
+                       static_cast<size_t>(r.nodeOffset) + r.nodeCount <= blasNodeCount &&
+                       static_cast<size_t>(r.triOffset) + r.triCount <= blasTriIndexCount;
         }
-    }
-
-    if (!loadedSSBOCache) {
-        std::vector<BVH> meshBLAS(scene.gameObjects.size());
-        std::vector<BVHNode> worldRootNodes;
-        worldRootNodes.reserve(scene.gameObjects.size());
-        int nodeOffset = 0;
-        int triOffset = 0;
-        bool loadedAllBLAS = true;
-        meshInstances.clear();
-        allTriangles.clear();
-
-        for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
-            const auto& obj = scene.gameObjects[i];
-            const auto& mesh = obj.mesh;
-            const auto& meshTris = mesh->triangles;
-            std::string meshName = "mesh" + std::to_string(i);
-            std::string blasBase = cacheDir + meshName;
-            bool loaded = false;
-            if (!forceRebuildBVH && fs::exists(blasBase + ".nodes.bin") && fs::exists(blasBase + ".tris.bin")) {
-                loaded = loadBVHFromFile(blasBase, meshBLAS[i]);
-                if (loaded) {
-                    Logger::info("Loaded BLAS from cache for " + meshName);
-                }
-            }
-            if (!loaded) {
-                Logger::info("Building BLAS from scratch for " + meshName);
-                meshBLAS[i].buildBLAS(meshTris);
-                saveBVHToFile(blasBase, meshBLAS[i]);
-                Logger::info("Saved BLAS to cache for " + meshName);
-            }
-
-            size_t triBase = allTriangles.size();
-            allTriangles.insert(allTriangles.end(), meshTris.begin(), meshTris.end());
-
-            const BVHNode& meshRoot = meshBLAS[i].nodes[0];
-            glm::vec3 corners[8];
-            corners[0] = meshRoot.boundsMin;
-            corners[1] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
-            corners[2] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
-            corners[3] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMax.z);
-            corners[4] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMin.z);
-            corners[5] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
-            corners[6] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
-            corners[7] = meshRoot.boundsMax;
-            glm::vec3 bmin(1e30f), bmax(-1e30f);
-            for (int c = 0; c < 8; ++c) {
-                glm::vec3 tc = glm::vec3(obj.transform * glm::vec4(corners[c], 1.0f));
-                bmin = glm::min(bmin, tc);
-                bmax = glm::max(bmax, tc);
+        if (cacheHit) {
+            dyn.cachedBLAS.assign(ranges, ranges + meshCount);
+            if (dyn.cache->transformHash() == transformHash) {
+                size_t count;
+                const BVHNode* tlasNodes = dyn.cache->sectionAs<BVHNode>(SceneCache::TLASNodes, count);
+                dyn.tlas.nodes.assign(tlasNodes, tlasNodes + count);
+                const int* tlasTriIndices = dyn.cache->sectionAs<int>(SceneCache::TLASTriIndices, count);
+                dyn.tlas.triIndices.assign(tlasTriIndices, tlasTriIndices + count);
+                tlasCached = true;
             }
-            BVHNode instRoot = meshRoot;
-            instRoot.boundsMin = bmin;
-            instRoot.boundsMax = bmax;
-            worldRootNodes.push_back(instRoot);
-
-            BVHInstance inst{};
-            inst.blasNodeOffset = nodeOffset;
-            inst.blasTriOffset = triOffset;
-            inst.globalTriOffset = static_cast<int>(triBase);
-            inst.meshIndex = static_cast<int>(i);
-            inst.transform = obj.transform;
-            inst.inverseTransform = glm::inverse(obj.transform);
-            meshInstances.push_back(inst);
-
-            nodeOffset += static_cast<int>(meshBLAS[i].nodes.size());
-            triOffset += static_cast<int>(meshBLAS[i].triIndices.size());
-            loadedAllBLAS &= loaded;
+            stats.loaded = static_cast<int>(meshCount);
+            stats.wallMs = stats.taskMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mapStart).count();
+            Logger::info("Mapped scene cache " + cachePath + " (" + std::to_string(dyn.cache->fileSize() / 1024) + " KB)" +
+                (tlasCached ? "" : "; transforms changed since it was written, rebuilding the TLAS"));
+        } else {
+            Logger::error("Scene cache " + cachePath + " has inconsistent mesh ranges, rebuilding");
         }
+    }
 
-        BVH tlas;
-        tlas.nodes.clear();
-        tlas.triIndices.clear();
-        std::string tlasBase = cacheDir + "scene_tlas";
-        bool loadedTLAS = false;
-        if (!forceRebuildBVH && loadedAllBLAS && fs::exists(tlasBase + ".nodes.bin") && fs::exists(tlasBase + ".tris.bin") && fs::exists(cacheDir + "instances.bin")) {
-            loadedTLAS = loadBVHFromFile(tlasBase, tlas) && loadBVHInstancesFromFile(cacheDir + "instances.bin", meshInstances);
-            if (loadedTLAS) {
-                Logger::info("Loaded TLAS and BVHInstances from cache");
-            }
+    if (!cacheHit) {
+        dyn.cache.reset();
+        Logger::info(forceRebuildBVH ? std::string("Rebuilding BVHs (--rebuild-bvh)") : "No scene cache for key " + keyHex.str() + ", building BVHs");
+        // Build every unique mesh's BLAS concurrently; each task only writes its own slot
+        std::vector<double> blasMs(meshCount, 0.0);
+        ThreadPool& pool = ThreadPool::shared();
+        ThreadPool::TaskGroup blasGroup;
+        auto blasStart = std::chrono::high_resolution_clock::now();
+        for (size_t m = 0; m < meshCount; ++m) {
+            pool.run(blasGroup, [&, m]() {
+                auto taskStart = std::chrono::high_resolution_clock::now();
+                dyn.meshBLAS[m].buildBLAS(*meshTable.meshes[m]);
+                auto taskEnd = std::chrono::high_resolution_clock::now();
+                Profiler::shared().record("bvh/blas build", taskStart, taskEnd);
+                blasMs[m] = std::chrono::duration<double, std::milli>(taskEnd - taskStart).count();
+            });
         }
-        if (!loadedTLAS) {
-            Logger::info("Building TLAS from scratch");
-            tlas.nodes.clear();
-            tlas.triIndices.clear();
-            tlas.buildTLAS(meshInstances, worldRootNodes);
-            saveBVHToFile(tlasBase, tlas);
-            saveBVHInstancesToFile(cacheDir + "instances.bin", meshInstances);
-            Logger::info("Saved TLAS and BVHInstances to cache");
+        pool.wait(blasGroup);
+        stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - blasStart).count();
+        stats.built = static_cast<int>(meshCount);
+
+        // Ranges are assigned in mesh order once all builds finished, so the layout is deterministic
+        for (size_t m = 0; m < meshCount; ++m) {
+            const BVH& blas = dyn.meshBLAS[m];
+            stats.taskMs += blasMs[m];
+            dyn.cachedBLAS[m] = {static_cast<int>(builtBLASNodes.size()), static_cast<int>(blas.nodes.size()),
+                                 static_cast<int>(builtBLASTriIndices.size()), static_cast<int>(blas.triIndices.size())};
+            builtBLASNodes.insert(builtBLASNodes.end(), blas.nodes.begin(), blas.nodes.end());
+            builtBLASTriIndices.insert(builtBLASTriIndices.end(), blas.triIndices.begin(), blas.triIndices.end());
+            appendMeshGeometry(*meshTable.meshes[m], builtVertices, builtCorners, builtMaterials);
         }
+        vertices = builtVertices.data();
+        vertexCount = builtVertices.size();
+        corners = builtCorners.data();
+        triMaterials = builtMaterials.data();
+        triangleCount = builtCorners.size();
+        blasNodes = builtBLASNodes.data();
+        blasNodeCount = builtBLASNodes.size();
+        blasTriIndices = builtBLASTriIndices.data();
+        blasTriIndexCount = builtBLASTriIndices.size();
+    }
 
-        allBLASNodes.clear();
-        allBLASTriIndices.clear();
-        for (const auto& blas : meshBLAS) {
-            allBLASNodes.insert(allBLASNodes.end(), blas.nodes.begin(), blas.nodes.end());
-            allBLASTriIndices.insert(allBLASTriIndices.end(), blas.triIndices.begin(), blas.triIndices.end());
-        }
-        tlasNodes = tlas.nodes;
-        tlasTriIndices = tlas.triIndices;
-
-        saveVectorToFile(ssboCachePrefix + "triangles.bin", allTriangles);
-        saveVectorToFile(ssboCachePrefix + "blasnodes.bin", allBLASNodes);
-        saveVectorToFile(ssboCachePrefix + "blastris.bin", allBLASTriIndices);
-        saveVectorToFile(ssboCachePrefix + "instances.bin", meshInstances);
-        saveVectorToFile(ssboCachePrefix + "tlasnodes.bin", tlasNodes);
-        saveVectorToFile(ssboCachePrefix + "tlastris.bin", tlasTriIndices);
-        Logger::info("Saved SSBO data to cache");
-
-        for (size_t i = 0; i < tlasTriIndices.size(); ++i) {
-            if (tlasTriIndices[i] < 0 || tlasTriIndices[i] >= static_cast<int>(meshInstances.size())) {
-                Logger::error("Invalid TLAS tri index at " + std::to_string(i) + ": " + std::to_string(tlasTriIndices[i]));
-            }
+    // Encode the BLASes in the shader's node format. Binary nodes are uploaded as stored;
+    // wide formats need the CPU trees to collapse them.
+    std::vector<uint32_t> gpuBLASNodes;
+    const void* gpuBLASNodeData = blasNodes;
+    size_t gpuBLASNodeBytes = blasNodeCount * sizeof(BVHNode);
+    dyn.meshNodeOffset.assign(meshCount, 0);
+    dyn.meshNodeCount.assign(meshCount, 0);
+    dyn.meshTriOffset.assign(meshCount, 0);
+    dyn.meshGlobalTriOffset.assign(meshCount, 0);
+    dyn.meshVertexOffset.assign(meshCount, 0);
+    dyn.meshVertexCount.assign(meshCount, 0);
+    int globalTriOffset = 0, globalVertexOffset = 0;
+    for (size_t m = 0; m < meshCount; ++m) {
+        dyn.meshTriOffset[m] = dyn.cachedBLAS[m].triOffset;
+        dyn.meshGlobalTriOffset[m] = globalTriOffset;
+        dyn.meshVertexOffset[m] = globalVertexOffset;
+        dyn.meshVertexCount[m] = static_cast<int>(meshTable.meshes[m]->vertices.size());
+        globalTriOffset += static_cast<int>(meshTable.meshes[m]->triangleCount());
+        globalVertexOffset += static_cast<int>(meshTable.meshes[m]->vertices.size());
+        if (gBLASNodeWidth == 2) {
+            dyn.meshNodeOffset[m] = dyn.cachedBLAS[m].nodeOffset;
+            dyn.meshNodeCount[m] = dyn.cachedBLAS[m].nodeCount;
+        } else {
+            dyn.meshNodeOffset[m] = static_cast<int>(gpuBLASNodes.size() / gpuNodeWords());
+            dyn.meshNodeCount[m] = appendGPUNodes(slotBLAS(dyn, m), gpuBLASNodes);
         }
     }
+    if (gBLASNodeWidth != 2) {
+        gpuBLASNodeData = gpuBLASNodes.data();
+        gpuBLASNodeBytes = gpuBLASNodes.size() * sizeof(uint32_t);
+        Logger::info("BLAS nodes collapsed to BVH" + std::to_string(gBLASNodeWidth <= 4 ? 4 : 8) + (gBLASNodeQuantized ? " (quantized)" : "") +
+            ": " + std::to_string(gpuBLASNodeBytes / 1024) + " KB vs " + std::to_string(blasNodeCount * sizeof(BVHNode) / 1024) + " KB binary");
+    }
 
-    if (loadedSSBOCache) {
-        for (size_t i = 0; i < meshInstances.size() && i < scene.gameObjects.size(); ++i) {
-            meshInstances[i].transform = scene.gameObjects[i].transform;
-            meshInstances[i].meshIndex = static_cast<int>(i);
-            meshInstances[i].inverseTransform = glm::inverse(scene.gameObjects[i].transform);
+    // Instances only carry the current transform plus offsets into the shared mesh data
+    dyn.instances.clear();
+    dyn.localRoots.clear();
+    dyn.worldRoots.clear();
+    for (size_t i = 0; i < objectCount; ++i) {
+        const auto& obj = scene.gameObjects[i];
+        int slot = meshTable.objectSlot[i];
+        BVHInstance inst{};
+        inst.blasNodeOffset = dyn.meshNodeOffset[slot];
+        inst.blasTriOffset = dyn.meshTriOffset[slot];
+        inst.globalTriOffset = dyn.meshGlobalTriOffset[slot];
+        inst.meshIndex = slot;
+        inst.transform = obj.transform;
+        inst.inverseTransform = glm::inverse(obj.transform);
+        dyn.instances.push_back(inst);
+        dyn.localRoots.push_back(blasNodes[dyn.cachedBLAS[slot].nodeOffset]);
+        dyn.worldRoots.push_back(transformRootNode(dyn.localRoots.back(), obj.transform));
+    }
+    if (!tlasCached) {
+        ProfileScope scope("bvh/tlas build");
+        dyn.tlas.buildTLAS(dyn.instances, dyn.worldRoots);
+        Logger::info("Built TLAS over " + std::to_string(dyn.instances.size()) + " instances: " + std::to_string(dyn.tlas.nodes.size()) +
+            " nodes, SAH cost " + std::to_string(dyn.tlas.computeSAHCost()));
+    }
+    for (size_t i = 0; i < dyn.tlas.triIndices.size(); ++i) {
+        if (dyn.tlas.triIndices[i] < 0 || dyn.tlas.triIndices[i] >= static_cast<int>(objectCount)) {
+            Logger::error("Invalid TLAS tri index at " + std::to_string(i) + ": " + std::to_string(dyn.tlas.triIndices[i]));
         }
     }
 
+    if (!cacheHit) {
+        SceneCache::SectionData sections[SceneCache::SectionCount];
+        sections[SceneCache::Vertices] = {vertices, vertexCount * sizeof(glm::vec3)};
+        sections[SceneCache::TriangleCorners] = {corners, triangleCount * sizeof(glm::uvec3)};
+        sections[SceneCache::TriangleMaterials] = {triMaterials, triangleCount * sizeof(int)};
+        sections[SceneCache::BLASNodes] = {blasNodes, blasNodeCount * sizeof(BVHNode)};
+        sections[SceneCache::BLASTriIndices] = {blasTriIndices, blasTriIndexCount * sizeof(int)};
+        sections[SceneCache::MeshRanges] = {dyn.cachedBLAS.data(), dyn.cachedBLAS.size() * sizeof(DynamicSceneState::CachedRange)};
+        sections[SceneCache::TLASNodes] = {dyn.tlas.nodes.data(), dyn.tlas.nodes.size() * sizeof(BVHNode)};
+        sections[SceneCache::TLASTriIndices] = {dyn.tlas.triIndices.data(), dyn.tlas.triIndices.size() * sizeof(int)};
+        if (SceneCache::write(cachePath, cacheKey, transformHash, sections)) Logger::info("Saved scene cache " + cachePath);
+        else Logger::error("Failed to write scene cache " + cachePath);
+    }
+
     Logger::info("Initializing SSBOs for triangles, materials, lights, BVHs, and instances");
 
     auto logBufferUpload = [](const char* name, size_t bytes, auto uploadFunc) {
         auto start = std::chrono::high_resolution_clock::now();
         uploadFunc();
         auto end = std::chrono::high_resolution_clock::now();
+        Profiler::shared().record(std::string("upload/") + name, start, end);
         double ms = std::chrono::duration<double, std::milli>(end - start).count();
         Logger::info(std::string("SSBO upload: ") + name + ", size: " + std::to_string(bytes/1024) + " KB, time: " + std::to_string(ms) + " ms");
     };
 
-    logBufferUpload("Triangles", allTriangles.size() * sizeof(Triangle), [&]() {
+    logBufferUpload("Vertices", vertexCount * sizeof(glm::vec3), [&]() {
+        glGenBuffers(1, &vertexSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, vertexCount * sizeof(glm::vec3), vertices, GL_DYNAMIC_DRAW);
+        gSSBOCapacity[vertexSSBO] = vertexCount * sizeof(glm::vec3);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, vertexSSBO);
+    });
+    logBufferUpload("Triangles", triangleCount * sizeof(glm::uvec3), [&]() {
         glGenBuffers(1, &triangleSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, allTriangles.size() * sizeof(Triangle), allTriangles.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, triangleCount * sizeof(glm::uvec3), corners, GL_DYNAMIC_DRAW);
+        gSSBOCapacity[triangleSSBO] = triangleCount * sizeof(glm::uvec3);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triangleSSBO);
     });
+    logBufferUpload("Triangle Materials", triangleCount * sizeof(int), [&]() {
+        glGenBuffers(1, &triangleMaterialSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleMaterialSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, triangleCount * sizeof(int), triMaterials, GL_DYNAMIC_DRAW);
+        gSSBOCapacity[triangleMaterialSSBO] = triangleCount * sizeof(int);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, triangleMaterialSSBO);
+    });
+    size_t geometryBytes = vertexCount * sizeof(glm::vec3) + triangleCount * (sizeof(glm::uvec3) + sizeof(int));
+    size_t paddedTriangleBytes = triangleCount * 64; // three vec4-aligned corners plus material, as stored before
+    std::ostringstream geometryLog;
+    geometryLog << std::fixed << std::setprecision(2) << "SSBO upload: geometry " << geometryBytes / 1024 << " KB indexed ("
+        << vertexCount << " vertices, " << triangleCount << " triangles) vs " << paddedTriangleBytes / 1024 << " KB as padded triangles, "
+        << (geometryBytes > 0 ? static_cast<double>(paddedTriangleBytes) / geometryBytes : 0.0) << "x smaller";
+    Logger::info(geometryLog.str());
     logBufferUpload("Materials", scene.materials.size() * sizeof(Material), [&]() {
         glGenBuffers(1, &materialSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialSSBO);
@@ -1087,176 +1774,729 @@ void initializeSSBOs(const Scene& scene, bool forceRebuildBVH) {
         glBufferData(GL_SHADER_STORAGE_BUFFER, scene.lights.size() * sizeof(Light), scene.lights.data(), GL_STATIC_DRAW);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightSSBO);
     });
-    logBufferUpload("TLAS Nodes", tlasNodes.size() * sizeof(BVHNode), [&]() {
+    LightTable lightTable = LightTable::build(scene.lights);
+    const glm::ivec4 lightTableHeader(lightTable.pointLightCount, lightTable.directionalLightCount, 0, 0);
+    size_t lightTableBytes = sizeof(lightTableHeader) + lightTable.entries.size() * sizeof(LightAliasEntry);
+    logBufferUpload("Light Table", lightTableBytes, [&]() {
+        glGenBuffers(1, &lightTableSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightTableSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, lightTableBytes, nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(lightTableHeader), &lightTableHeader);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(lightTableHeader), lightTable.entries.size() * sizeof(LightAliasEntry), lightTable.entries.data());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightTableSSBO);
+    });
+    const std::vector<uint32_t>& sobolMatrices = SobolSampler::matrices();
+    logBufferUpload("Sobol Matrices", sobolMatrices.size() * sizeof(uint32_t), [&]() {
+        glGenBuffers(1, &sobolSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sobolSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sobolMatrices.size() * sizeof(uint32_t), sobolMatrices.data(), GL_STATIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, sobolSSBO);
+    });
+    logBufferUpload("TLAS Nodes", dyn.tlas.nodes.size() * sizeof(BVHNode), [&]() {
         glGenBuffers(1, &tlasNodeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, tlasNodeSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, tlasNodes.size() * sizeof(BVHNode), tlasNodes.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, dyn.tlas.nodes.size() * sizeof(BVHNode), dyn.tlas.nodes.data(), GL_DYNAMIC_DRAW);
+        gSSBOCapacity[tlasNodeSSBO] = dyn.tlas.nodes.size() * sizeof(BVHNode);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, tlasNodeSSBO);
     });
-    logBufferUpload("TLAS Tri Indices", tlasTriIndices.size() * sizeof(int), [&]() {
+    logBufferUpload("TLAS Tri Indices", dyn.tlas.triIndices.size() * sizeof(int), [&]() {
         glGenBuffers(1, &tlasTriIdxSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, tlasTriIdxSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, tlasTriIndices.size() * sizeof(int), tlasTriIndices.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, dyn.tlas.triIndices.size() * sizeof(int), dyn.tlas.triIndices.data(), GL_DYNAMIC_DRAW);
+        gSSBOCapacity[tlasTriIdxSSBO] = dyn.tlas.triIndices.size() * sizeof(int);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, tlasTriIdxSSBO);
     });
-    logBufferUpload("BLAS Nodes", allBLASNodes.size() * sizeof(BVHNode), [&]() {
+    logBufferUpload("BLAS Nodes", gpuBLASNodeBytes, [&]() {
         glGenBuffers(1, &blasNodeSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, blasNodeSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, allBLASNodes.size() * sizeof(BVHNode), allBLASNodes.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, gpuBLASNodeBytes, gpuBLASNodeData, GL_DYNAMIC_DRAW);
+        gSSBOCapacity[blasNodeSSBO] = gpuBLASNodeBytes;
+        // One buffer behind the binary (7), wide (10) and quantized wide (11) views
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, blasNodeSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, blasNodeSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, blasNodeSSBO);
     });
-    logBufferUpload("BLAS Tri Indices", allBLASTriIndices.size() * sizeof(int), [&]() {
+    logBufferUpload("BLAS Tri Indices", blasTriIndexCount * sizeof(int), [&]() {
         glGenBuffers(1, &blasTriIdxSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, blasTriIdxSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, allBLASTriIndices.size() * sizeof(int), allBLASTriIndices.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, blasTriIndexCount * sizeof(int), blasTriIndices, GL_DYNAMIC_DRAW);
+        gSSBOCapacity[blasTriIdxSSBO] = blasTriIndexCount * sizeof(int);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, blasTriIdxSSBO);
     });
-    logBufferUpload("BVH Instances", meshInstances.size() * sizeof(BVHInstance), [&]() {
+    logBufferUpload("BVH Instances", dyn.instances.size() * sizeof(BVHInstance), [&]() {
         glGenBuffers(1, &bvhInstanceSSBO);
         glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhInstanceSSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER, meshInstances.size() * sizeof(BVHInstance), meshInstances.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, dyn.instances.size() * sizeof(BVHInstance), dyn.instances.data(), GL_DYNAMIC_DRAW);
+        gSSBOCapacity[bvhInstanceSSBO] = dyn.instances.size() * sizeof(BVHInstance);
         glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, bvhInstanceSSBO);
     });
+    return stats;
+}
+
+// Lays out BLAS, triangle, instance and TLAS buffers from scratch after objects or meshes changed.
+// BLASes of meshes that stay in the scene are kept and refit instead of rebuilt.
+static void rebuildDynamicScene(const Scene& scene) {
+    DynamicSceneState& dyn = gDynamicScene;
+    std::unordered_map<const Mesh*, BVH> previousBLAS;
+    for (size_t m = 0; m < dyn.meshes.size(); ++m) previousBLAS.emplace(dyn.meshes[m], std::move(slotBLAS(dyn, m)));
+    dyn.cache.reset(); // cached ranges no longer match the new layout
+    SceneMeshTable meshTable = collectUniqueMeshes(scene);
+    size_t meshCount = meshTable.meshes.size();
+    dyn.meshes = meshTable.meshes;
+    dyn.objectSlot = meshTable.objectSlot;
+    dyn.meshBLAS.assign(meshCount, BVH());
+    dyn.meshLeafBlocks.assign(meshCount, BVHLeafBlocks());
+    dyn.meshNodeOffset.resize(meshCount);
+    dyn.meshNodeCount.resize(meshCount);
+    dyn.meshTriOffset.resize(meshCount);
+    dyn.meshGlobalTriOffset.resize(meshCount);
+    dyn.meshVertexOffset.resize(meshCount);
+    dyn.meshVertexCount.resize(meshCount);
+    std::vector<uint32_t> gpuBLASNodes;
+    std::vector<int> allBLASTriIndices;
+    std::vector<glm::vec3> allVertices;
+    std::vector<glm::uvec3> allCorners;
+    std::vector<int> allMaterials;
+    for (size_t m = 0; m < meshCount; ++m) {
+        const Mesh& mesh = *meshTable.meshes[m];
+        BVH& blas = dyn.meshBLAS[m];
+        auto previous = previousBLAS.find(meshTable.meshes[m]);
+        if (previous != previousBLAS.end()) {
+            blas = std::move(previous->second);
+            blas.refit(mesh);
+        } else {
+            configureBLAS(blas);
+            blas.buildBLAS(mesh);
+        }
+        dyn.meshNodeOffset[m] = static_cast<int>(gpuBLASNodes.size() / gpuNodeWords());
+        dyn.meshTriOffset[m] = static_cast<int>(allBLASTriIndices.size());
+        dyn.meshGlobalTriOffset[m] = static_cast<int>(allCorners.size());
+        dyn.meshVertexOffset[m] = static_cast<int>(allVertices.size());
+        dyn.meshVertexCount[m] = static_cast<int>(mesh.vertices.size());
+        dyn.meshNodeCount[m] = appendGPUNodes(blas, gpuBLASNodes);
+        allBLASTriIndices.insert(allBLASTriIndices.end(), blas.triIndices.begin(), blas.triIndices.end());
+        appendMeshGeometry(mesh, allVertices, allCorners, allMaterials);
+    }
+    dyn.objectMeshes.clear();
+    dyn.instances.clear();
+    dyn.localRoots.clear();
+    dyn.worldRoots.clear();
+    for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
+        const auto& obj = scene.gameObjects[i];
+        int slot = meshTable.objectSlot[i];
+        BVHInstance inst{};
+        inst.blasNodeOffset = dyn.meshNodeOffset[slot];
+        inst.blasTriOffset = dyn.meshTriOffset[slot];
+        inst.globalTriOffset = dyn.meshGlobalTriOffset[slot];
+        inst.meshIndex = slot;
+        inst.transform = obj.transform;
+        inst.inverseTransform = glm::inverse(obj.transform);
+        dyn.objectMeshes.push_back(obj.mesh.get());
+        dyn.instances.push_back(inst);
+        dyn.localRoots.push_back(dyn.meshBLAS[slot].nodes[0]);
+        dyn.worldRoots.push_back(transformRootNode(dyn.localRoots.back(), obj.transform));
+    }
+    configureTLAS(dyn.tlas);
+    dyn.tlas.buildTLAS(dyn.instances, dyn.worldRoots);
+    uploadSSBO(vertexSSBO, allVertices.data(), allVertices.size() * sizeof(glm::vec3));
+    uploadSSBO(triangleSSBO, allCorners.data(), allCorners.size() * sizeof(glm::uvec3));
+    uploadSSBO(triangleMaterialSSBO, allMaterials.data(), allMaterials.size() * sizeof(int));
+    uploadSSBO(blasNodeSSBO, gpuBLASNodes.data(), gpuBLASNodes.size() * sizeof(uint32_t));
+    uploadSSBO(blasTriIdxSSBO, allBLASTriIndices.data(), allBLASTriIndices.size() * sizeof(int));
+    uploadSSBO(bvhInstanceSSBO, dyn.instances.data(), dyn.instances.size() * sizeof(BVHInstance));
+    uploadSSBO(tlasNodeSSBO, dyn.tlas.nodes.data(), dyn.tlas.nodes.size() * sizeof(BVHNode));
+    uploadSSBO(tlasTriIdxSSBO, dyn.tlas.triIndices.data(), dyn.tlas.triIndices.size() * sizeof(int));
+    Logger::info("Rebuilt scene buffers: " + std::to_string(scene.gameObjects.size()) + " objects, " + std::to_string(meshCount) + " unique meshes");
 }
 
-// Dynamic BVH/SSBO update for game objects
+// Dynamic BVH/SSBO update for game objects. Only objects flagged transformDirty and meshes
+// flagged geometryDirty are looked at: deformed meshes get their BLAS refit and their ranges
+// re-uploaded, moved objects get their instance rewritten, and the TLAS is refit (or rebuilt
+// once refits degraded it past gTLASRebuildRatio). Only changed buffer ranges are uploaded.
 void updateDynamicBVHAndSSBOs(Scene& scene) {
-    // 1. Build BLAS for each unique mesh only once (unless geometry changes)
-    static std::vector<BVH> meshBLAS;
-    static std::vector<BVHNode> meshRootNodes;
-    static bool first = true;
-    if (first || meshBLAS.size() != scene.gameObjects.size()) {
-        meshBLAS.resize(scene.gameObjects.size());
-        meshRootNodes.resize(scene.gameObjects.size());
-        for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
-            meshBLAS[i].buildBLAS(scene.gameObjects[i].mesh->triangles);
-            meshRootNodes[i] = meshBLAS[i].nodes[0];
+    DynamicSceneState& dyn = gDynamicScene;
+    // 1. Added/removed objects or swapped meshes change the BLAS layout: rebuild everything
+    bool layoutChanged = dyn.objectMeshes.size() != scene.gameObjects.size();
+    for (size_t i = 0; !layoutChanged && i < scene.gameObjects.size(); ++i) {
+        layoutChanged = dyn.objectMeshes[i] != scene.gameObjects[i].mesh.get();
+    }
+    // 2. Refit the BLAS of deformed meshes in place; a changed node count needs a new layout
+    bool meshesDeformed = false;
+    for (size_t i = 0; !layoutChanged && i < scene.gameObjects.size(); ++i) {
+        Mesh& mesh = *scene.gameObjects[i].mesh;
+        if (!mesh.geometryDirty) continue;
+        mesh.geometryDirty = false;
+        int slot = dyn.objectSlot[i];
+        BVH& blas = slotBLAS(dyn, slot);
+        size_t triCount = blas.triIndices.size();
+        ProfileScope scope("bvh/blas refit");
+        bool rebuilt = blas.refit(mesh);
+        dyn.meshLeafBlocks[slot] = BVHLeafBlocks();
+        std::vector<uint32_t> gpuNodes;
+        if (appendGPUNodes(blas, gpuNodes) != dyn.meshNodeCount[slot] || blas.triIndices.size() != triCount ||
+            static_cast<int>(mesh.vertices.size()) != dyn.meshVertexCount[slot]) {
+            layoutChanged = true;
+            break;
         }
-        first = false;
+        // Deformation moves vertices; the index and material ranges stay as uploaded
+        uploadSSBORange(vertexSSBO, dyn.meshVertexOffset[slot], mesh.vertices.data(), mesh.vertices.size());
+        uploadSSBORange(blasNodeSSBO, dyn.meshNodeOffset[slot] * static_cast<int>(gpuNodeWords()), gpuNodes.data(), gpuNodes.size());
+        if (rebuilt) uploadSSBORange(blasTriIdxSSBO, dyn.meshTriOffset[slot], blas.triIndices.data(), blas.triIndices.size());
+        meshesDeformed = true;
     }
-    // 2. Build BVHInstances for all objects (with current transform)
-    std::vector<BVHInstance> meshInstances;
+    if (layoutChanged) {
+        rebuildDynamicScene(scene);
+        for (auto& obj : scene.gameObjects) {
+            obj.transformDirty = false;
+            obj.mesh->geometryDirty = false;
+        }
+        ++dyn.version;
+        return;
+    }
+    // 3. Pick up transform changes of dirty objects and root bounds of deformed meshes
+    int firstDirty = static_cast<int>(scene.gameObjects.size());
+    int lastDirty = -1;
+    bool boundsChanged = false;
     for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
-        BVHInstance inst;
-        // Compute node/tri/globalTri offsets for this mesh in the concatenated BLAS buffers
-        inst.blasNodeOffset = 0;
-        inst.blasTriOffset = 0;
-        inst.globalTriOffset = 0;
-        for (int j = 0; j < i; ++j) {
-            inst.blasNodeOffset += static_cast<int>(meshBLAS[j].nodes.size());
-            inst.blasTriOffset += static_cast<int>(meshBLAS[j].triIndices.size());
-            inst.globalTriOffset += static_cast<int>(scene.gameObjects[j].mesh->triangles.size());
+        GameObject& obj = scene.gameObjects[i];
+        BVHInstance& inst = dyn.instances[i];
+        bool moved = obj.transformDirty && inst.transform != obj.transform;
+        obj.transformDirty = false;
+        // Deformed slots were materialized by the refit above; the others may still live in the cache
+        const BVH& blas = dyn.meshBLAS[dyn.objectSlot[i]];
+        bool deformed = meshesDeformed && !blas.nodes.empty() && std::memcmp(&dyn.localRoots[i], &blas.nodes[0], sizeof(BVHNode)) != 0;
+        if (!moved && !deformed) continue;
+        if (moved) {
+            inst.transform = obj.transform;
+            inst.inverseTransform = glm::inverse(obj.transform);
+            firstDirty = std::min(firstDirty, static_cast<int>(i));
+            lastDirty = static_cast<int>(i);
         }
-        inst.transform = scene.gameObjects[i].transform;
-    inst.inverseTransform = glm::inverse(scene.gameObjects[i].transform);
-        inst.meshIndex = static_cast<int>(i);
-        meshInstances.push_back(inst);
+        if (deformed) dyn.localRoots[i] = blas.nodes[0];
+        dyn.worldRoots[i] = transformRootNode(dyn.localRoots[i], inst.transform);
+        boundsChanged = true;
     }
-    // 3. Flatten all BLAS nodes/indices for GPU
-    std::vector<BVHNode> allBLASNodes;
-    std::vector<int> allBLASTriIndices;
-    for (size_t i = 0; i < meshBLAS.size(); ++i) {
-        allBLASNodes.insert(allBLASNodes.end(), meshBLAS[i].nodes.begin(), meshBLAS[i].nodes.end());
-        allBLASTriIndices.insert(allBLASTriIndices.end(), meshBLAS[i].triIndices.begin(), meshBLAS[i].triIndices.end());
+    if (lastDirty >= 0) uploadSSBORange(bvhInstanceSSBO, firstDirty, dyn.instances.data() + firstDirty, lastDirty - firstDirty + 1);
+    if (meshesDeformed || lastDirty >= 0) ++dyn.version;
+    if (!boundsChanged) return; // nothing moved
+    // 4. Refit the TLAS; rebuild it when the refit tree got too much worse than a fresh build
+    int firstNode, lastNode;
+    {
+        ProfileScope scope("bvh/tlas refit");
+        dyn.tlas.refitTLAS(dyn.worldRoots, firstNode, lastNode);
     }
-    // 4. Combine all triangles (object space, not transformed)
-    std::vector<Triangle> allTriangles;
-    for (const auto& obj : scene.gameObjects) {
-        allTriangles.insert(allTriangles.end(), obj.mesh->triangles.begin(), obj.mesh->triangles.end());
+    if (dyn.tlas.sahCostRatio > dyn.tlas.rebuildCostRatio) {
+        float refitRatio = dyn.tlas.sahCostRatio;
+        ProfileScope scope("bvh/tlas build");
+        dyn.tlas.buildTLAS(dyn.instances, dyn.worldRoots);
+        Logger::debug("TLAS rebuilt after refits raised its SAH cost " + std::to_string(refitRatio) + "x");
+        uploadSSBO(tlasNodeSSBO, dyn.tlas.nodes.data(), dyn.tlas.nodes.size() * sizeof(BVHNode));
+        uploadSSBO(tlasTriIdxSSBO, dyn.tlas.triIndices.data(), dyn.tlas.triIndices.size() * sizeof(int));
+    } else if (firstNode <= lastNode) {
+        uploadSSBORange(tlasNodeSSBO, firstNode, dyn.tlas.nodes.data() + firstNode, lastNode - firstNode + 1);
     }
-    // 5. Rebuild TLAS every frame (since transforms may change)
-    std::vector<BVHNode> instanceRootNodes;
+}
+
+// Builds every unique mesh with the sweep, binned and parallel binned SAH builders and logs build time and tree quality
+void logBLASBuilderComparison(const Scene& scene) {
+    std::unordered_map<const Mesh*, size_t> seen;
     for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
-        // Transform mesh AABB by instance transform
-        const BVHNode& meshRoot = meshRootNodes[i];
-        glm::vec3 corners[8];
-        corners[0] = meshRoot.boundsMin;
-        corners[1] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
-        corners[2] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
-        corners[3] = glm::vec3(meshRoot.boundsMin.x, meshRoot.boundsMax.y, meshRoot.boundsMax.z);
-        corners[4] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMin.z);
-        corners[5] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMin.y, meshRoot.boundsMax.z);
-        corners[6] = glm::vec3(meshRoot.boundsMax.x, meshRoot.boundsMax.y, meshRoot.boundsMin.z);
-        corners[7] = meshRoot.boundsMax;
-        glm::vec3 bmin(1e30f), bmax(-1e30f);
-        for (int c = 0; c < 8; ++c) {
-            glm::vec3 tc = glm::vec3(scene.gameObjects[i].transform * glm::vec4(corners[c], 1.0f));
-            bmin = glm::min(bmin, tc);
-            bmax = glm::max(bmax, tc);
+        const Mesh* meshPtr = scene.gameObjects[i].mesh.get();
+        if (!meshPtr || !seen.emplace(meshPtr, i).second) continue;
+        auto timeBuild = [&](BVH& bvh, BVHSplitMethod method, bool parallel) {
+            bvh.splitMethod = method;
+            bvh.sahBinCount = gBLASBinCount;
+            bvh.parallelBuild = parallel;
+            auto start = std::chrono::high_resolution_clock::now();
+            bvh.buildBLAS(*meshPtr);
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        };
+        BVH sweep, binned, parallel;
+        double sweepMs = timeBuild(sweep, BVHSplitMethod::SAH, false);
+        double binnedMs = timeBuild(binned, BVHSplitMethod::BinnedSAH, false);
+        double parallelMs = timeBuild(parallel, BVHSplitMethod::BinnedSAH, true);
+        bool identical = parallel.triIndices == binned.triIndices && parallel.nodes.size() == binned.nodes.size() &&
+            std::memcmp(parallel.nodes.data(), binned.nodes.data(), binned.nodes.size() * sizeof(BVHNode)) == 0;
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(3)
+            << "BLAS builder compare [mesh" << i << ", " << meshPtr->triangleCount() << " tris]: "
+            << "sweep " << sweepMs << " ms (SAH cost " << sweep.computeSAHCost() << ", " << sweep.nodes.size() << " nodes), "
+            << "binned/" << gBLASBinCount << " " << binnedMs << " ms (SAH cost " << binned.computeSAHCost() << ", " << binned.nodes.size() << " nodes), "
+            << "speedup " << (binnedMs > 0.0 ? sweepMs / binnedMs : 0.0) << "x; "
+            << "parallel binned " << parallelMs << " ms on " << ThreadPool::shared().size() << " threads ("
+            << (identical ? "identical" : "MISMATCH") << ", speedup " << (parallelMs > 0.0 ? binnedMs / parallelMs : 0.0) << "x)";
+        if (identical) Logger::info(oss.str());
+        else Logger::error(oss.str());
+    }
+}
+
+// Builds the scene TLAS with the midpoint, sweep and binned builders and logs build time and tree quality
+void logTLASBuilderComparison(const Scene& scene) {
+    SceneMeshTable meshTable = collectUniqueMeshes(scene);
+    std::vector<BVHNode> meshBounds(meshTable.meshes.size());
+    for (size_t m = 0; m < meshTable.meshes.size(); ++m) {
+        BVHNode& root = meshBounds[m];
+        root.boundsMin = glm::vec3(1e30f);
+        root.boundsMax = glm::vec3(-1e30f);
+        const Mesh& mesh = *meshTable.meshes[m];
+        for (size_t t = 0; t < mesh.triangleCount(); ++t) {
+            root.boundsMin = glm::min(root.boundsMin, mesh.triangleMin(t));
+            root.boundsMax = glm::max(root.boundsMax, mesh.triangleMax(t));
         }
-        BVHNode instRoot = meshRoot;
-        instRoot.boundsMin = bmin;
-        instRoot.boundsMax = bmax;
-        instanceRootNodes.push_back(instRoot);
-    }
-    static BVH tlas;
-    //Logger::info("[updateDynamicBVHAndSSBOs] meshInstances size: " + std::to_string(meshInstances.size()) + ", instanceRootNodes size: " + std::to_string(instanceRootNodes.size()));
-    tlas.buildTLAS(meshInstances, instanceRootNodes);
-    // 6. Update SSBOs
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, triangleSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, allTriangles.size() * sizeof(Triangle), allTriangles.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, blasNodeSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, allBLASNodes.size() * sizeof(BVHNode), allBLASNodes.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, blasTriIdxSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, allBLASTriIndices.size() * sizeof(int), allBLASTriIndices.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhInstanceSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, meshInstances.size() * sizeof(BVHInstance), meshInstances.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tlasNodeSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, tlas.nodes.size() * sizeof(BVHNode), tlas.nodes.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tlasTriIdxSSBO);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, tlas.triIndices.size() * sizeof(int), tlas.triIndices.data());
+    }
+    std::vector<BVHInstance> instances(scene.gameObjects.size());
+    std::vector<BVHNode> worldRootNodes;
+    worldRootNodes.reserve(scene.gameObjects.size());
+    for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
+        worldRootNodes.push_back(transformRootNode(meshBounds[meshTable.objectSlot[i]], scene.gameObjects[i].transform));
+    }
+    auto timeBuild = [&](BVHSplitMethod method, int leafSize, BVH& tlas) {
+        configureTLAS(tlas);
+        tlas.tlasSplitMethod = method;
+        tlas.tlasMaxLeafSize = leafSize;
+        auto start = std::chrono::high_resolution_clock::now();
+        tlas.buildTLAS(instances, worldRootNodes);
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+    BVH midpoint, sweep, binned;
+    double midpointMs = timeBuild(BVHSplitMethod::Midpoint, 1, midpoint);
+    double sweepMs = timeBuild(BVHSplitMethod::SAH, gTLASMaxLeafSize, sweep);
+    double binnedMs = timeBuild(BVHSplitMethod::BinnedSAH, gTLASMaxLeafSize, binned);
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3)
+        << "TLAS builder compare [" << instances.size() << " instances, leaf <= " << gTLASMaxLeafSize << "]: "
+        << "midpoint " << midpointMs << " ms (SAH cost " << midpoint.computeSAHCost() << ", " << midpoint.nodes.size() << " nodes), "
+        << "sweep " << sweepMs << " ms (SAH cost " << sweep.computeSAHCost() << ", " << sweep.nodes.size() << " nodes), "
+        << "binned/" << gBLASBinCount << " " << binnedMs << " ms (SAH cost " << binned.computeSAHCost() << ", " << binned.nodes.size() << " nodes)";
+    Logger::info(oss.str());
 }
 
-void buildRasterMeshes(const Scene& scene) {
-    for (const auto& obj : scene.gameObjects) {
-        const Mesh* meshPtr = obj.mesh.get();
-        if (!meshPtr) continue;
-        if (gRasterMeshCache.find(meshPtr) != gRasterMeshCache.end()) continue;
-        if (meshPtr->triangles.empty()) continue;
-
-        std::vector<RasterVertex> vertices;
-        vertices.reserve(meshPtr->triangles.size() * 3);
-
-        for (const auto& tri : meshPtr->triangles) {
-            glm::vec3 p0 = tri.v0;
-            glm::vec3 p1 = tri.v1;
-            glm::vec3 p2 = tri.v2;
-            glm::vec3 normal = glm::normalize(glm::cross(p1 - p0, p2 - p0));
-            if (!std::isfinite(normal.x) || !std::isfinite(normal.y) || !std::isfinite(normal.z) || glm::length(normal) < 1e-5f) {
-                normal = glm::vec3(0.0f, 1.0f, 0.0f);
+// Flattens the scene into the shader's buffer layout for the CPU renderer. BLASes stay binary;
+// the wide node formats only exist on upload.
+static CPUScene buildCPUScene(const Scene& scene) {
+    SceneMeshTable meshTable = collectUniqueMeshes(scene);
+    size_t meshCount = meshTable.meshes.size();
+    std::vector<BVH> blases(meshCount);
+    ThreadPool& pool = ThreadPool::shared();
+    ThreadPool::TaskGroup blasGroup;
+    for (size_t m = 0; m < meshCount; ++m) {
+        configureBLAS(blases[m]);
+        pool.run(blasGroup, [&, m]() { blases[m].buildBLAS(*meshTable.meshes[m]); });
+    }
+    pool.wait(blasGroup);
+
+    CPUScene cpu;
+    std::vector<int> nodeOffset(meshCount), triOffset(meshCount), globalTriOffset(meshCount);
+    for (size_t m = 0; m < meshCount; ++m) {
+        nodeOffset[m] = static_cast<int>(cpu.blasNodes.size());
+        triOffset[m] = static_cast<int>(cpu.blasTriIndices.size());
+        globalTriOffset[m] = static_cast<int>(cpu.corners.size());
+        cpu.blasNodes.insert(cpu.blasNodes.end(), blases[m].nodes.begin(), blases[m].nodes.end());
+        cpu.blasTriIndices.insert(cpu.blasTriIndices.end(), blases[m].triIndices.begin(), blases[m].triIndices.end());
+        cpu.blasLeafBlocks.append(blases[m], *meshTable.meshes[m]);
+        appendMeshGeometry(*meshTable.meshes[m], cpu.vertices, cpu.corners, cpu.triangleMaterials);
+    }
+    std::vector<BVHNode> worldRoots;
+    for (size_t i = 0; i < scene.gameObjects.size(); ++i) {
+        int slot = meshTable.objectSlot[i];
+        if (blases[slot].nodes.empty()) continue;
+        BVHInstance inst{};
+        inst.blasNodeOffset = nodeOffset[slot];
+        inst.blasTriOffset = triOffset[slot];
+        inst.globalTriOffset = globalTriOffset[slot];
+        inst.meshIndex = slot;
+        inst.transform = scene.gameObjects[i].transform;
+        inst.inverseTransform = glm::inverse(inst.transform);
+        cpu.instances.push_back(inst);
+        worldRoots.push_back(transformRootNode(blases[slot].nodes[0], inst.transform));
+    }
+    if (!cpu.instances.empty()) {
+        BVH tlas;
+        configureTLAS(tlas);
+        tlas.buildTLAS(cpu.instances, worldRoots);
+        cpu.tlasNodes = std::move(tlas.nodes);
+        cpu.tlasIndices = std::move(tlas.triIndices);
+    }
+    cpu.materials = scene.materials;
+    cpu.lights = scene.lights;
+    cpu.lightTable = LightTable::build(scene.lights);
+    return cpu;
+}
+
+// Single-threaded CPU ray kernel throughput per unique mesh, in object space: coherent primary
+// rays from a pinhole in front of the mesh, then incoherent cosine-distributed bounce rays from
+// their hits. Every variant must report the same hits as the scalar kernel.
+void logRayKernelBenchmark(const Scene& scene) {
+    const int kImageSize = 512;
+    SceneMeshTable meshTable = collectUniqueMeshes(scene);
+    for (size_t m = 0; m < meshTable.meshes.size(); ++m) {
+        const Mesh& mesh = *meshTable.meshes[m];
+        if (mesh.triangleCount() == 0) continue;
+        BVH bvh;
+        configureBLAS(bvh);
+        bvh.buildBLAS(mesh);
+        BVHLeafBlocks leaves;
+        leaves.append(bvh, mesh);
+        const BVHNode& root = bvh.nodes[0];
+        glm::vec3 center = (root.boundsMin + root.boundsMax) * 0.5f;
+        float radius = glm::length(root.boundsMax - root.boundsMin) * 0.5f;
+        glm::vec3 eye = center + glm::vec3(0.0f, 0.0f, 2.5f * radius);
+
+        // Rays are stored in 4x2 pixel groups, so any 4 or 8 consecutive rays form a coherent packet
+        std::vector<glm::vec3> origins, dirs;
+        for (int by = 0; by < kImageSize; by += 2) {
+            for (int bx = 0; bx < kImageSize; bx += 4) {
+                for (int i = 0; i < 8; ++i) {
+                    float px = ((bx + i % 4) + 0.5f) / kImageSize * 2.0f - 1.0f;
+                    float py = ((by + i / 4) + 0.5f) / kImageSize * 2.0f - 1.0f;
+                    origins.push_back(eye);
+                    dirs.push_back(glm::normalize(center + glm::vec3(px * radius, py * radius, 0.0f) - eye));
+                }
             }
+        }
 
-            RasterVertex v0{p0, normal, tri.materialIndex};
-            RasterVertex v1{p1, normal, tri.materialIndex};
-            RasterVertex v2{p2, normal, tri.materialIndex};
-            vertices.push_back(v0);
-            vertices.push_back(v1);
-            vertices.push_back(v2);
+        auto timeMs = [](auto&& fn) {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        };
+        auto runRays = [&](bool simdLeaves, std::vector<int>& hits, std::vector<float>* hitT) {
+            hits.resize(origins.size());
+            if (hitT) hitT->resize(origins.size());
+            for (size_t r = 0; r < origins.size(); ++r) {
+                float t = 1e30f;
+                hits[r] = RayKernels::traverseRay(bvh.nodes.data(), leaves, 0, origins[r], dirs[r], t, simdLeaves);
+                if (hitT) (*hitT)[r] = t;
+            }
+        };
+        auto runPackets = [&](auto& packet, int width, std::vector<int>& hits) {
+            hits.assign(origins.size(), -1);
+            for (size_t r = 0; r + width <= origins.size(); r += width) {
+                for (int i = 0; i < width; ++i) packet.set(i, origins[r + i], dirs[r + i]);
+                RayKernels::traversePacket(bvh.nodes.data(), leaves, 0, packet);
+                for (int i = 0; i < width; ++i) hits[r + i] = packet.hitTri[i];
+            }
+        };
+        auto benchmarkRays = [&](const char* label, std::vector<float>* hitT) {
+            std::vector<int> reference, hits;
+            RayPacket<4> packet4;
+            RayPacket<8> packet8;
+            size_t mismatches = 0;
+            auto countMismatches = [&]() {
+                for (size_t r = 0; r < reference.size(); ++r) mismatches += hits[r] != reference[r];
+            };
+            double scalarMs = timeMs([&]() { runRays(false, reference, hitT); });
+            double leafMs = timeMs([&]() { runRays(true, hits, nullptr); });
+            countMismatches();
+            double packet4Ms = timeMs([&]() { runPackets(packet4, 4, hits); });
+            countMismatches();
+            double packet8Ms = timeMs([&]() { runPackets(packet8, 8, hits); });
+            countMismatches();
+            size_t hitCount = reference.size() - std::count(reference.begin(), reference.end(), -1);
+            auto mrays = [&](double ms) { return ms > 0.0 ? origins.size() / (ms * 1000.0) : 0.0; };
+            auto speedup = [&](double ms) { return ms > 0.0 ? scalarMs / ms : 0.0; };
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(2)
+                << "Ray kernels [mesh" << m << ", " << mesh.triangleCount() << " tris, " << RayKernels::simdLevel() << "] "
+                << label << " " << origins.size() << " rays (" << hitCount << " hit): scalar " << mrays(scalarMs) << " Mrays/s, "
+                << "leaf4 " << mrays(leafMs) << " Mrays/s (" << speedup(leafMs) << "x), "
+                << "packet4 " << mrays(packet4Ms) << " Mrays/s (" << speedup(packet4Ms) << "x), "
+                << "packet8 " << mrays(packet8Ms) << " Mrays/s (" << speedup(packet8Ms) << "x), "
+                << "mismatched hits " << mismatches;
+            if (mismatches == 0) Logger::info(oss.str());
+            else Logger::error(oss.str());
+            return reference;
+        };
+
+        std::vector<float> primaryT;
+        std::vector<int> primaryHits = benchmarkRays("primary", &primaryT);
+
+        // Bounce rays leave each primary hit in a cosine-weighted direction from a fixed seed
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<glm::vec3> bounceOrigins, bounceDirs;
+        for (size_t r = 0; r < primaryHits.size(); ++r) {
+            int tri = primaryHits[r];
+            if (tri < 0) continue;
+            glm::vec3 v0 = mesh.corner(tri, 0);
+            glm::vec3 n = glm::normalize(glm::cross(mesh.corner(tri, 1) - v0, mesh.corner(tri, 2) - v0));
+            if (glm::dot(n, dirs[r]) > 0.0f) n = -n;
+            float u = uniform(rng), v = uniform(rng);
+            float sinTheta = std::sqrt(u), cosTheta = std::sqrt(1.0f - u), phi = 6.2831853f * v;
+            glm::vec3 up = std::abs(n.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+            glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+            glm::vec3 bitangent = glm::cross(n, tangent);
+            bounceOrigins.push_back(origins[r] + dirs[r] * primaryT[r] + n * 0.001f);
+            bounceDirs.push_back(glm::normalize(tangent * (sinTheta * std::cos(phi)) + bitangent * (sinTheta * std::sin(phi)) + n * cosTheta));
         }
+        if (bounceOrigins.empty()) continue;
+        origins.swap(bounceOrigins);
+        dirs.swap(bounceDirs);
+        benchmarkRays("bounce", nullptr);
+    }
+}
+
+int runCPUReferenceRender(const Scene& scene, const std::string& outputPath, const CPURenderSettings& settings) {
+    auto buildStart = std::chrono::high_resolution_clock::now();
+    CPUScene cpuScene = buildCPUScene(scene);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+    Logger::info("CPU render: scene flattened in " + std::to_string(buildMs) + " ms (" + std::to_string(cpuScene.corners.size()) + " triangles, " +
+        std::to_string(cpuScene.instances.size()) + " instances)");
+
+    // Same camera, with the aspect ratio of the output image
+    Camera camera = scene.camera;
+    camera.aspectRatio = float(settings.width) / float(settings.height);
+    camera.updateProjectionMatrix();
+    std::vector<glm::vec3> image;
+    CPURenderer renderer(cpuScene);
+    CPURenderStats stats = renderer.render(camera, settings, image);
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3) << "CPU render: " << settings.width << "x" << settings.height << ", " << settings.samplesPerPixel << " spp, "
+        << stats.tiles << " tiles on " << stats.threads << " threads in " << stats.ms << " ms; " << stats.rays << " rays, "
+        << stats.mraysPerSecond() << " Mrays/s";
+    Logger::info(oss.str());
+    if (!ImageIO::write(outputPath, settings.width, settings.height, image)) {
+        Logger::error("Failed to write CPU render to " + outputPath);
+        return -1;
+    }
+    Logger::info("CPU render written to " + outputPath);
+    return 0;
+}
+
+// Renders settings.frames path-traced frames into an RGBA32F FBO on an offscreen context, then
+// writes the last frame and the per-frame timings. Every frame uses the full bounce budget and
+// is finished with glFinish, so render times cover the GPU work.
+int runHeadlessRender(Scene& scene, const HeadlessSettings& settings, bool forceRebuildBVH) {
+    HeadlessContext context;
+    if (!context.create()) {
+        return -1;
+    }
+    glewExperimental = GL_TRUE;
+    GLenum glewStatus = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX also probes for a GLX display, which an EGL context does not have
+    if (glewStatus == GLEW_ERROR_NO_GLX_DISPLAY) glewStatus = GLEW_OK;
+#endif
+    if (glewStatus != GLEW_OK) {
+        Logger::error("Failed to initialize GLEW");
+        return -1;
+    }
+    auto glString = [](GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? std::string(reinterpret_cast<const char*>(value)) : std::string("unknown");
+    };
+    std::string glVersion = glString(GL_VERSION), glRenderer = glString(GL_RENDERER);
+    Logger::info("GL version: " + glVersion + " (" + glRenderer + ")");
+
+    SCR_WIDTH = static_cast<unsigned int>(settings.width);
+    SCR_HEIGHT = static_cast<unsigned int>(settings.height);
+    bool fromCache = false;
+    auto compileStart = std::chrono::high_resolution_clock::now();
+    // Offscreen captures hide the overlays, so they run the variant without them
+    PathTracerVariant variant = pathTracerVariantFor(scene, false, false);
+    adoptPathTracerProgram(variant, loadPathTracer(variant, &fromCache));
+    Logger::info("Path tracer shader compile/link time: " +
+                 std::to_string(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - compileStart).count()) + " ms" +
+                 (fromCache ? " (program binary cache hit)" : ""));
+    if (shaderProgram == 0) {
+        Logger::error("Headless: path tracer shader failed to compile");
+        return -1;
+    }
+    setupQuad(quadVAO, quadVBO);
+    initializeSSBOs(scene, forceRebuildBVH);
+    if (gWavefront && !gWavefrontTracer.create(loadWavefrontKernel)) {
+        Logger::error("Headless: wavefront kernels failed to compile");
+        return -1;
+    }
+
+    GLuint colorTexture = 0, framebuffer = 0;
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, settings.width, settings.height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        Logger::error("Headless: offscreen framebuffer is incomplete");
+        return -1;
+    }
+    glViewport(0, 0, settings.width, settings.height);
+
+    // glReadPixels returns the bottom row first
+    auto readImage = [&]() {
+        std::vector<float> pixels(static_cast<size_t>(settings.width) * settings.height * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, settings.width, settings.height, GL_RGBA, GL_FLOAT, pixels.data());
+        std::vector<glm::vec3> image(static_cast<size_t>(settings.width) * settings.height);
+        for (int y = 0; y < settings.height; ++y) {
+            const float* row = pixels.data() + static_cast<size_t>(settings.height - 1 - y) * settings.width * 4;
+            for (int x = 0; x < settings.width; ++x) {
+                image[static_cast<size_t>(y) * settings.width + x] = glm::vec3(row[x * 4], row[x * 4 + 1], row[x * 4 + 2]);
+            }
+        }
+        return image;
+    };
+
+    // Convergence against the reference: RMSE at every power-of-two sample count, outside the frame timings
+    std::vector<glm::vec3> reference;
+    if (!settings.referencePath.empty()) {
+        int referenceWidth = 0, referenceHeight = 0;
+        if (!ImageIO::readPFM(settings.referencePath, referenceWidth, referenceHeight, reference) ||
+            referenceWidth != settings.width || referenceHeight != settings.height) {
+            Logger::error("Headless: " + settings.referencePath + " is not a " + std::to_string(settings.width) + "x" +
+                          std::to_string(settings.height) + " PFM; skipping RMSE");
+            reference.clear();
+        }
+    }
+    struct ConvergencePoint {
+        int spp;
+        double rmse;
+    };
+    std::vector<ConvergencePoint> convergence;
 
-        if (vertices.empty()) continue;
+    struct FrameTiming {
+        double totalMs, bvhMs, sendMs, renderMs;
+    };
+    std::vector<FrameTiming> timings;
+    const Camera startCamera = scene.camera;
+    Profiler& profiler = Profiler::shared();
+    for (int frame = 0; frame < settings.frames; ++frame) {
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        profiler.collectGPU();
+        float angle = settings.orbitDegrees * float(frame) / float(settings.frames);
+        glm::mat4 orbit = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+        scene.camera.position = glm::vec3(orbit * glm::vec4(startCamera.position, 1.0f));
+        scene.camera.target = glm::vec3(orbit * glm::vec4(startCamera.target, 0.0f));
+        scene.camera.up = glm::vec3(orbit * glm::vec4(startCamera.up, 0.0f));
+        scene.camera.aspectRatio = float(settings.width) / float(settings.height);
+        scene.camera.updateViewMatrix();
+        scene.camera.updateProjectionMatrix();
+        updateDynamicBVHAndSSBOs(scene);
+        auto afterBVH = std::chrono::high_resolution_clock::now();
 
-        RasterMeshGPU gpu;
-        glGenVertexArrays(1, &gpu.vao);
-        glGenBuffers(1, &gpu.vbo);
-        glBindVertexArray(gpu.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(RasterVertex), vertices.data(), GL_STATIC_DRAW);
+        sendSceneDataToShader(shaderProgram, scene, kMaxBounceBudget);
+        prepareAccumulation(shaderProgram, scene, kMaxBounceBudget);
+        if (gWavefront) traceWavefrontSample(kMaxBounceBudget);
+        glUniform1i(pathTracerUniforms(shaderProgram).hideOverlay, 1);
+        auto afterSend = std::chrono::high_resolution_clock::now();
 
-        GLsizei stride = sizeof(RasterVertex);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(RasterVertex, position)));
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(offsetof(RasterVertex, normal)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribIPointer(2, 1, GL_INT, stride, reinterpret_cast<void*>(offsetof(RasterVertex, materialIndex)));
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindVertexArray(quadVAO);
+        profiler.beginGPU("gpu/path tracer");
+        glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        finishAccumulation();
+        profiler.endGPU();
+        glFinish();
+        auto frameEnd = std::chrono::high_resolution_clock::now();
+        profiler.record("frame/bvh", frameStart, afterBVH);
+        profiler.record("frame/send", afterBVH, afterSend);
+        profiler.record("frame/render", afterSend, frameEnd);
+        profiler.record("frame/total", frameStart, frameEnd);
+        timings.push_back({std::chrono::duration<double, std::milli>(frameEnd - frameStart).count(),
+            std::chrono::duration<double, std::milli>(afterBVH - frameStart).count(),
+            std::chrono::duration<double, std::milli>(afterSend - afterBVH).count(),
+            std::chrono::duration<double, std::milli>(frameEnd - afterSend).count()});
+        Logger::debug("Headless frame " + std::to_string(frame) + ": " + std::to_string(timings.back().totalMs) + " ms");
+
+        int spp = gAccumulation.samples;
+        if (!reference.empty() && spp > 0 && (spp & (spp - 1)) == 0 && (convergence.empty() || convergence.back().spp != spp)) {
+            convergence.push_back({spp, ImageIO::rmse(readImage(), reference)});
+            Logger::info("Headless: RMSE " + std::to_string(convergence.back().rmse) + " at " + std::to_string(spp) + " spp");
+        }
+    }
+    glBindVertexArray(0);
 
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // Steady-state statistics leave out the first frame, which pays for shader and pipeline warm-up
+    std::vector<double> steadyMs;
+    for (size_t i = timings.size() > 1 ? 1 : 0; i < timings.size(); ++i) steadyMs.push_back(timings[i].totalMs);
+    std::sort(steadyMs.begin(), steadyMs.end());
+    double meanMs = 0.0;
+    for (double ms : steadyMs) meanMs += ms;
+    meanMs /= double(steadyMs.size());
+    double medianMs = steadyMs[steadyMs.size() / 2];
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3) << "Headless: " << settings.frames << " frames at " << settings.width << "x" << settings.height
+        << ", first " << timings.front().totalMs << " ms, then mean " << meanMs << " ms, median " << medianMs << " ms, min " << steadyMs.front()
+        << " ms, max " << steadyMs.back() << " ms; " << gAccumulation.samples << " spp accumulated";
+    Logger::info(summary.str());
+
+    std::vector<glm::vec3> image = readImage();
+    double finalRmse = reference.empty() ? 0.0 : ImageIO::rmse(image, reference);
+    if (!reference.empty()) {
+        Logger::info("Headless: last frame RMSE " + std::to_string(finalRmse) + " against " + settings.referencePath);
+    }
+    int status = 0;
+    if (ImageIO::write(settings.imagePath, settings.width, settings.height, image)) {
+        Logger::info("Headless: last frame written to " + settings.imagePath);
+    } else {
+        Logger::error("Headless: failed to write " + settings.imagePath);
+        status = -1;
+    }
 
-        gpu.vertexCount = static_cast<GLsizei>(vertices.size());
-        gRasterMeshCache[meshPtr] = gpu;
+    if (!settings.timingsPath.empty()) {
+        std::ofstream json(settings.timingsPath, std::ios::trunc);
+        json << std::fixed << std::setprecision(4);
+        json << "{\n  \"renderer\": " << jsonString(glRenderer) << ",\n  \"glVersion\": " << jsonString(glVersion) << ",\n"
+             << "  \"width\": " << settings.width << ",\n  \"height\": " << settings.height << ",\n"
+             << "  \"frames\": " << settings.frames << ",\n  \"orbitDegrees\": " << settings.orbitDegrees << ",\n"
+             << "  \"blasNodeWidth\": " << gBLASNodeWidth << ",\n  \"blasNodeQuantized\": " << (gBLASNodeQuantized ? "true" : "false") << ",\n"
+             << "  \"summary\": {\"firstFrameMs\": " << timings.front().totalMs << ", \"meanMs\": " << meanMs << ", \"medianMs\": " << medianMs
+             << ", \"minMs\": " << steadyMs.front() << ", \"maxMs\": " << steadyMs.back() << ", \"accumulatedSpp\": " << gAccumulation.samples;
+        if (!reference.empty()) json << ", \"rmse\": " << std::setprecision(6) << finalRmse << std::setprecision(4);
+        json << "},\n";
+        if (!reference.empty()) {
+            json << "  \"convergence\": [" << std::setprecision(6);
+            for (size_t i = 0; i < convergence.size(); ++i) {
+                json << (i ? ", " : "") << "{\"spp\": " << convergence[i].spp << ", \"rmse\": " << convergence[i].rmse << "}";
+            }
+            json << "],\n" << std::setprecision(4);
+        }
+        json << "  \"frameTimings\": [\n";
+        for (size_t i = 0; i < timings.size(); ++i) {
+            const FrameTiming& t = timings[i];
+            json << "    {\"frame\": " << i << ", \"totalMs\": " << t.totalMs << ", \"bvhMs\": " << t.bvhMs << ", \"sendMs\": " << t.sendMs
+                 << ", \"renderMs\": " << t.renderMs << "}" << (i + 1 < timings.size() ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+        if (json.good()) {
+            Logger::info("Headless: frame timings written to " + settings.timingsPath);
+        } else {
+            Logger::error("Headless: failed to write " + settings.timingsPath);
+            status = -1;
+        }
     }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &colorTexture);
+    gWavefrontTracer.destroy();
+    gFrameConstants.destroy();
+    finishProfiling();
+    glDeleteTextures(1, &gAccumulation.texture);
+    gAccumulation.texture = 0;
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &quadVBO);
+    glDeleteProgram(shaderProgram);
+    return status;
+}
+
+// Sets up the raster VAO over the path tracer's vertex and triangle buffers. Indices are
+// global, so each object is one glDrawElements over its mesh's triangle range.
+void buildRasterMeshes() {
+    if (gRasterVAO != 0) return;
+    glGenVertexArrays(1, &gRasterVAO);
+    glBindVertexArray(gRasterVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexSSBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), reinterpret_cast<void*>(0));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangleSSBO);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void sendRasterSceneData(GLuint shaderProgram, const Scene& scene) {
@@ -1277,19 +2517,23 @@ void renderRasterized(const Scene& scene) {
     glUseProgram(rasterShaderProgram);
     sendRasterSceneData(rasterShaderProgram, scene);
 
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triangleSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, materialSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, vertexSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, triangleMaterialSSBO);
 
     GLint modelLoc = glGetUniformLocation(rasterShaderProgram, "uModel");
     GLint normalLoc = glGetUniformLocation(rasterShaderProgram, "uNormalMatrix");
+    GLint triOffsetLoc = glGetUniformLocation(rasterShaderProgram, "uTriangleOffset");
 
-    for (const auto& obj : scene.gameObjects) {
-        const Mesh* meshPtr = obj.mesh.get();
-        auto it = gRasterMeshCache.find(meshPtr);
-        if (it == gRasterMeshCache.end()) continue;
-
-        const RasterMeshGPU& gpu = it->second;
-        if (gpu.vertexCount == 0) continue;
+    const DynamicSceneState& dyn = gDynamicScene;
+    glBindVertexArray(gRasterVAO);
+    for (size_t i = 0; i < scene.gameObjects.size() && i < dyn.objectSlot.size(); ++i) {
+        const GameObject& obj = scene.gameObjects[i];
+        int slot = dyn.objectSlot[i];
+        GLsizei triCount = static_cast<GLsizei>(dyn.meshes[slot]->triangleCount());
+        if (triCount == 0) continue;
 
         glm::mat4 model = obj.transform;
         glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
@@ -1301,8 +2545,12 @@ void renderRasterized(const Scene& scene) {
             glUniformMatrix3fv(normalLoc, 1, GL_FALSE, glm::value_ptr(normalMatrix));
         }
 
-        glBindVertexArray(gpu.vao);
-        glDrawArrays(GL_TRIANGLES, 0, gpu.vertexCount);
+        if (triOffsetLoc >= 0) {
+            glUniform1i(triOffsetLoc, dyn.meshGlobalTriOffset[slot]);
+        }
+
+        glDrawElements(GL_TRIANGLES, triCount * 3, GL_UNSIGNED_INT,
+            reinterpret_cast<void*>(static_cast<size_t>(dyn.meshGlobalTriOffset[slot]) * sizeof(glm::uvec3)));
     }
 
     glBindVertexArray(0);
@@ -1310,15 +2558,10 @@ void renderRasterized(const Scene& scene) {
 }
 
 void cleanupRasterMeshes() {
-    for (auto& kv : gRasterMeshCache) {
-        if (kv.second.vbo != 0) {
-            glDeleteBuffers(1, &kv.second.vbo);
-        }
-        if (kv.second.vao != 0) {
-            glDeleteVertexArrays(1, &kv.second.vao);
-        }
+    if (gRasterVAO != 0) {
+        glDeleteVertexArrays(1, &gRasterVAO);
+        gRasterVAO = 0;
     }
-    gRasterMeshCache.clear();
 }
 
 void runPathTracerWarmup(GLFWwindow* window, Scene& scene, int warmupFrames) {
@@ -1329,18 +2572,9 @@ void runPathTracerWarmup(GLFWwindow* window, Scene& scene, int warmupFrames) {
     glfwHideWindow(window);
     glfwSwapInterval(0);
     for (int i = 0; i < warmupFrames; ++i) {
-        int bounceBudget = (i == 0) ? 1 : 5;
+        int bounceBudget = (i == 0) ? 1 : kMaxBounceBudget;
         sendSceneDataToShader(shaderProgram, scene, bounceBudget);
-        GLint debugLoc = glGetUniformLocation(shaderProgram, "debugShowLights");
-        glUniform1i(debugLoc, debugShowLights ? 1 : 0);
-        GLint bvhLoc = glGetUniformLocation(shaderProgram, "debugShowBVH");
-        glUniform1i(bvhLoc, debugShowBVH ? 1 : 0);
-        GLint modeLoc = glGetUniformLocation(shaderProgram, "debugBVHMode");
-        glUniform1i(modeLoc, debugBVHMode);
-        GLint selBLASLoc = glGetUniformLocation(shaderProgram, "debugSelectedBLAS");
-        glUniform1i(selBLASLoc, debugSelectedBLAS);
-        GLint selTriLoc = glGetUniformLocation(shaderProgram, "debugSelectedTri");
-        glUniform1i(selTriLoc, debugSelectedTri);
+        sendDebugUniforms(shaderProgram);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glBindVertexArray(quadVAO);
         glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
@@ -1353,42 +2587,132 @@ void runPathTracerWarmup(GLFWwindow* window, Scene& scene, int warmupFrames) {
     Logger::info("Warm-up complete; first on-screen frame should reuse the cached pipeline");
 }
 
-void sendSceneDataToShader(GLuint shaderProgram, const Scene& scene, int bounceBudget) {
+// Binds the accumulation image and sets the accumulation uniforms for the next path-traced frame.
+// The mean restarts when the camera, the uploaded scene, the resolution or the bounce budget
+// changed; once it holds targetSamples, frames only display it instead of tracing. The wavefront
+// tracer resolves into the image even without accumulation, then every frame is sample 0.
+void prepareAccumulation(GLuint shaderProgram, const Scene& scene, int bounceBudget) {
+    AccumulationState& acc = gAccumulation;
+    const PathTracerUniforms& uniforms = pathTracerUniforms(shaderProgram);
+    glUniform1i(uniforms.accumulate, acc.enabled ? 1 : 0);
+    if (!acc.enabled && !gWavefront) {
+        glUniform1i(uniforms.sampleIndex, 0);
+        glUniform1i(uniforms.displayAccumulated, 0);
+        return;
+    }
+    int width = static_cast<int>(SCR_WIDTH), height = static_cast<int>(SCR_HEIGHT);
+    if (acc.texture == 0 || acc.width != width || acc.height != height) {
+        if (acc.texture == 0) glGenTextures(1, &acc.texture);
+        glBindTexture(GL_TEXTURE_2D, acc.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        acc.width = width;
+        acc.height = height;
+        acc.samples = 0;
+    }
+    glm::mat4 viewProjection = scene.camera.projectionMatrix * scene.camera.viewMatrix;
+    if (viewProjection != acc.viewProjection || gDynamicScene.version != acc.sceneVersion || bounceBudget != acc.bounceBudget) {
+        acc.viewProjection = viewProjection;
+        acc.sceneVersion = gDynamicScene.version;
+        acc.bounceBudget = bounceBudget;
+        acc.samples = 0;
+    }
+    if (acc.samples == 0) acc.start = std::chrono::high_resolution_clock::now();
+    bool converged = acc.targetSamples > 0 && acc.samples >= acc.targetSamples;
+    glBindImageTexture(0, acc.texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glUniform1i(uniforms.sampleIndex, acc.samples);
+    glUniform1i(uniforms.displayAccumulated, converged ? 1 : 0);
+}
+
+// Call after prepareAccumulation in --wavefront mode: traces the frame's sample with the compute
+// kernels, then sets up shaderProgram to only present the accumulation image with the overlays
+void traceWavefrontSample(int bounceBudget) {
+    AccumulationState& acc = gAccumulation;
+    bool converged = acc.targetSamples > 0 && acc.samples >= acc.targetSamples;
+    if (!converged) {
+        // A rebuilt BLAS may be deeper than the kernels' traversal stack; the megakernel gets a new variant
+        if (gWavefrontBLASStackSize < blasStackSizeBucket() && !gWavefrontTracer.create(loadWavefrontKernel)) {
+            Logger::error("Wavefront: failed to rebuild the kernels for a deeper BLAS; using the fragment shader path tracer");
+            gWavefront = false;
+        }
+        int maxBounces = std::min(bounceBudget > 0 ? bounceBudget : 5, kMaxBounceBudget);
+        GPUProfileScope gpuScope("gpu/wavefront");
+        gWavefrontTracer.render(acc.width, acc.height, maxBounces, acc.samples, acc.texture);
+    }
     glUseProgram(shaderProgram);
-    
-    // Send resolution uniform
-    glUniform2f(glGetUniformLocation(shaderProgram, "resolution"), float(SCR_WIDTH), float(SCR_HEIGHT));
-    
-    // Send camera data
-    glm::mat4 invViewMatrix = glm::inverse(scene.camera.viewMatrix);
-    glm::mat4 invProjMatrix = glm::inverse(scene.camera.projectionMatrix);
+    glBindImageTexture(0, acc.texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glUniform1i(pathTracerUniforms(shaderProgram).accumulate, 1);
+    glUniform1i(pathTracerUniforms(shaderProgram).displayAccumulated, 1);
+}
 
-    // Send the number of triangles
-    int totalTriangles = 0;
-    for (const auto& obj : scene.gameObjects) {
-        totalTriangles += obj.mesh->triangles.size();
+// Sets the debug overlay uniforms, which live outside FrameConstants
+void sendDebugUniforms(GLuint shaderProgram) {
+    const PathTracerUniforms& uniforms = pathTracerUniforms(shaderProgram);
+    glUniform1i(uniforms.debugShowLights, debugShowLights ? 1 : 0);
+    glUniform1i(uniforms.debugShowBVH, debugShowBVH ? 1 : 0);
+    glUniform1i(uniforms.debugBVHMode, debugBVHMode);
+    glUniform1i(uniforms.debugSelectedBLAS, debugSelectedBLAS);
+    glUniform1i(uniforms.debugSelectedTri, debugSelectedTri);
+}
+
+// Call after the path tracer draw: makes its image stores visible to the next frame and counts the sample
+void finishAccumulation() {
+    AccumulationState& acc = gAccumulation;
+    if (!acc.enabled) return;
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    if (acc.targetSamples > 0 && acc.samples >= acc.targetSamples) return;
+    ++acc.samples;
+    if (acc.samples == acc.targetSamples) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - acc.start).count();
+        Logger::info("Accumulation reached " + std::to_string(acc.samples) + " spp in " + std::to_string(ms) + " ms");
     }
-    glUniform1i(glGetUniformLocation(shaderProgram, "numTriangles"), totalTriangles);
-    glUniform1i(glGetUniformLocation(shaderProgram, "numLights"), (int)scene.lights.size());
-    glUniform1i(glGetUniformLocation(shaderProgram, "uniformBounceBudget"), bounceBudget);
+}
+
+// Logs the session's profile summary, writes the --trace file and releases the GPU timer queries;
+// call with the GL context still current
+void finishProfiling() {
+    Profiler& profiler = Profiler::shared();
+    profiler.collectGPU();
+    profiler.logSummary("session");
+    if (profiler.tracing()) profiler.writeTrace();
+    profiler.releaseGPU();
+}
+
+// Publishes this frame's FrameConstants (shared by the fragment shader and the wavefront
+// kernels) and binds the scene SSBOs; leaves shaderProgram current
+void sendSceneDataToShader(GLuint shaderProgram, const Scene& scene, int bounceBudget) {
+    FrameConstants constants;
+    constants.viewMatrix = scene.camera.viewMatrix;
+    constants.projectionMatrix = scene.camera.projectionMatrix;
+    constants.invViewMatrix = scene.camera.invViewMatrix;
+    constants.invProjectionMatrix = scene.camera.invProjectionMatrix;
+    constants.cameraPosition = scene.camera.position;
+    constants.pad0 = 0.0f;
+    constants.resolution = glm::vec2(float(SCR_WIDTH), float(SCR_HEIGHT));
+    constants.numLights = static_cast<int>(scene.lights.size());
+    constants.lightSamples = gLightSamples;
+    constants.bounceBudget = bounceBudget;
+    constants.blasNodeWidth = gBLASNodeWidth == 2 ? 2 : (gBLASNodeWidth <= 4 ? 4 : 8);
+    constants.blasNodeQuantized = gBLASNodeQuantized ? 1 : 0;
+    gFrameConstants.publish(constants);
+    glUseProgram(shaderProgram);
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "camera.viewMatrix"), 1, GL_FALSE, glm::value_ptr(scene.camera.viewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "camera.projectionMatrix"), 1, GL_FALSE, glm::value_ptr(scene.camera.projectionMatrix));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "camera.position"), 1, glm::value_ptr(scene.camera.position));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "camera.invViewMatrix"), 1, GL_FALSE, glm::value_ptr(invViewMatrix));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "camera.invProjectionMatrix"), 1, GL_FALSE, glm::value_ptr(invProjMatrix));
-    
     // Bind the SSBOs
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, triangleSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, materialSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, lightSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightTableSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, sobolSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, tlasNodeSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, tlasTriIdxSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, blasNodeSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, blasTriIdxSSBO);
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, bvhInstanceSSBO);
-
-    
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, blasNodeSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, blasNodeSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, vertexSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, triangleMaterialSSBO);
 }
 
 void setupQuad(GLuint& quadVAO, GLuint& quadVBO) {